@@ -8,67 +8,563 @@
  */
 
  #include <stdio.h>
+ #include <inttypes.h>
+ #include <stdarg.h>
  #include <stdlib.h>
+ #include <string.h>
  #include <time.h>
+ #include <pthread.h>
+ #include <unistd.h>
  
- typedef unsigned int uint32_t;
- typedef unsigned char uint8_t;
+ #include "cipher.h"
+ #include "fealattack.h"
  
- extern uint32_t bytesToWord32(const uint8_t *bytes);
- extern void word32ToBytes(uint32_t word, uint8_t *bytes);
- extern uint32_t fealFFunction(uint32_t input);
- extern void fealDecryptBlock(uint8_t ciphertext[8], const uint32_t subkeys[6]);
+ typedef struct PairDataset PairDataset;
+ extern PairDataset *pairDatasetCreate(void);
+ extern void pairDatasetFree(PairDataset *dataset);
+ extern int pairDatasetLoadThreaded(PairDataset *dataset, const char *filename, int threadCount);
+ extern int pairDatasetCount(const PairDataset *dataset);
+ extern const uint32_t *pairDatasetPlaintextLeft(const PairDataset *dataset);
+ extern const uint32_t *pairDatasetPlaintextRight(const PairDataset *dataset);
+ extern const uint32_t *pairDatasetCiphertextLeft(const PairDataset *dataset);
+ extern const uint32_t *pairDatasetCiphertextRight(const PairDataset *dataset);
+ extern int pairDatasetVerifyChecksum(const PairDataset *dataset);
+ extern uint32_t pairDatasetChecksum(const PairDataset *dataset);
+ extern int pairDatasetSaveBinary(const PairDataset *dataset, const char *filename);
+ extern int pairDatasetReadPairs(PairDataset *dataset, FILE *file, int maxPairs);
+ extern void pairDatasetSetQuiet(PairDataset *dataset, int quiet);
+ extern const char *pairDatasetError(const PairDataset *dataset);
+ extern int pairDatasetAppendArrays(PairDataset *dataset, const uint32_t *plaintextLeft, const uint32_t *plaintextRight,
+                                    const uint32_t *ciphertextLeft, const uint32_t *ciphertextRight, int count);
  
- extern int getPairCount(void);
- extern uint32_t getPlaintextLeft(int index);
- extern uint32_t getPlaintextRight(int index);
- extern uint32_t getCiphertextLeft(int index);
- extern uint32_t getCiphertextRight(int index);
- extern int loadKnownPairs(const char *filename);
- extern void cleanupPairData(void);
+ typedef struct TaskPool TaskPool;
+ typedef void (*TaskRunner)(TaskPool *pool, int workerId, void *task);
+ extern TaskPool *taskPoolCreate(int workerCount, size_t taskSize, TaskRunner runTask);
+ extern int taskPoolPush(TaskPool *pool, int workerId, const void *task);
+ extern void taskPoolRun(TaskPool *pool);
+ extern void taskPoolStop(TaskPool *pool);
+ extern int taskPoolStopped(TaskPool *pool);
+ extern void taskPoolFree(TaskPool *pool);
+ extern int taskPoolSetAffinity(TaskPool *pool, const int *cpus);
+ extern void taskPoolSetContext(TaskPool *pool, void *context);
+ extern void *taskPoolContext(TaskPool *pool);
+ 
+ extern int topologyCpuOrder(int spread, int *cpus, int *nodes, int maxCpus);
+ extern int topologyRunOnCpu(int cpu, void *(*work)(void *), void *context);
+ 
+ typedef struct CandidateHeap CandidateHeap;
+ extern CandidateHeap *candidateHeapCreate(int capacity);
+ extern void candidateHeapFree(CandidateHeap *heap);
+ extern void candidateHeapOffer(CandidateHeap *heap, int score, uint32_t key);
+ extern int candidateHeapThreshold(CandidateHeap *heap);
+ extern int candidateHeapDrain(CandidateHeap *heap, uint32_t *keys, int *scores);
+ 
+ typedef struct CandidateSet CandidateSet;
+ extern CandidateSet *candidateSetCreate(void);
+ extern void candidateSetFree(CandidateSet *set);
+ extern int candidateSetAdd(CandidateSet *set, uint32_t key);
+ extern int candidateSetSortUnique(CandidateSet *set);
+ extern int candidateSetCount(const CandidateSet *set);
+ extern const uint32_t *candidateSetKeys(const CandidateSet *set);
+ 
+ typedef struct CheckpointWriter CheckpointWriter;
+ extern CheckpointWriter *checkpointWriterCreate(const char *path);
+ extern int checkpointWriterSubmit(CheckpointWriter *writer, const void *data, size_t size);
+ extern void checkpointWriterFree(CheckpointWriter *writer);
+ extern void *checkpointRead(const char *path, size_t *size);
+ 
+ extern int mergeShardOutputs(int fileCount, char **paths);
+ 
+ typedef struct KeySink KeySink;
+ extern int keySinkParseFormat(const char *name);
+ extern KeySink *keySinkCreate(const char *path, int format, int wordCount);
+ extern void keySinkSubmit(KeySink *sink, const uint32_t *words);
+ extern int keySinkClose(KeySink *sink);
+ 
+ #define HARDWARE_COUNTER_COUNT 3   // cycles, instructions, cache misses
+ typedef struct ProgressMonitor ProgressMonitor;
+ typedef struct HardwareCounters HardwareCounters;
+ extern ProgressMonitor *progressMonitorCreate(long intervalMs, void (*report)(void *context), void *context);
+ extern void progressMonitorFree(ProgressMonitor *monitor);
+ extern HardwareCounters *hardwareCountersOpen(void);
+ extern int hardwareCountersRead(const HardwareCounters *counters, uint64_t *values);
+ extern void hardwareCountersClose(HardwareCounters *counters);
+ 
+ typedef struct GpuSweeper GpuSweeper;
+ extern GpuSweeper *gpuSweeperCreate(void);
+ extern void gpuSweeperFree(GpuSweeper *gpu);
+ extern const char *gpuSweeperDeviceName(const GpuSweeper *gpu);
+ extern int gpuSweeperLoadPairs(GpuSweeper *gpu, const uint8_t *fixedTerms, int pairCount);
+ extern int gpuSweeperLoadInputs(GpuSweeper *gpu, const uint32_t *const *inputs, int prefixCount);
+ extern int gpuSweeperInner(GpuSweeper *gpu, int approximation, uint32_t outputMask, int maxDisagreements,
+                            const uint32_t **survivors);
+ extern int gpuSweeperOuter(GpuSweeper *gpu, int approximation, uint32_t outputMask, int maxDisagreements,
+                            const uint32_t *rows, int rowCount, uint32_t skippedIndexBits,
+                            const uint32_t **survivors);
  
  // configuring attack parameters
  #define MAX_VALID_KEYS 256
+ #define ATTACK_ERROR_LENGTH 256   // longest error message kept for fealAttackError
  #define INNER_KEY_BITS 12
  #define OUTER_KEY_BITS 20
  #define INNER_KEY_SPACE (1 << INNER_KEY_BITS)  // 4096 possibilities
  #define OUTER_KEY_SPACE (1 << OUTER_KEY_BITS)  // 1048576 possibilities
+ #define MAX_KEY_STAGES 4                       // subkeys searched by the largest variant
+ #define MAX_KEY_WORDS (MAX_KEY_STAGES + 2)     // with the two derived whitening subkeys
  
- // initial attack state
- static int validKeysDiscovered = 0;
- static clock_t attackStartTime = 0;
+ // splitting the candidate spaces into stealable tasks
+ #define INNER_TASK_CHUNK 256                   // inner candidates per task
+ #define OUTER_TASK_CHUNK (1 << 16)             // outer candidates per task
+ #define STOP_CHECK_INTERVAL 4096               // outer candidates between stop checks
+ #define BFS_BATCH_PREFIXES 256                 // prefixes expanded together by the breadth-first search
+ #define BATCH_LEAD_PAIRS 8                     // leading pairs the batched inner sweeps test across prefixes
+ #define REORDER_SAMPLE_PAIRS 256               // leading pairs the rejection ordering ranks
+ #define BATCH_GROUP_PREFIXES 64                // prefixes of one batched inner task, a parity bit each
+ #define BATCH_MAX_DISAGREEMENTS 2              // looser statistical searches reject too late for the
+                                                // lead pairs to pay off and skip them
+ #define VALIDATION_QUICK_PAIRS 2               // pairs beyond the allowed disagreements encrypted
+                                                // one by one before the full key check
  
- static void processKey0Candidate(uint32_t k0);
- static void processKey1Candidate(uint32_t k0, uint32_t k1);
- static void processKey2Candidate(uint32_t k0, uint32_t k1, uint32_t k2);
- static void processKey3Candidate(uint32_t k0, uint32_t k1, uint32_t k2, uint32_t k3);
- static int deriveAndValidateKey(uint32_t k0, uint32_t k1, uint32_t k2, uint32_t k3);
+ // worker placement (--affinity): cpus considered and NUMA node ids with their own pair data copy
+ #define MAX_PLACED_CPUS 1024
+ #define MAX_NUMA_NODES 64
+ 
+ // streaming mode: lists of up to STREAM_EXPAND_CHAINS chains are grown by a level, as long
+ // as the new level stays below STREAM_MAX_CHAINS, larger lists wait for pairs to prune them
+ #define STREAM_EXPAND_CHAINS 256
+ #define STREAM_MAX_CHAINS (1 << 16)
+ #define STREAM_RETRY_PAIRS 4                   // new pairs before a refused expansion is retried
+ #define STREAM_MIN_VALIDATION_PAIRS 8          // pairs a full key is checked against before reporting
+ 
+ // split outer search: the low index bits finish the byte differences, b0 and b3 are tabled
+ #define OUTER_LOW_BITS 4
+ #define OUTER_BYTE_VALUES 256
  
  /*
-  * extracting a specific bit from a 32-bit word
-  * bit numbering: S0 is msb (bit 31), S31 is lsb (bit 0)
- */
- static int getBitAtPosition(uint32_t value, int sPosition) {
-     return (value >> (31 - sPosition)) & 1;
- }
+  * equivalent subkeys: F(x ⊕ 0x80800000) = F(x) ⊕ 0x02000000 and F(x ⊕ 0x00008080) =
+  * F(x) ⊕ 0x00000002, so every K0-K3 has 4 equivalents whose output change the later
+  * subkeys absorb, the class representative has bit 7 of key bytes 0 and 3 clear
+  * (b0, b3 < 0x80), i.e. outer indices without CLASS_OUTER_INDEX_BITS, a class has
+  * 4^rounds members
+  */
+ #define CLASS_FLIP_HIGH 0x80800000u
+ #define CLASS_FLIP_LOW 0x00008080u
+ #define CLASS_DELTA_HIGH 0x02000000u
+ #define CLASS_DELTA_LOW 0x00000002u
+ #define CLASS_OUTER_INDEX_BITS ((0x80 << 12) | (0x80 << 4))
+ 
+ // bit masks of the approximations in word bit order (S0 is bit 31, S15 is bit 16)
+ #define MASK_S13 0x00040000u
+ #define MASK_S15 0x00010000u
+ #define MASK_S5_13_21 0x04040400u
+ #define MASK_S7_15_23_31 0x01010101u
+ 
+ // byte-level s-boxes of the f-function (see cipher.c) for the split outer tables
+ #define SPLIT_ROTATE_LEFT_2(x) ((uint8_t)(((x) << 2) | ((x) >> 6)))
+ #define SPLIT_SBOX_0(a, b) (SPLIT_ROTATE_LEFT_2((uint8_t)((a) + (b))))
+ #define SPLIT_SBOX_1(a, b) (SPLIT_ROTATE_LEFT_2((uint8_t)((a) + (b) + 1)))
+ 
+ typedef enum {
+     TASK_INNER_SWEEP,   // testing a range of 12-bit inner candidates
+     TASK_OUTER_SWEEP,   // testing a range of 20-bit outer candidates for one inner key
+     TASK_INNER_SCORE,   // ranked mode: scoring inner candidates into a heap
+     TASK_OUTER_SCORE,   // ranked mode: scoring outer candidates into a heap
+     TASK_INNER_BATCH,   // breadth-first mode: adding consistent inner candidates of a prefix group to their sets
+     TASK_OUTER_COLLECT, // breadth-first mode: adding consistent stage keys to a set
+     TASK_REJECTION_BITS // pair ordering: K0 inner approximation bits of a candidate range for the sample
+ } SearchTaskKind;
  
  /*
-  * extracting and XORing multiple bits (for S7,15,23,31 notation)
- */
- static int getMultipleBits(uint32_t value, int pos1, int pos2, int pos3, int pos4) {
-     return getBitAtPosition(value, pos1) ^ 
-            getBitAtPosition(value, pos2) ^ 
-            getBitAtPosition(value, pos3) ^ 
-            getBitAtPosition(value, pos4);
- }
+  * cached per-pair round inputs below an accepted subkey prefix, shared by every task
+  * searching that subtree and freed with the last reference
+  */
+ typedef struct RoundState {
+     struct RoundState *parent;     // state of the previous round, kept alive for previousInput
+     const uint32_t *input;         // F input of the searched round before its key, per pair
+     const uint32_t *previousInput; // F input of the round before, per pair
+     uint32_t *ownedInput;          // buffer behind input, NULL for the K0 stage
+     uint32_t **nodeInputs;         // --affinity: copies of input per NUMA node, see stateInput
+     int references;
+ } RoundState;
+ 
+ /*
+  * the prefixes of a breadth-first batch as its batched inner sweeps see them: the F inputs
+  * of the leading pairs are transposed to one row per pair, so one batch kernel call tests
+  * a candidate on a pair for a whole group of prefixes
+  */
+ typedef struct {
+     RoundState **states;
+     CandidateSet **innerSets;
+     uint32_t *leadInputs;            // leadPairs rows of count words, row j is pair j of every prefix
+     int leadPairs;
+     int count;
+ } PrefixBatch;
+ 
+ typedef struct {
+     SearchTaskKind kind;
+     int stage;                           // subkey being searched, 0 for K0 ... 3 for K3
+     uint32_t prefix[MAX_KEY_STAGES - 1]; // accepted subkeys K0..K(stage-1)
+     uint32_t innerKey;               // fixed middle bytes for outer sweeps
+     int rangeStart;                  // first candidate index (inclusive)
+     int rangeEnd;                    // last candidate index (exclusive)
+     RoundState *state;               // cached round inputs for the accepted prefix
+     CandidateHeap *heap;             // top-K collector of scoring tasks
+     CandidateSet *set;               // collector of breadth-first tasks
+     const PrefixBatch *batch;        // prefixes of batched inner sweeps, from batch index firstPrefix
+     int firstPrefix;
+ } SearchTask;
+ 
+ // bit positions of the key-independent approximation terms in PreparedPairs.fixedTerms
+ enum {
+     FIXED_K0_INNER, FIXED_K0_OUTER,
+     FIXED_K1_INNER, FIXED_K1_OUTER,
+     FIXED_K2_INNER, FIXED_K2_OUTER,
+     FIXED_K3_INNER, FIXED_K3_OUTER,
+     APPROXIMATION_COUNT
+ };
+ 
+ /*
+  * one linear approximation as masks: the parity of the plaintext (L0, R0) and
+  * ciphertext (LN, RN) words under their masks (the key-independent term) xored with
+  * the parity of the searched round's F output under outputMask, the round is the
+  * stage of its table slot, the inner sweeps rely on outputMask S15 and the outer
+  * sweeps (and their per-byte tables) on S7,15,23,31
+  */
+ typedef struct {
+     uint32_t plainLeftMask;   // bits of L0
+     uint32_t plainRightMask;  // bits of R0
+     uint32_t cipherLeftMask;  // bits of LN
+     uint32_t cipherRightMask; // bits of RN
+     uint32_t outputMask;      // bits of F(X(stage)⊕K(stage))
+ } LinearApproximation;
+ 
+ /*
+  * a FEAL variant the attack knows approximations for: K0..K(rounds-1) are searched
+  * stage by stage with an inner and an outer approximation each, K(rounds) and
+  * K(rounds+1) are derived from a known pair
+  */
+ typedef struct {
+     int rounds;
+     LinearApproximation approximations[APPROXIMATION_COUNT];
+ } FealVariant;
+ 
+ // the approximations hold for every pair, so the exact search needs no statistics
+ static const FealVariant variants[] = {
+     {4, {
+         // S5,13,21(L0⊕R0⊕L4) ⊕ S15(L0⊕L4⊕R4) ⊕ S15 F(L0⊕R0⊕K0)
+         [FIXED_K0_INNER] = {MASK_S5_13_21 ^ MASK_S15, MASK_S5_13_21, MASK_S5_13_21 ^ MASK_S15, MASK_S15, MASK_S15},
+         // S13(L0⊕R0⊕L4) ⊕ S7,15,23,31(L0⊕L4⊕R4) ⊕ S7,15,23,31 F(L0⊕R0⊕K0)
+         [FIXED_K0_OUTER] = {MASK_S13 ^ MASK_S7_15_23_31, MASK_S13, MASK_S13 ^ MASK_S7_15_23_31,
+                             MASK_S7_15_23_31, MASK_S7_15_23_31},
+         // S5,13,21(L0⊕L4⊕R4) ⊕ S15 F(L0⊕Y0⊕K1)
+         [FIXED_K1_INNER] = {MASK_S5_13_21, 0, MASK_S5_13_21, MASK_S5_13_21, MASK_S15},
+         // S13(L0⊕L4⊕R4) ⊕ S7,15,23,31 F(L0⊕Y0⊕K1)
+         [FIXED_K1_OUTER] = {MASK_S13, 0, MASK_S13, MASK_S13, MASK_S7_15_23_31},
+         // S5,13,21(L0⊕R0⊕L4) ⊕ S15 F(L0⊕R0⊕Y1⊕K2)
+         [FIXED_K2_INNER] = {MASK_S5_13_21, MASK_S5_13_21, MASK_S5_13_21, 0, MASK_S15},
+         // S13(L0⊕R0⊕L4) ⊕ S7,15,23,31 F(L0⊕R0⊕Y1⊕K2)
+         [FIXED_K2_OUTER] = {MASK_S13, MASK_S13, MASK_S13, 0, MASK_S7_15_23_31},
+         // S5,13,21(L0⊕L4⊕R4) ⊕ S15(L0⊕R0⊕L4) ⊕ S15 F(L0⊕Y0⊕Y2⊕K3)
+         [FIXED_K3_INNER] = {MASK_S5_13_21 ^ MASK_S15, MASK_S15, MASK_S5_13_21 ^ MASK_S15, MASK_S5_13_21, MASK_S15},
+         // S13(L0⊕L4⊕R4) ⊕ S7,15,23,31(L0⊕R0⊕L4) ⊕ S7,15,23,31 F(L0⊕Y0⊕Y2⊕K3)
+         [FIXED_K3_OUTER] = {MASK_S13 ^ MASK_S7_15_23_31, MASK_S7_15_23_31, MASK_S13 ^ MASK_S7_15_23_31,
+                             MASK_S13, MASK_S7_15_23_31}
+     }},
+     {3, {
+         // S5,13,15,21(R0) ⊕ S15(L3) ⊕ S5,13,15,21(R3) ⊕ S15 F(L0⊕R0⊕K0)
+         [FIXED_K0_INNER] = {0, MASK_S5_13_21 ^ MASK_S15, MASK_S15, MASK_S5_13_21 ^ MASK_S15, MASK_S15},
+         // S7,13,15,23,31(R0) ⊕ S7,15,23,31(L3) ⊕ S7,13,15,23,31(R3) ⊕ S7,15,23,31 F(L0⊕R0⊕K0)
+         [FIXED_K0_OUTER] = {0, MASK_S13 ^ MASK_S7_15_23_31, MASK_S7_15_23_31, MASK_S13 ^ MASK_S7_15_23_31,
+                             MASK_S7_15_23_31},
+         // S5,13,21(L0⊕L3) ⊕ S15 F(L0⊕Y0⊕K1)
+         [FIXED_K1_INNER] = {MASK_S5_13_21, 0, MASK_S5_13_21, 0, MASK_S15},
+         // S13(L0⊕L3) ⊕ S7,15,23,31 F(L0⊕Y0⊕K1)
+         [FIXED_K1_OUTER] = {MASK_S13, 0, MASK_S13, 0, MASK_S7_15_23_31},
+         // S15(L0) ⊕ S5,13,15,21(R0⊕R3) ⊕ S15 F(L0⊕R0⊕Y1⊕K2)
+         [FIXED_K2_INNER] = {MASK_S15, MASK_S5_13_21 ^ MASK_S15, 0, MASK_S5_13_21 ^ MASK_S15, MASK_S15},
+         // S7,15,23,31(L0) ⊕ S7,13,15,23,31(R0⊕R3) ⊕ S7,15,23,31 F(L0⊕R0⊕Y1⊕K2)
+         [FIXED_K2_OUTER] = {MASK_S7_15_23_31, MASK_S13 ^ MASK_S7_15_23_31, 0, MASK_S13 ^ MASK_S7_15_23_31,
+                             MASK_S7_15_23_31}
+     }}
+ };
+ 
+ // contiguous per-pair terms computed once after loading
+ typedef struct {
+     uint32_t *plaintextLeft;   // L0
+     uint32_t *roundZeroInput;  // L0⊕R0, the round 0 F-function input before the key
+     uint8_t *fixedTerms;       // ciphertext-side parity bits, one bit per approximation
+     uint64_t *fixedMasks;      // the same bits packed per approximation, maskWords words each
+     uint64_t *plainSlices;     // bitsliced plaintexts and ciphertexts in file order, for
+     uint64_t *cipherSlices;    // validating complete keys against all pairs at once
+     int maskWords;
+     int count;
+ } PreparedPairs;
  
  /*
-  * extracting and XORing three bits (for S5,13,21 notation)
+  * --affinity: copies of the pair data every candidate test reads, one per NUMA node that
+  * runs workers and first touched there, workers read their node's copy through localTerms
   */
- static int getThreeBits(uint32_t value, int pos1, int pos2, int pos3) {
-     return getBitAtPosition(value, pos1) ^ 
-            getBitAtPosition(value, pos2) ^ 
-            getBitAtPosition(value, pos3);
+ typedef struct {
+     uint8_t *fixedTerms;
+     uint64_t *fixedMasks;
+     uint32_t *plaintextLeft;   // K0 round state inputs, the later states are copied lazily
+     uint32_t *roundZeroInput;
+     int node;
+ } PairTermReplica;
+ 
+ static __thread const PairTermReplica *localTerms = NULL;
+ 
+ // candidates scored and pairs evaluated for them, per stage and inner (0) / outer (1) sweep
+ typedef struct {
+     long long candidates;
+     long long pairs;
+     long long survivors;    // candidates that passed the approximation test
+     long long fCalls;       // full F-function evaluations, the split tables need none
+     long long nanoseconds;  // task time summed over workers, measured when instrumented
+ } SweepCounters;
+ 
+ // full keys reaching each validation tier, one count per derived basis pair
+ typedef struct {
+     long long derived;      // K4/K5 derived from a basis pair
+     long long quickPassed;  // also encrypted the quick pairs correctly
+     long long confirmed;    // also passed the check against all pairs
+ } ValidationCounters;
+ 
+ // searching class representatives and printing every member, only the representatives,
+ // or searching all equivalent subkeys one by one
+ enum {
+     KEY_CLASSES_EXPAND = FEAL_KEY_CLASSES_EXPAND,
+     KEY_CLASSES_REPRESENTATIVES = FEAL_KEY_CLASSES_REPRESENTATIVES,
+     KEY_CLASSES_OFF = FEAL_KEY_CLASSES_OFF
+ };
+ 
+ // per stage sizes of the breadth-first candidate sets
+ typedef struct {
+     long long prefixes;   // accepted prefixes the stage was searched below
+     long long innerKeys;  // distinct consistent inner keys over all prefixes
+     long long stageKeys;  // distinct consistent full stage keys over all prefixes
+ } StageSetCounts;
+ 
+ // wall time and hardware counts of the breadth-first stages, the last slot is the validation
+ typedef struct {
+     long long elapsedMs;
+     uint64_t hardware[HARDWARE_COUNTER_COUNT];
+ } StageTiming;
+ 
+ typedef void (*KeyReporter)(void *context, const uint32_t *key, int words);
+ 
+ /*
+  * everything one attack owns, its parameters, the prepared pairs, counters and where
+  * the search stands, so that several attacks (fealattack.h) can run in one process,
+  * every thread working for an attack reaches it through run: the thread starting the
+  * attack, the pool workers (the pool context) and the progress reports
+  */
+ typedef struct AttackRun {
+     // approximations and searched subkeys of the attacked variant (--rounds), FEAL-4 by default
+     const LinearApproximation *approximations;
+     int keyStages;
+     
+     // known pairs of the attacked dataset, in file order
+     PairDataset *dataset;
+     PreparedPairs prepared;
+     
+     // --affinity: the per-node pair term copies and the node of every worker, NULL without placement
+     PairTermReplica termReplicas[MAX_NUMA_NODES];
+     int *workerNodes;
+     
+     int threadCount;
+     int affinity;               // -1 unpinned, else 1 for spread and 0 for compact placement
+     int verbose;                // the run report goes to stdout (the command line tool)
+     
+     // batch kernels evaluate blockPairs pairs per call, 0 selects the scalar kernels
+     int blockPairs;
+     
+     // statistical mode: candidates may disagree with the majority on this many pairs
+     double minimumBias;
+     int allowedDisagreements;
+     
+     // ranked mode keeps the rankLimit best candidates per stage, 0 runs the exhaustive search
+     int rankLimit;
+     
+     // the search stops once keyLimit full keys are confirmed, foundKeys holds them
+     // (MAX_KEY_WORDS words each) and keyReporter is told of each from its worker
+     int keyLimit;
+     int validKeysDiscovered;
+     uint32_t *foundKeys;
+     KeyReporter keyReporter;
+     void *keyContext;
+     struct timespec attackStartTime;
+     
+     int reorderPairs;
+     uint64_t *rejectionColumns;  // K0 inner bits of the ordered sample, INNER_KEY_SPACE / 64 words per pair
+     int rejectionSamplePairs;
+     
+     // candidates scored and pairs evaluated for them, per stage and inner (0) / outer (1) sweep
+     SweepCounters sweepCounters[MAX_KEY_STAGES][2];
+     
+     // F-function evaluations caching the round inputs below accepted subkeys
+     long long roundStateFCalls;
+     ValidationCounters validationCounters;
+     
+     // task timing is only taken for --stats, --progress and --json, the hot loops only count
+     int instrumented;
+     long progressIntervalMs;
+     HardwareCounters *hardwareCounters;
+     
+     // outer sweeps match the per-byte tables (1) or test all 2^20 candidates one by one (0)
+     int splitOuterSearch;
+     
+     // exhaustive search order, breadth-first over candidate sets (1) or depth-first over tasks (0)
+     int breadthFirst;
+     
+     // --gpu: the breadth-first inner and outer sweeps run on the OpenCL backend instead of the pool
+     int useGpu;
+     GpuSweeper *gpuSweeper;
+     int wantHardwareCounters;
+     
+     int keyClassMode;
+     int outerByteLimit;         // b0 and b3 values the outer sweeps try
+     
+     // per stage sizes of the breadth-first candidate sets and their timings
+     StageSetCounts bfsStageCounts[MAX_KEY_STAGES];
+     StageTiming bfsStageTimings[MAX_KEY_STAGES + 1];
+     
+     // where the breadth-first search stands, for the progress reports of another thread
+     int progressStage;          // -1 before and outside the breadth-first search
+     int progressPrefixesDone;
+     int progressPrefixCount;
+     long progressStageStartMs;
+     int progressBatchPrefixes;  // prefixes of the batch being expanded
+     long long progressBatchWork; // outer candidate ranges the batch queued
+     long long progressBatchWorkDone;
+     
+     /*
+      * this attack searches shard shardIndex of shardCount, the runs of all shards
+      * together cover the key space once, the partition does not depend on threads
+      */
+     int shardIndex;
+     int shardCount;
+     
+     // breadth-first checkpoints, saved to checkpointFile (or resumeFile) every checkpointIntervalMs
+     const char *checkpointFile;
+     const char *resumeFile;
+     CheckpointWriter *checkpointWriter;
+     long checkpointIntervalMs;
+     uint32_t pairFingerprint;    // checksum of the pairs in file order
+     long lastCheckpointMs;
+     
+     // the pool of the running search, for cancelling it from another thread
+     pthread_mutex_t poolLock;
+     TaskPool *pool;
+     int cancelRequested;
+     
+     // the first error of the run for fealAttackError, claimed by one thread
+     int errorClaimed;
+     char error[ATTACK_ERROR_LENGTH];
+ } AttackRun;
+ 
+ static __thread AttackRun *run = NULL;
+ 
+ // a line of the run report, printed only by the command line tool
+ static void runReport(const char *format, ...) {
+     if (run->verbose) {
+         va_list arguments;
+         va_start(arguments, format);
+         vprintf(format, arguments);
+         va_end(arguments);
+     }
+ }
+ 
+ // keeping the first error of an attack for fealAttackError, later ones are dropped
+ static void keepAttackError(AttackRun *attack, const char *format, va_list arguments) {
+     int unclaimed = 0;
+     if (__atomic_compare_exchange_n(&attack->errorClaimed, &unclaimed, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+         vsnprintf(attack->error, sizeof(attack->error), format, arguments);
+     }
+ }
+ 
+ // an error of the run, "Error: ..." on stderr for the command line tool, kept by the library
+ static void runError(const char *format, ...) {
+     va_list arguments;
+     va_start(arguments, format);
+ #ifdef FEAL_ATTACK_LIBRARY
+     keepAttackError(run, format, arguments);
+ #else
+     fprintf(stderr, "Error: ");
+     vfprintf(stderr, format, arguments);
+     fprintf(stderr, "\n");
+ #endif
+     va_end(arguments);
+ }
+ 
+ // a problem the run recovers from, the library drops it
+ static void runWarning(const char *format, ...) {
+ #ifdef FEAL_ATTACK_LIBRARY
+     (void)format;
+ #else
+     va_list arguments;
+     va_start(arguments, format);
+     fprintf(stderr, "Warning: ");
+     vfprintf(stderr, format, arguments);
+     fprintf(stderr, "\n");
+     va_end(arguments);
+ #endif
+ }
+ 
+ // the parameters of a fresh attack on FEAL-4, every counter zero
+ static void initAttackRun(AttackRun *attack) {
+     memset(attack, 0, sizeof(*attack));
+     attack->approximations = variants[0].approximations;
+     attack->keyStages = MAX_KEY_STAGES;
+     attack->threadCount = 1;
+     attack->affinity = -1;
+     attack->minimumBias = 0.5;
+     attack->keyLimit = MAX_VALID_KEYS;
+     attack->reorderPairs = 1;
+     attack->splitOuterSearch = 1;
+     attack->breadthFirst = 1;
+     attack->keyClassMode = KEY_CLASSES_EXPAND;
+     attack->outerByteLimit = OUTER_BYTE_VALUES / 2;
+     attack->progressStage = -1;
+     attack->shardCount = 1;
+     attack->checkpointIntervalMs = 60000;
+     pthread_mutex_init(&attack->poolLock, NULL);
+ }
+ 
+ // spreading K0 keys over the shards by a multiplicative hash
+ static int shardOwnsKey(uint32_t key) {
+     uint32_t mixed = key * 0x9e3779b1u;
+     return (int)(((unsigned long long)mixed * (unsigned)run->shardCount) >> 32) == run->shardIndex;
+ }
+ 
+ static void releasePreparedPairs(void);
+ static void packFixedMasks(void);
+ static void retainRoundState(RoundState *state);
+ static void releaseRoundState(RoundState *state);
+ static int deriveAndValidateKey(TaskPool *pool, const uint32_t *keys);
+ static int validateKeyClass(TaskPool *pool, const uint32_t *keys);
+ static void pushRangeTasks(TaskPool *pool, int firstWorker, int workerStride,
+                            const SearchTask *templateTask, int spaceSize, int chunkSize);
+ 
+ // attacking FEAL with the given number of rounds, 0 if there are no approximations for it
+ static int selectVariant(AttackRun *attack, int rounds) {
+     for (size_t variantIdx = 0; variantIdx < sizeof(variants) / sizeof(variants[0]); variantIdx++) {
+         if (variants[variantIdx].rounds == rounds) {
+             attack->approximations = variants[variantIdx].approximations;
+             attack->keyStages = rounds;
+             // by default the search ends after one class of equivalent keys, 4^rounds of them
+             if (attack->keyLimit == MAX_VALID_KEYS) {
+                 attack->keyLimit = 1 << (2 * rounds);
+             }
+             return 1;
+         }
+     }
+     return 0;
+ }
+ 
+ // table slot (and fixed term bit) of the inner or outer approximation of a stage
+ static int approximationIndex(int stage, int outer) {
+     return FIXED_K0_INNER + 2 * stage + outer;
  }
  
  /*
@@ -80,6 +576,11 @@
      return byte1 | byte2;
  }
  
+ // whether the outer sweeps try this index, only class representatives unless disabled
+ static int searchedOuterIndex(int candidate) {
+     return run->outerByteLimit == OUTER_BYTE_VALUES || (candidate & CLASS_OUTER_INDEX_BITS) == 0;
+ }
+ 
  /*
   * constructing 20-bit outer key candidate (first and last bytes)
   */
@@ -96,420 +597,3124 @@
  }
  
  /*
-  * linear approximation for K0 inner bytes
-  * equation: S5,13,21(L0⊕R0⊕L4) ⊕ S15(L0⊕L4⊕R4) ⊕ S15 F(L0⊕R0⊕K0)
+  * key-independent parity bits of the variant's approximations for one pair,
+  * bit FIXED_Kn_INNER / FIXED_Kn_OUTER of the result
   */
- static int linearApproxK0Inner(int pairIdx, uint32_t keyCandidate) {
-     uint32_t pLeft = getPlaintextLeft(pairIdx); // L0
-     uint32_t pRight = getPlaintextRight(pairIdx); // R0
-     uint32_t cLeft = getCiphertextLeft(pairIdx); // L4
-     uint32_t cRight = getCiphertextRight(pairIdx); // R4
+ static uint8_t pairFixedTerms(uint32_t pLeft, uint32_t pRight, uint32_t cLeft, uint32_t cRight) {
+     uint8_t bits = 0;
      
-     uint32_t val1 = pLeft ^ pRight ^ cLeft; // L0⊕R0⊕L4
-     int term1 = getThreeBits(val1, 5, 13, 21); // S5,13,21(L0⊕R0⊕L4)
-     
-     uint32_t val2 = pLeft ^ cLeft ^ cRight; // L0⊕L4⊕R4
-     int term2 = getBitAtPosition(val2, 15); // S15(L0⊕L4⊕R4)
-     
-     uint32_t fOutput = fealFFunction(pLeft ^ pRight ^ keyCandidate); // F(L0⊕R0⊕K0)
-     int term3 = getBitAtPosition(fOutput, 15); // S15 F(L0⊕R0⊕K0)
-     
-     return term1 ^ term2 ^ term3; // S5,13,21(L0⊕R0⊕L4) ⊕ S15(L0⊕L4⊕R4) ⊕ S15 F(L0⊕R0⊕K0)
+     for (int approximation = 0; approximation < 2 * run->keyStages; approximation++) {
+         const LinearApproximation *approx = &run->approximations[approximation];
+         int term = __builtin_parity((pLeft & approx->plainLeftMask) ^ (pRight & approx->plainRightMask) ^
+                                     (cLeft & approx->cipherLeftMask) ^ (cRight & approx->cipherRightMask));
+         bits |= (uint8_t)(term << approximation);
+     }
+     return bits;
  }
  
  /*
-  * linear approximation for K0 outer bytes
-  * equation: S13(L0⊕R0⊕L4) ⊕ S7,15,23,31(L0⊕L4⊕R4) ⊕ S7,15,23,31 F(L0⊕R0⊕K0)
+  * preparing the key-independent part of every approximation once per pair,
+  * the hot loops then only evaluate the key-dependent F-function term
   */
- static int linearApproxK0Outer(int pairIdx, uint32_t keyCandidate) {
-     uint32_t pLeft = getPlaintextLeft(pairIdx); // L0
-     uint32_t pRight = getPlaintextRight(pairIdx); // R0
-     uint32_t cLeft = getCiphertextLeft(pairIdx); // L4
-     uint32_t cRight = getCiphertextRight(pairIdx); // R4
+ static int preparePairData(void) {
+     int numPairs = pairDatasetCount(run->dataset);
+     const uint32_t *plaintextLeft = pairDatasetPlaintextLeft(run->dataset);
+     const uint32_t *plaintextRight = pairDatasetPlaintextRight(run->dataset);
+     const uint32_t *ciphertextLeft = pairDatasetCiphertextLeft(run->dataset);
+     const uint32_t *ciphertextRight = pairDatasetCiphertextRight(run->dataset);
      
-     uint32_t val1 = pLeft ^ pRight ^ cLeft; // L0⊕R0⊕L4
-     int term1 = getBitAtPosition(val1, 13); // S13(L0⊕R0⊕L4)
+     run->prepared.plaintextLeft = (uint32_t *)malloc(numPairs * sizeof(uint32_t));
+     run->prepared.roundZeroInput = (uint32_t *)malloc(numPairs * sizeof(uint32_t));
+     run->prepared.fixedTerms = (uint8_t *)malloc(numPairs * sizeof(uint8_t));
+     run->prepared.maskWords = (numPairs + 63) / 64;
+     run->prepared.fixedMasks = (uint64_t *)calloc(APPROXIMATION_COUNT * run->prepared.maskWords, sizeof(uint64_t));
+     run->prepared.plainSlices = (uint64_t *)malloc(fealBitslicedWords(numPairs) * sizeof(uint64_t));
+     run->prepared.cipherSlices = (uint64_t *)malloc(fealBitslicedWords(numPairs) * sizeof(uint64_t));
      
-     uint32_t val2 = pLeft ^ cLeft ^ cRight; // L0⊕L4⊕R4
-     int term2 = getMultipleBits(val2, 7, 15, 23, 31); // S7,15,23,31(L0⊕L4⊕R4)
+     if (!run->prepared.plaintextLeft || !run->prepared.roundZeroInput || !run->prepared.fixedTerms ||
+         !run->prepared.fixedMasks || !run->prepared.plainSlices || !run->prepared.cipherSlices) {
+         releasePreparedPairs();
+         return 0;
+     }
+     
+     for (int pairIdx = 0; pairIdx < numPairs; pairIdx++) {
+         run->prepared.plaintextLeft[pairIdx] = plaintextLeft[pairIdx];
+         run->prepared.roundZeroInput[pairIdx] = plaintextLeft[pairIdx] ^ plaintextRight[pairIdx];
+         run->prepared.fixedTerms[pairIdx] = pairFixedTerms(plaintextLeft[pairIdx], plaintextRight[pairIdx],
+                                                       ciphertextLeft[pairIdx], ciphertextRight[pairIdx]);
+     }
      
-     uint32_t fOutput = fealFFunction(pLeft ^ pRight ^ keyCandidate); // F(L0⊕R0⊕K0)    
-     int term3 = getMultipleBits(fOutput, 7, 15, 23, 31); // S7,15,23,31 F(L0⊕R0⊕K0)
+     fealBitsliceBlocks(plaintextLeft, plaintextRight, numPairs, run->prepared.plainSlices);
+     fealBitsliceBlocks(ciphertextLeft, ciphertextRight, numPairs, run->prepared.cipherSlices);
      
-     return term1 ^ term2 ^ term3; // S13(L0⊕R0⊕L4) ⊕ S7,15,23,31(L0⊕L4⊕R4) ⊕ S7,15,23,31 F(L0⊕R0⊕K0)
+     run->prepared.count = numPairs;
+     packFixedMasks();
+     return 1;
  }
  
- /*
-  * linear approximation for K1 inner bytes (middle bytes)
-  */
- static int linearApproxK1Inner(int pairIdx, uint32_t keyCandidate, uint32_t k0) {
-     uint32_t pLeft = getPlaintextLeft(pairIdx); // L0
-     uint32_t pRight = getPlaintextRight(pairIdx); // R0
-     uint32_t cLeft = getCiphertextLeft(pairIdx); // L4
-     uint32_t cRight = getCiphertextRight(pairIdx); // R4
-     
-     uint32_t val1 = pLeft ^ cLeft ^ cRight; // L0⊕L4⊕R4
-     int term1 = getThreeBits(val1, 5, 13, 21); // S5,13,21(L0⊕L4⊕R4)
+ // packing the per-pair fixed terms into one bit mask per approximation for the batch kernels
+ static void packFixedMasks(void) {
+     memset(run->prepared.fixedMasks, 0, APPROXIMATION_COUNT * run->prepared.maskWords * sizeof(uint64_t));
      
-     uint32_t y0 = fealFFunction(pLeft ^ pRight ^ k0); // F(L0⊕R0⊕K0)
-     uint32_t fOutput = fealFFunction(pLeft ^ y0 ^ keyCandidate); // F(L0⊕Y0⊕K1)
-     int term2 = getBitAtPosition(fOutput, 15); // S15 F(L0⊕Y0⊕K1)  
+     for (int pairIdx = 0; pairIdx < run->prepared.count; pairIdx++) {
+         for (int approximation = 0; approximation < 2 * run->keyStages; approximation++) {
+             uint64_t bit = (run->prepared.fixedTerms[pairIdx] >> approximation) & 1;
+             run->prepared.fixedMasks[approximation * run->prepared.maskWords + pairIdx / 64] |= bit << (pairIdx % 64);
+         }
+     }
+ }
+ 
+ static void releasePreparedPairs(void) {
+     for (int node = 0; node < MAX_NUMA_NODES; node++) {
+         free(run->termReplicas[node].fixedTerms);
+         free(run->termReplicas[node].fixedMasks);
+         free(run->termReplicas[node].plaintextLeft);
+         free(run->termReplicas[node].roundZeroInput);
+     }
+     memset(run->termReplicas, 0, sizeof(run->termReplicas));
+     free(run->workerNodes);
+     run->workerNodes = NULL;
+     localTerms = NULL;
      
-     return term1 ^ term2; // S5,13,21(L0⊕L4⊕R4) ⊕ S15 F(L0⊕Y0⊕K1)
+     free(run->prepared.plaintextLeft);
+     free(run->prepared.roundZeroInput);
+     free(run->prepared.fixedTerms);
+     free(run->prepared.fixedMasks);
+     free(run->prepared.plainSlices);
+     free(run->prepared.cipherSlices);
+     memset(&run->prepared, 0, sizeof(run->prepared));
+ }
+ 
+ // key-independent parity bit of one approximation for a pair
+ static int fixedTerm(int pairIdx, int approximation) {
+     const uint8_t *terms = localTerms ? localTerms->fixedTerms : run->prepared.fixedTerms;
+     return (terms[pairIdx] >> approximation) & 1;
  }
  
  /*
-  * linear approximation for K1 outer bytes (first and last bytes)
+  * key-independent parity bits of one approximation for count pairs from firstPair,
+  * blocks never straddle a mask word because the block size divides 64
   */
- static int linearApproxK1Outer(int pairIdx, uint32_t k0, uint32_t k1) {
-     uint32_t pLeft = getPlaintextLeft(pairIdx); // L0
-     uint32_t pRight = getPlaintextRight(pairIdx); // R0
-     uint32_t cLeft = getCiphertextLeft(pairIdx); // L4 
-     uint32_t cRight = getCiphertextRight(pairIdx); // R4
-     
-     uint32_t val1 = pLeft ^ cLeft ^ cRight; // L0⊕L4⊕R4
-     int term1 = getBitAtPosition(val1, 13);
-     
-     uint32_t y0 = fealFFunction(pLeft ^ pRight ^ k0); // F(L0⊕R0⊕K0)
-     uint32_t y1 = fealFFunction(pLeft ^ y0 ^ k1); // F(L0⊕Y0⊕K1)
-     int term2 = getMultipleBits(y1, 7, 15, 23, 31); // S7,15,23,31(L0⊕Y0⊕K1)
-     
-     return term1 ^ term2; // S13(L0⊕L4⊕R4) ⊕ S7,15,23,31(L0⊕Y0⊕K1)
+ static uint64_t fixedTermBits(int approximation, int firstPair, int count) {
+     const uint64_t *masks = localTerms ? localTerms->fixedMasks : run->prepared.fixedMasks;
+     uint64_t word = masks[approximation * run->prepared.maskWords + firstPair / 64];
+     word >>= firstPair % 64;
+     return count < 64 ? word & ((1ULL << count) - 1) : word;
  }
  
  /*
-  * linear approximation for K2 inner bytes (middle bytes)
+  * evaluating an approximation on one pair: the key-dependent term is the parity of
+  * the masked F output, input is the cached F input of the searched round for the prefix
+  * (stateInput of its round state)
   */
- static int linearApproxK2Inner(int pairIdx, uint32_t keyCandidate, 
-                                 uint32_t k0, uint32_t k1) {
-     uint32_t pLeft = getPlaintextLeft(pairIdx); // L0      
-     uint32_t pRight = getPlaintextRight(pairIdx); // R0
-     uint32_t cLeft = getCiphertextLeft(pairIdx); // L4
-     
-     uint32_t val1 = pLeft ^ pRight ^ cLeft; // L0⊕R0⊕L4
-     int term1 = getThreeBits(val1, 5, 13, 21); // S5,13,21(L0⊕R0⊕L4)
-     
-     uint32_t y0 = fealFFunction(pLeft ^ pRight ^ k0); // F(L0⊕R0⊕K0)
-     uint32_t y1 = fealFFunction(pLeft ^ y0 ^ k1);
-     uint32_t fOutput = fealFFunction(pLeft ^ pRight ^ y1 ^ keyCandidate); // F(L0⊕R0⊕Y1⊕K2)
-     int term2 = getBitAtPosition(fOutput, 15); // S15 F(L0⊕R0⊕Y1⊕K2)
-     
-     return term1 ^ term2; // S5,13,21(L0⊕R0⊕L4) ⊕ S15 F(L0⊕R0⊕Y1⊕K2)
+ static int evaluateApprox(int approximation, int pairIdx, uint32_t key, const uint32_t *input) {
+     return fixedTerm(pairIdx, approximation) ^
+            fealFParity(input[pairIdx] ^ key, run->approximations[approximation].outputMask);
  }
  
  /*
-  * linear approximation for K2 outer bytes (first and last bytes)
+  * batch variant: bit i of the result is the approximation for pair firstPair + i,
+  * evaluated by the vectorized F kernels
   */
- static int linearApproxK2Outer(int pairIdx, uint32_t k0, uint32_t k1, uint32_t k2) {
-     uint32_t pLeft = getPlaintextLeft(pairIdx); // L0
-     uint32_t pRight = getPlaintextRight(pairIdx); // R0
-     uint32_t cLeft = getCiphertextLeft(pairIdx); // L4
-     
-     uint32_t val1 = pLeft ^ pRight ^ cLeft; // L0⊕R0⊕L4                                    
-     int term1 = getBitAtPosition(val1, 13);
-     
-     uint32_t y0 = fealFFunction(pLeft ^ pRight ^ k0); // F(L0⊕R0⊕K0)                               
-     uint32_t y1 = fealFFunction(pLeft ^ y0 ^ k1); // F(L0⊕Y0⊕K1)
-     uint32_t y2 = fealFFunction(pLeft ^ pRight ^ y1 ^ k2); // F(L0⊕R0⊕Y1⊕K2)
-     int term2 = getMultipleBits(y2, 7, 15, 23, 31);
-     
-     return term1 ^ term2; // S13(L0⊕R0⊕L4) ⊕ S7,15,23,31(L0⊕R0⊕Y1⊕K2)
+ static uint64_t evaluateApproxBatch(int approximation, int firstPair, int count, uint32_t key,
+                                     const uint32_t *input) {
+     return fixedTermBits(approximation, firstPair, count) ^
+            fealFParityBatch(input + firstPair, key, run->approximations[approximation].outputMask, count);
  }
  
  /*
-  * linear approximation for K3 inner bytes (middle bytes)
+  * --affinity: the F inputs of a round state on the calling worker's NUMA node, the K0
+  * inputs come from the node's replica, the first worker of a node reading a later state
+  * copies its inputs there, runs without placement read state->input
   */
- static int linearApproxK3Inner(int pairIdx, uint32_t keyCandidate,
-                                 uint32_t k0, uint32_t k1, uint32_t k2) {
-     uint32_t pLeft = getPlaintextLeft(pairIdx); // L0
-     uint32_t pRight = getPlaintextRight(pairIdx); // R0
-     uint32_t cLeft = getCiphertextLeft(pairIdx); // L4
-     uint32_t cRight = getCiphertextRight(pairIdx); // R4
-     
-     uint32_t val1 = pLeft ^ cLeft ^ cRight; // L0⊕L4⊕R4
-     int term1 = getThreeBits(val1, 5, 13, 21);
-     
-     uint32_t val2 = pLeft ^ pRight ^ cLeft; // L0⊕R0⊕L4
-     int term2 = getBitAtPosition(val2, 15);
-     
-     uint32_t y0 = fealFFunction(pLeft ^ pRight ^ k0); // F(L0⊕R0⊕K0)
-     uint32_t y1 = fealFFunction(pLeft ^ y0 ^ k1);
-     uint32_t y2 = fealFFunction(pLeft ^ pRight ^ y1 ^ k2); // F(L0⊕R0⊕Y1⊕K2)
-     uint32_t fOutput = fealFFunction(pLeft ^ y0 ^ y2 ^ keyCandidate); // F(L0⊕Y0⊕Y2⊕K3)    
-     int term3 = getBitAtPosition(fOutput, 15); // S15 F(L0⊕Y0⊕Y2⊕K3)
+ static const uint32_t *stateInput(const RoundState *state) {
+     if (!localTerms) {
+         return state->input;
+     }
+     if (!state->ownedInput) {
+         return localTerms->roundZeroInput;
+     }
+     if (!state->nodeInputs) {
+         return state->input;
+     }
      
-     return term1 ^ term2 ^ term3; // S5,13,21(L0⊕L4⊕R4) ⊕ S15(L0⊕R0⊕L4) ⊕ S15 F(L0⊕Y0⊕Y2⊕K3)
+     uint32_t **slot = &state->nodeInputs[localTerms->node];
+     uint32_t *local = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+     if (!local) {
+         uint32_t *copy = (uint32_t *)malloc(run->prepared.count * sizeof(uint32_t));
+         if (!copy) {
+             return state->input;
+         }
+         memcpy(copy, state->input, run->prepared.count * sizeof(uint32_t));
+         if (__atomic_compare_exchange_n(slot, &local, copy, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+             local = copy;
+         } else {
+             free(copy);
+         }
+     }
+     return local;
+ }
+ 
+ // the F inputs of the round before, X(-1) = L0 for the K0 state
+ static const uint32_t *statePreviousInput(const RoundState *state) {
+     if (state->parent) {
+         return stateInput(state->parent);
+     }
+     return localTerms ? localTerms->plaintextLeft : state->previousInput;
  }
  
  /*
-  * linear approximation for K3 outer bytes (first and last bytes)
+  * creating the round state below an accepted subkey of the parent's round:
+  * X(s+1) = X(s-1) ⊕ F(X(s) ⊕ K(s)), with X(-1) = L0 and X(0) = L0⊕R0
   */
- static int linearApproxK3Outer(int pairIdx, uint32_t k0, uint32_t k1, 
-                                 uint32_t k2, uint32_t k3) {
-     uint32_t pLeft = getPlaintextLeft(pairIdx); // L0
-     uint32_t pRight = getPlaintextRight(pairIdx); // R0
-     uint32_t cLeft = getCiphertextLeft(pairIdx); // L4
-     uint32_t cRight = getCiphertextRight(pairIdx); // R4
+ static RoundState *createRoundState(RoundState *parent, uint32_t acceptedKey) {
+     RoundState *state = (RoundState *)malloc(sizeof(RoundState));
+     uint32_t *input = (uint32_t *)malloc(run->prepared.count * sizeof(uint32_t));
+     // placed runs start the node copies with the creator's, written on its node
+     uint32_t **nodeInputs = localTerms ? (uint32_t **)calloc(MAX_NUMA_NODES, sizeof(uint32_t *)) : NULL;
      
-     uint32_t val1 = pLeft ^ cLeft ^ cRight; // L0⊕L4⊕R4
-     int term1 = getBitAtPosition(val1, 13);
+     if (!state || !input || (localTerms && !nodeInputs)) {
+         free(state);
+         free(input);
+         free(nodeInputs);
+         return NULL;
+     }
      
-     uint32_t val2 = pLeft ^ pRight ^ cLeft; // L0⊕R0⊕L4
-     int term2 = getMultipleBits(val2, 7, 15, 23, 31);
+     const uint32_t *parentInput = stateInput(parent);
+     const uint32_t *parentPrevious = statePreviousInput(parent);
+     for (int pairIdx = 0; pairIdx < run->prepared.count; pairIdx++) {
+         input[pairIdx] = parentPrevious[pairIdx] ^ fealFFunction(parentInput[pairIdx] ^ acceptedKey);
+     }
+     if (nodeInputs) {
+         nodeInputs[localTerms->node] = input;
+     }
+     __atomic_add_fetch(&run->roundStateFCalls, run->prepared.count, __ATOMIC_RELAXED);
      
-     uint32_t y0 = fealFFunction(pLeft ^ pRight ^ k0); // F(L0⊕R0⊕K0)
-     uint32_t y1 = fealFFunction(pLeft ^ y0 ^ k1); // F(L0⊕Y0⊕K1)
-     uint32_t y2 = fealFFunction(pLeft ^ pRight ^ y1 ^ k2); // F(L0⊕R0⊕Y1⊕K2)
-     uint32_t y3 = fealFFunction(pLeft ^ y0 ^ y2 ^ k3); // F(L0⊕Y0⊕Y2⊕K3)   
-     int term3 = getMultipleBits(y3, 7, 15, 23, 31); // S7,15,23,31(L0⊕Y0⊕Y2⊕K3)
+     retainRoundState(parent);
+     state->parent = parent;
+     state->input = input;
+     state->previousInput = parent->input;
+     state->ownedInput = input;
+     state->nodeInputs = nodeInputs;
+     state->references = 1;
+     return state;
+ }
+ 
+ // round state of the K0 stage, backed by the prepared pair arrays
+ static RoundState *createRootRoundState(void) {
+     RoundState *state = (RoundState *)calloc(1, sizeof(RoundState));
+     if (state) {
+         state->input = run->prepared.roundZeroInput;
+         state->previousInput = run->prepared.plaintextLeft;
+         state->references = 1;
+     }
+     return state;
+ }
+ 
+ // round state below a prefix of accepted full keys K0..K(stages-1), NULL if memory ran out
+ static RoundState *createPrefixRoundState(const uint32_t *keys, int stages) {
+     RoundState *state = createRootRoundState();
      
-     return term1 ^ term2 ^ term3; // S13(L0⊕L4⊕R4) ⊕ S7,15,23,31(L0⊕R0⊕L4) ⊕ S7,15,23,31(L0⊕Y0⊕Y2⊕K3)              
+     for (int stage = 0; state && stage < stages; stage++) {
+         RoundState *next = createRoundState(state, keys[stage]);
+         releaseRoundState(state);
+         state = next;
+     }
+     return state;
+ }
+ 
+ // batched tasks borrow the states of their batch and hold no reference (NULL)
+ static void retainRoundState(RoundState *state) {
+     if (state) {
+         __atomic_add_fetch(&state->references, 1, __ATOMIC_RELAXED);
+     }
+ }
+ 
+ static void releaseRoundState(RoundState *state) {
+     while (state && __atomic_sub_fetch(&state->references, 1, __ATOMIC_ACQ_REL) == 0) {
+         RoundState *parent = state->parent;
+         for (int node = 0; state->nodeInputs && node < MAX_NUMA_NODES; node++) {
+             if (state->nodeInputs[node] != state->ownedInput) {
+                 free(state->nodeInputs[node]);
+             }
+         }
+         free(state->nodeInputs);
+         free(state->ownedInput);
+         free(state);
+         state = parent;
+     }
+ }
+ 
+ /*
+  * number of leading pairs tested one by one: all of them with the scalar kernels,
+  * otherwise the first block, because most wrong candidates fail within a few pairs
+  */
+ static int scalarPairCount(void) {
+     if (run->blockPairs == 0 || run->prepared.count < run->blockPairs) {
+         return run->prepared.count;
+     }
+     return run->blockPairs;
+ }
+ 
+ // the smaller of the two vote counts, i.e. the pairs disagreeing with the majority
+ static int minorityCount(int ones, int zeros) {
+     return ones < zeros ? ones : zeros;
  }
  
  /*
-  * processing a valid K0 candidate by searching for K1
+  * scoring a candidate by popcount: the approximation bits of all pairs are gathered
+  * (pair by pair for the leading pairs, then as packed blocks from the batch kernels)
+  * and counted, the candidate is rejected as soon as the minority count exceeds
+  * maxDisagreements, so 0 demands that every block is all zeros or all ones,
+  * returns the majority count (agreeing pairs) or 0 if rejected,
+  * the pairs evaluated are added to counters
   */
- static void processKey0Candidate(uint32_t k0) {
-     int numPairs = getPairCount();
+ static int candidateAgreement(int stage, int outer, uint32_t key, const RoundState *state,
+                               int maxDisagreements, SweepCounters *counters) {
+     int numPairs = run->prepared.count;
+     int scalarPairs = scalarPairCount();
+     int approximation = approximationIndex(stage, outer);
+     const uint32_t *input = stateInput(state);
+     int ones = 0;
      
-     for (int innerIdx = 0; innerIdx < INNER_KEY_SPACE; innerIdx++) {
-         uint32_t innerKey = constructInnerKeyCandidate(innerIdx);
-         int firstInner = linearApproxK1Inner(0, innerKey, k0);
-         
-         int allMatch = 1;
-         for (int pairIdx = 1; pairIdx < numPairs && allMatch; pairIdx++) {
-             if (firstInner != linearApproxK1Inner(pairIdx, innerKey, k0)) {
-                 allMatch = 0;
-             }
+     counters->candidates++;
+ 
+     for (int pairIdx = 0; pairIdx < scalarPairs; pairIdx++) {
+         ones += evaluateApprox(approximation, pairIdx, key, input);
+         if (minorityCount(ones, pairIdx + 1 - ones) > maxDisagreements) {
+             counters->pairs += pairIdx + 1;
+             counters->fCalls += pairIdx + 1;
+             return 0;
          }
-         
-         if (allMatch) {
-             for (int outerIdx = 0; outerIdx < OUTER_KEY_SPACE; outerIdx++) {
-                 uint32_t k1 = constructOuterKeyCandidate(outerIdx, innerKey);
-                 int firstOuter = linearApproxK1Outer(0, k0, k1);
-                 
-                 int allMatchOuter = 1;
-                 for (int pairIdx = 1; pairIdx < numPairs && allMatchOuter; pairIdx++) {
-                     if (firstOuter != linearApproxK1Outer(pairIdx, k0, k1)) {
-                         allMatchOuter = 0;
-                     }
-                 }
-                 
-                 if (allMatchOuter) {
-                     processKey1Candidate(k0, k1);
-                 }
-             }
+     }
+ 
+     for (int firstPair = scalarPairs; firstPair < numPairs; firstPair += run->blockPairs) {
+         int count = numPairs - firstPair < run->blockPairs ? numPairs - firstPair : run->blockPairs;
+         uint64_t bits = evaluateApproxBatch(approximation, firstPair, count, key, input);
+         ones += __builtin_popcountll(bits);
+         if (minorityCount(ones, firstPair + count - ones) > maxDisagreements) {
+             counters->pairs += firstPair + count;
+             counters->fCalls += firstPair + count;
+             return 0;
          }
      }
+ 
+     counters->pairs += numPairs;
+     counters->fCalls += numPairs;
+     counters->survivors++;
+     return numPairs - minorityCount(ones, numPairs - ones);
+ }
+ 
+ // merging a task's local counters into the shared per-stage totals
+ static void mergeSweepCounters(int stage, int outer, const SweepCounters *counters) {
+     __atomic_add_fetch(&run->sweepCounters[stage][outer].candidates, counters->candidates, __ATOMIC_RELAXED);
+     __atomic_add_fetch(&run->sweepCounters[stage][outer].pairs, counters->pairs, __ATOMIC_RELAXED);
+     __atomic_add_fetch(&run->sweepCounters[stage][outer].survivors, counters->survivors, __ATOMIC_RELAXED);
+     __atomic_add_fetch(&run->sweepCounters[stage][outer].fCalls, counters->fCalls, __ATOMIC_RELAXED);
+ }
+ 
+ /*
+  * checking if an inner key candidate is consistent across (enough) pairs
+  */
+ static int innerKeyConsistent(int stage, uint32_t innerKey, const RoundState *state,
+                               SweepCounters *counters) {
+     return candidateAgreement(stage, 0, innerKey, state, run->allowedDisagreements, counters) > 0;
+ }
+ 
+ /*
+  * checking if an outer key candidate is consistent across (enough) pairs
+  */
+ static int outerKeyConsistent(int stage, uint32_t key, const RoundState *state,
+                               SweepCounters *counters) {
+     return candidateAgreement(stage, 1, key, state, run->allowedDisagreements, counters) > 0;
  }
  
  /*
-  * processing a valid K1 candidate by searching for K2
+  * split outer search: with the inner key and the low OUTER_LOW_BITS index bits fixed,
+  * a0 = b0⊕b1 and a1 = b2⊕b3 are known, so F's middle output bytes Y1, Y2 are fixed per
+  * pair while the low bit of Y0 depends only on key byte b0 and that of Y3 only on b3,
+  * the outer approximation of a pair is thus byte0Bits(b0) ⊕ byte3Bits(b3),
+  * both tables hold one packed pair bitvector per byte value (maskWords words each)
   */
- static void processKey1Candidate(uint32_t k0, uint32_t k1) {
-     int numPairs = getPairCount();
+ static void buildSplitOuterTables(int stage, const RoundState *state, uint32_t innerKey,
+                                   int lowBits, uint64_t *byte0Bits, uint64_t *byte3Bits) {
+     int words = run->prepared.maskWords;
+     // the same byte differences constructOuterKeyCandidate builds
+     uint8_t a0 = (uint8_t)((((lowBits & 0xF) >> 2) << 6) + ((innerKey >> 16) & 0xFF));
+     uint8_t a1 = (uint8_t)(((lowBits & 0x3) << 6) + ((innerKey >> 8) & 0xFF));
      
-     for (int innerIdx = 0; innerIdx < INNER_KEY_SPACE; innerIdx++) {
-         uint32_t innerKey = constructInnerKeyCandidate(innerIdx);
-         int firstInner = linearApproxK2Inner(0, innerKey, k0, k1);
+     memset(byte0Bits, 0, OUTER_BYTE_VALUES * words * sizeof(uint64_t));
+     memset(byte3Bits, 0, OUTER_BYTE_VALUES * words * sizeof(uint64_t));
+     
+     const uint32_t *input = stateInput(state);
+     for (int pairIdx = 0; pairIdx < run->prepared.count; pairIdx++) {
+         uint8_t x[4];
+         word32ToBytes(input[pairIdx], x);
          
-         int allMatch = 1;
-         for (int pairIdx = 1; pairIdx < numPairs && allMatch; pairIdx++) {
-             if (firstInner != linearApproxK2Inner(pairIdx, innerKey, k0, k1)) {
-                 allMatch = 0;
-             }
-         }
+         uint8_t sum01 = x[0] ^ x[1] ^ a0;
+         uint8_t sum23 = x[2] ^ x[3] ^ a1;
+         uint8_t y1 = SPLIT_SBOX_1(sum01, sum23);
+         uint8_t y2 = SPLIT_SBOX_0(y1, sum23);
+         uint64_t fixedBits = (uint64_t)(fixedTerm(pairIdx, approximationIndex(stage, 1)) ^ (y1 & 1) ^ (y2 & 1));
+         int word = pairIdx / 64;
+         int shift = pairIdx % 64;
          
-         if (allMatch) {
-             for (int outerIdx = 0; outerIdx < OUTER_KEY_SPACE; outerIdx++) {
-                 uint32_t k2 = constructOuterKeyCandidate(outerIdx, innerKey);
-                 int firstOuter = linearApproxK2Outer(0, k0, k1, k2);
-                 
-                 int allMatchOuter = 1;
-                 for (int pairIdx = 1; pairIdx < numPairs && allMatchOuter; pairIdx++) {
-                     if (firstOuter != linearApproxK2Outer(pairIdx, k0, k1, k2)) {
-                         allMatchOuter = 0;
-                     }
-                 }
-                 
-                 if (allMatchOuter) {
-                     processKey2Candidate(k0, k1, k2);
-                 }
-             }
+         for (int value = 0; value < run->outerByteLimit; value++) {
+             uint64_t y0Bit = SPLIT_SBOX_0(x[0] ^ value, y1) & 1;
+             uint64_t y3Bit = SPLIT_SBOX_1(y2, x[3] ^ value) & 1;
+             byte0Bits[value * words + word] |= (y0Bit ^ fixedBits) << shift;
+             byte3Bits[value * words + word] |= y3Bit << shift;
          }
      }
  }
  
  /*
-  * processing a valid K2 candidate by searching for K3
+  * agreement of one (b0, b3) combination from the split tables, the same contract as
+  * candidateAgreement: the majority count, or 0 once more than maxDisagreements
+  * pairs disagree, a whole mask word of pairs is tested per step
   */
- static void processKey2Candidate(uint32_t k0, uint32_t k1, uint32_t k2) {
-     int numPairs = getPairCount();
+ static int splitOuterAgreement(const uint64_t *byte0Row, const uint64_t *byte3Row,
+                                int maxDisagreements, SweepCounters *counters) {
+     int numPairs = run->prepared.count;
+     int ones = 0;
      
-     for (int innerIdx = 0; innerIdx < INNER_KEY_SPACE; innerIdx++) {
-         uint32_t innerKey = constructInnerKeyCandidate(innerIdx);
-         int firstInner = linearApproxK3Inner(0, innerKey, k0, k1, k2); 
-         
-         int allMatch = 1;
-         for (int pairIdx = 1; pairIdx < numPairs && allMatch; pairIdx++) {
-             if (firstInner != linearApproxK3Inner(pairIdx, innerKey, k0, k1, k2)) {
-                 allMatch = 0;
+     counters->candidates++;
+     
+     for (int word = 0; word < run->prepared.maskWords; word++) {
+         int covered = (word + 1) * 64 < numPairs ? (word + 1) * 64 : numPairs;
+         ones += __builtin_popcountll(byte0Row[word] ^ byte3Row[word]);
+         if (minorityCount(ones, covered - ones) > maxDisagreements) {
+             counters->pairs += covered;
+             return 0;
+         }
+     }
+     
+     counters->pairs += numPairs;
+     counters->survivors++;
+     return numPairs - minorityCount(ones, numPairs - ones);
+ }
+ 
+ typedef struct {
+     uint64_t firstWord;  // normalised first mask word of the row
+     int row;             // b0 for rows of the byte 0 table, 256 + b3 for the byte 3 table
+ } SplitRowKey;
+ 
+ static int compareSplitRowKeys(const void *a, const void *b) {
+     const SplitRowKey *left = (const SplitRowKey *)a;
+     const SplitRowKey *right = (const SplitRowKey *)b;
+     if (left->firstWord != right->firstWord) {
+         return left->firstWord < right->firstWord ? -1 : 1;
+     }
+     return left->row - right->row;
+ }
+ 
+ // complementing a row (within the valid pair bits) whenever its first pair bit is set
+ static void normaliseSplitRow(uint64_t *row) {
+     if (!(row[0] & 1)) {
+         return;
+     }
+     for (int word = 0; word < run->prepared.maskWords; word++) {
+         int pairsInWord = run->prepared.count - word * 64 < 64 ? run->prepared.count - word * 64 : 64;
+         row[word] ^= pairsInWord < 64 ? (1ULL << pairsInWord) - 1 : ~0ULL;
+     }
+ }
+ 
+ /*
+  * exact mode shortcut of the split search: with no disagreement allowed byte0Bits(b0) ⊕
+  * byte3Bits(b3) has to be all zeros or all ones, i.e. both rows are equal once normalised
+  * to a clear first bit, so the rows are sorted by their first normalised word and only
+  * runs of equal words are compared, the tables are normalised in place,
+  * writes every consistent combination as (b0 << 8) | b3 and returns how many there are
+  */
+ static int matchSplitOuterExact(uint64_t *byte0Bits, uint64_t *byte3Bits, int *matches,
+                                 SweepCounters *counters) {
+     SplitRowKey keys[2 * OUTER_BYTE_VALUES];
+     int words = run->prepared.maskWords;
+     int rows = 2 * run->outerByteLimit;
+     int matchCount = 0;
+     
+     for (int value = 0; value < run->outerByteLimit; value++) {
+         normaliseSplitRow(&byte0Bits[value * words]);
+         normaliseSplitRow(&byte3Bits[value * words]);
+         keys[2 * value].firstWord = byte0Bits[value * words];
+         keys[2 * value].row = value;
+         keys[2 * value + 1].firstWord = byte3Bits[value * words];
+         keys[2 * value + 1].row = OUTER_BYTE_VALUES + value;
+     }
+     qsort(keys, rows, sizeof(SplitRowKey), compareSplitRowKeys);
+     
+     counters->candidates += run->outerByteLimit * run->outerByteLimit;
+     for (int runStart = 0, runEnd; runStart < rows; runStart = runEnd) {
+         // rows of equal first word, byte 0 rows sort before byte 3 rows
+         int firstByte3 = runStart;
+         for (runEnd = runStart; runEnd < rows &&
+                                 keys[runEnd].firstWord == keys[runStart].firstWord; runEnd++) {
+             if (keys[runEnd].row < OUTER_BYTE_VALUES) {
+                 firstByte3 = runEnd + 1;
              }
          }
          
-         if (allMatch) {
-             for (int outerIdx = 0; outerIdx < OUTER_KEY_SPACE; outerIdx++) {
-                 uint32_t k3 = constructOuterKeyCandidate(outerIdx, innerKey);
-                 int firstOuter = linearApproxK3Outer(0, k0, k1, k2, k3);
-                 
-                 int allMatchOuter = 1;
-                 for (int pairIdx = 1; pairIdx < numPairs && allMatchOuter; pairIdx++) {
-                     if (firstOuter != linearApproxK3Outer(pairIdx, k0, k1, k2, k3)) {
-                         allMatchOuter = 0;
-                     }
-                 }
-                 
-                 if (allMatchOuter) {
-                     processKey3Candidate(k0, k1, k2, k3);
+         for (int left = runStart; left < firstByte3; left++) {
+             int b0 = keys[left].row;
+             for (int right = firstByte3; right < runEnd; right++) {
+                 int b3 = keys[right].row - OUTER_BYTE_VALUES;
+                 counters->pairs += run->prepared.count;
+                 if (words == 1 || memcmp(&byte0Bits[b0 * words + 1], &byte3Bits[b3 * words + 1],
+                                          (words - 1) * sizeof(uint64_t)) == 0) {
+                     matches[matchCount++] = (b0 << 8) | b3;
                  }
              }
          }
      }
+     counters->survivors += matchCount;
+     return matchCount;
+ }
+ 
+ // applying a pair permutation (order[new] = old) to one prepared array
+ static void permuteWords(uint32_t *values, const int *order, uint32_t *scratch) {
+     for (int pairIdx = 0; pairIdx < run->prepared.count; pairIdx++) {
+         scratch[pairIdx] = values[order[pairIdx]];
+     }
+     memcpy(values, scratch, run->prepared.count * sizeof(uint32_t));
  }
  
  /*
-  * processing a valid K3 candidate by deriving K4, K5 and validating the complete key
+  * approximation bits of the K0 inner candidates [rangeStart, rangeEnd) for every pair of
+  * the ordering sample, ranges are whole column words so tasks never share a word
   */
- static void processKey3Candidate(uint32_t k0, uint32_t k1, uint32_t k2, uint32_t k3) {
-     deriveAndValidateKey(k0, k1, k2, k3);
+ static void computeRejectionBits(int rangeStart, int rangeEnd) {
+     enum { CANDIDATE_WORDS = INNER_KEY_SPACE / 64 };
+     
+     for (int candidate = rangeStart; candidate < rangeEnd; candidate++) {
+         uint32_t innerKey = constructInnerKeyCandidate(candidate);
+         for (int pairIdx = 0; pairIdx < run->rejectionSamplePairs; pairIdx++) {
+             uint64_t bit = (uint64_t)(fixedTerm(pairIdx, FIXED_K0_INNER) ^
+                 fealFParity(run->prepared.roundZeroInput[pairIdx] ^ innerKey, run->approximations[FIXED_K0_INNER].outputMask));
+             run->rejectionColumns[(size_t)pairIdx * CANDIDATE_WORDS + candidate / 64] |= bit << (candidate % 64);
+         }
+     }
  }
  
  /*
-  * deriving K4 and K5 from K0-K3, then validating the complete key against all known pairs
+  * adaptive pair ordering calibrated on the K0 inner sweep: the approximation bit of
+  * every pair of a leading sample is computed on the pool for all inner candidates as
+  * one column bitvector per pair, then sample pairs are picked greedily so that each
+  * next pair rejects as many of the still consistent candidates as possible, the order
+  * settles within a few dozen picks, so the pairs after the sample keep file order,
+  * the prepared arrays are rearranged in that order so wrong candidates of all later
+  * sweeps tend to fail within fewer pairs
   */
- static int deriveAndValidateKey(uint32_t k0, uint32_t k1, uint32_t k2, uint32_t k3) {
-     int numPairs = getPairCount();
+ static int reorderPairsByRejections(TaskPool *pool) {
+     enum { CANDIDATE_WORDS = INNER_KEY_SPACE / 64 };
+     int numPairs = run->prepared.count;
+     int samplePairs = numPairs < REORDER_SAMPLE_PAIRS ? numPairs : REORDER_SAMPLE_PAIRS;
+     uint64_t *columns = (uint64_t *)calloc((size_t)samplePairs * CANDIDATE_WORDS, sizeof(uint64_t));
+     uint32_t *scratch = (uint32_t *)malloc(numPairs * sizeof(uint32_t));
+     uint8_t *chosen = (uint8_t *)calloc(samplePairs, sizeof(uint8_t));
+     int *order = (int *)malloc(numPairs * sizeof(int));
+     uint64_t aliveOnes[CANDIDATE_WORDS], aliveZeros[CANDIDATE_WORDS];
      
-    // using the first pair to derive K4 and K5
-     uint32_t pLeft = getPlaintextLeft(0);
-     uint32_t pRight = getPlaintextRight(0);
-     uint32_t cLeft = getCiphertextLeft(0);
-     uint32_t cRight = getCiphertextRight(0);
-     
-     // calculating intermediate values
-     uint32_t y0 = fealFFunction(pLeft ^ pRight ^ k0);
-     uint32_t y1 = fealFFunction(pLeft ^ y0 ^ k1);
-     uint32_t y2 = fealFFunction(pLeft ^ pRight ^ y1 ^ k2);
-     uint32_t y3 = fealFFunction(pLeft ^ y0 ^ y2 ^ k3);
+     if (!columns || !scratch || !chosen || !order) {
+         free(columns);
+         free(scratch);
+         free(chosen);
+         free(order);
+         return 0;
+     }
      
-     // deriving K4 and K5
-     uint32_t k4 = pLeft ^ pRight ^ y1 ^ y3 ^ cLeft;
-     uint32_t k5 = pRight ^ y1 ^ y3 ^ y0 ^ y2 ^ cRight;
+     SearchTask task;
+     memset(&task, 0, sizeof(task));
+     task.kind = TASK_REJECTION_BITS;
+     run->rejectionColumns = columns;
+     run->rejectionSamplePairs = samplePairs;
+     pushRangeTasks(pool, 0, 1, &task, INNER_KEY_SPACE, INNER_TASK_CHUNK);
+     taskPoolRun(pool);
+     run->rejectionColumns = NULL;
      
-     uint32_t fullKey[6] = {k0, k1, k2, k3, k4, k5};
+     // the first pair stays first, the survivors are split by the value they agree on
+     order[0] = 0;
+     chosen[0] = 1;
+     for (int word = 0; word < CANDIDATE_WORDS; word++) {
+         aliveOnes[word] = columns[word];
+         aliveZeros[word] = ~columns[word];
+     }
      
-     // validating against all known pairs
-     uint8_t ciphertextBlock[8];
-     for (int pairIdx = 0; pairIdx < numPairs; pairIdx++) {
-         word32ToBytes(getCiphertextLeft(pairIdx), &ciphertextBlock[0]);
-         word32ToBytes(getCiphertextRight(pairIdx), &ciphertextBlock[4]);
-         fealDecryptBlock(ciphertextBlock, fullKey);
-         uint32_t decryptedLeft = bytesToWord32(&ciphertextBlock[0]);
-         uint32_t decryptedRight = bytesToWord32(&ciphertextBlock[4]);
+     int position = 1;
+     while (position < samplePairs) {
+         int bestPair = -1;
+         int bestRejections = -1;
+         
+         for (int pairIdx = 0; pairIdx < samplePairs; pairIdx++) {
+             if (chosen[pairIdx]) {
+                 continue;
+             }
+             
+             const uint64_t *column = &columns[(size_t)pairIdx * CANDIDATE_WORDS];
+             int rejections = 0;
+             for (int word = 0; word < CANDIDATE_WORDS; word++) {
+                 rejections += __builtin_popcountll(aliveOnes[word] & ~column[word]) +
+                               __builtin_popcountll(aliveZeros[word] & column[word]);
+             }
+             
+             // ties (including "rejects nothing") keep the file order
+             if (rejections > bestRejections) {
+                 bestPair = pairIdx;
+                 bestRejections = rejections;
+             }
+         }
+         
+         // the alive sets only shrink, once no pair rejects anything the rest keep file order
+         if (bestRejections == 0) {
+             for (int pairIdx = 0; pairIdx < samplePairs; pairIdx++) {
+                 if (!chosen[pairIdx]) {
+                     order[position++] = pairIdx;
+                 }
+             }
+             break;
+         }
          
-         if (decryptedLeft != getPlaintextLeft(pairIdx) || 
-             decryptedRight != getPlaintextRight(pairIdx)) {
-             return 0; // validation failed
+         const uint64_t *column = &columns[(size_t)bestPair * CANDIDATE_WORDS];
+         for (int word = 0; word < CANDIDATE_WORDS; word++) {
+             aliveOnes[word] &= column[word];
+             aliveZeros[word] &= ~column[word];
          }
+         order[position++] = bestPair;
+         chosen[bestPair] = 1;
+     }
+     for (int pairIdx = samplePairs; pairIdx < numPairs; pairIdx++) {
+         order[pairIdx] = pairIdx;
      }
      
-     // valid key found - output it
-     printf("0x%08x\t0x%08x\t0x%08x\t0x%08x\t0x%08x\t0x%08x\n",
-            k0, k1, k2, k3, k4, k5);
-     
-     validKeysDiscovered++;
-     
-     if (validKeysDiscovered >= MAX_VALID_KEYS) {
-         clock_t endTime = clock();
-         long elapsedMs = (endTime - attackStartTime) * 1000 / CLOCKS_PER_SEC;
-         printf("\nAttack completed successfully!\n");
-         printf("Found %d valid keys in %ld ms\n", validKeysDiscovered, elapsedMs);
-         exit(0);
+     permuteWords(run->prepared.plaintextLeft, order, scratch);
+     permuteWords(run->prepared.roundZeroInput, order, scratch);
+     for (int pairIdx = 0; pairIdx < numPairs; pairIdx++) {
+         ((uint8_t *)scratch)[pairIdx] = run->prepared.fixedTerms[order[pairIdx]];
      }
+     memcpy(run->prepared.fixedTerms, scratch, numPairs * sizeof(uint8_t));
+     packFixedMasks();
      
+     free(columns);
+     free(scratch);
+     free(chosen);
+     free(order);
      return 1;
  }
  
  /*
-  * main attack function
+  * disagreements a candidate may have and still enter the ranking heap,
+  * tightens as the heap fills with better candidates
   */
- int main(int argc, char **argv) {
-     const char *inputFile = "known.txt";
-     
-     if (argc > 1) {
-         inputFile = argv[1];
-     }
+ static int rankingBound(CandidateHeap *heap) {
+     int threshold = candidateHeapThreshold(heap);
+     int bound = run->prepared.count - threshold;
  
-     printf("FEAL-4 Linear Cryptanalysis Attack\n");
-     printf("===================================\n");
-     printf("Loading plaintext-ciphertext pairs from %s...\n", inputFile);
-     
-     int pairsLoaded = loadKnownPairs(inputFile);
-     
-     if (pairsLoaded == 0) {
-         fprintf(stderr, "Error: No pairs loaded. Check file format.\n");
-         return 1;
+     if (threshold > 0 && bound < run->allowedDisagreements) {
+         return bound;
      }
+     return run->allowedDisagreements;
+ }
  
-     printf("Successfully loaded %d plaintext-ciphertext pairs\n", pairsLoaded);
-     printf("Starting attack...\n\n");
-     
-     attackStartTime = clock();
-     
-     int numPairs = getPairCount();
-     
-     // searching for K0 candidates
-     for (int innerIdx = 0; innerIdx < INNER_KEY_SPACE; innerIdx++) {
-         uint32_t innerKey = constructInnerKeyCandidate(innerIdx);
-         int firstResult = linearApproxK0Inner(0, innerKey);
-         
-         // checking if this inner key candidate is consistent across all pairs
-         int consistent = 1;
-         for (int pairIdx = 1; pairIdx < numPairs && consistent; pairIdx++) {
-             if (firstResult != linearApproxK0Inner(pairIdx, innerKey)) {
-                 consistent = 0;
-             }
-         }
-         
-         if (consistent) {
-             // inner key candidate found, now searching for outer bytes
-             for (int outerIdx = 0; outerIdx < OUTER_KEY_SPACE; outerIdx++) {
-                 uint32_t k0 = constructOuterKeyCandidate(outerIdx, innerKey);
-                 int firstOuter = linearApproxK0Outer(0, k0);
-                 
-                 // checking outer key candidate consistency
-                 int consistentOuter = 1;
-                 for (int pairIdx = 1; pairIdx < numPairs && consistentOuter; pairIdx++) {
-                     if (firstOuter != linearApproxK0Outer(pairIdx, k0)) {
-                         consistentOuter = 0;
-                     }
-                 }
-                 
-                 if (consistentOuter) {
-                     // valid K0 candidate found, continue search
-                     processKey0Candidate(k0);
-                 }
-             }
+ /*
+  * queueing a candidate space as chunk sized copies of a template task,
+  * chunk c goes to worker firstWorker + c * workerStride, every task holds a state reference
+  */
+ static void pushRangeTasks(TaskPool *pool, int firstWorker, int workerStride,
+                            const SearchTask *templateTask, int spaceSize, int chunkSize) {
+     SearchTask task = *templateTask;
+ 
+     for (int start = 0, chunk = 0; start < spaceSize; start += chunkSize, chunk++) {
+         task.rangeStart = start;
+         task.rangeEnd = start + chunkSize;
+         retainRoundState(task.state);
+         if (!taskPoolPush(pool, firstWorker + chunk * workerStride, &task)) {
+             releaseRoundState(task.state);
+             return;
          }
      }
-     
-     // if we reach here, fewer than MAX_VALID_KEYS were found
-     clock_t endTime = clock();
-     long elapsedMs = (endTime - attackStartTime) * 1000 / CLOCKS_PER_SEC;
-     printf("\nAttack completed.\n");
-     printf("Found %d valid keys in %ld ms\n", validKeysDiscovered, elapsedMs);
-     
-     cleanupPairData();
-     
-     return 0;
- }
\ No newline at end of file
+ }
+ 
+ /*
+  * queueing the inner sweep of a stage as INNER_TASK_CHUNK sized tasks
+  */
+ static void pushStageSweep(TaskPool *pool, int firstWorker, int workerStride,
+                            int stage, const uint32_t *prefix, RoundState *state) {
+     SearchTask task;
+     memset(&task, 0, sizeof(task));
+     task.kind = TASK_INNER_SWEEP;
+     task.stage = stage;
+     task.state = state;
+     if (stage > 0) {
+         memcpy(task.prefix, prefix, stage * sizeof(uint32_t));
+     }
+ 
+     pushRangeTasks(pool, firstWorker, workerStride, &task, INNER_KEY_SPACE, INNER_TASK_CHUNK);
+ }
+ 
+ /*
+  * queueing the outer candidates of one inner key, OUTER_TASK_CHUNK sized tasks
+  * for the full sweep or one task per low-bit value for the split search
+  */
+ static void pushOuterRange(TaskPool *pool, int firstWorker, int workerStride, const SearchTask *task) {
+     if (run->splitOuterSearch) {
+         pushRangeTasks(pool, firstWorker, workerStride, task, 1 << OUTER_LOW_BITS, 1);
+     } else {
+         pushRangeTasks(pool, firstWorker, workerStride, task, OUTER_KEY_SPACE, OUTER_TASK_CHUNK);
+     }
+ }
+ 
+ /*
+  * queueing the outer sweep for a consistent inner key
+  */
+ static void pushOuterSweep(TaskPool *pool, int workerId, const SearchTask *parent, uint32_t innerKey) {
+     SearchTask task = *parent;
+     task.kind = TASK_OUTER_SWEEP;
+     task.innerKey = innerKey;
+ 
+     pushOuterRange(pool, workerId, 0, &task);
+ }
+ 
+ /*
+  * handling a consistent outer key: the next stage is queued below it, or the
+  * full key is validated after the last stage, collecting tasks add it to their set instead,
+  * returns 0 if the search has to stop
+  */
+ static int acceptStageKey(TaskPool *pool, int workerId, const SearchTask *task, uint32_t key) {
+     if (task->kind == TASK_OUTER_COLLECT) {
+         if (!candidateSetAdd(task->set, key)) {
+             runError("Memory allocation failed");
+             taskPoolStop(pool);
+             return 0;
+         }
+         return 1;
+     }
+ 
+     if (task->stage == 0 && !shardOwnsKey(key)) {
+         return 1;
+     }
+     
+     if (task->stage == run->keyStages - 1) {
+         uint32_t keys[MAX_KEY_STAGES];
+         memcpy(keys, task->prefix, task->stage * sizeof(uint32_t));
+         keys[task->stage] = key;
+         validateKeyClass(pool, keys);
+         return 1;
+     }
+ 
+     // valid candidate found, caching its round outputs for the next subkey search
+     RoundState *nextState = createRoundState(task->state, key);
+     if (!nextState) {
+         runError("Memory allocation failed");
+         taskPoolStop(pool);
+         return 0;
+     }
+ 
+     uint32_t nextPrefix[MAX_KEY_STAGES - 1];
+     memcpy(nextPrefix, task->prefix, sizeof(nextPrefix));
+     nextPrefix[task->stage] = key;
+     pushStageSweep(pool, workerId, 0, task->stage + 1, nextPrefix, nextState);
+     releaseRoundState(nextState);
+     return 1;
+ }
+ 
+ /*
+  * split outer search of one task: every index of the task range fixes the low
+  * OUTER_LOW_BITS of the outer candidates, whose 2^16 (b0, b3) combinations are then
+  * matched from the two byte tables (sorted and joined in exact mode), scoring tasks
+  * offer to the heap, sweeps accept
+  */
+ static void splitOuterSweep(TaskPool *pool, int workerId, const SearchTask *task) {
+     size_t tableWords = (size_t)OUTER_BYTE_VALUES * run->prepared.maskWords;
+     uint64_t *byte0Bits = (uint64_t *)malloc(2 * tableWords * sizeof(uint64_t));
+     uint64_t *byte3Bits = byte0Bits + tableWords;
+     int exact = !task->heap && run->allowedDisagreements == 0;
+     int *matches = exact ? (int *)malloc(OUTER_BYTE_VALUES * OUTER_BYTE_VALUES * sizeof(int)) : NULL;
+     SweepCounters counters = {0, 0, 0, 0, 0};
+     int running = 1;
+ 
+     if (!byte0Bits || (exact && !matches)) {
+         free(byte0Bits);
+         free(matches);
+         runError("Memory allocation failed");
+         taskPoolStop(pool);
+         return;
+     }
+ 
+     for (int lowBits = task->rangeStart; lowBits < task->rangeEnd && running; lowBits++) {
+         buildSplitOuterTables(task->stage, task->state, task->innerKey, lowBits, byte0Bits, byte3Bits);
+ 
+         if (exact) {
+             int matchCount = matchSplitOuterExact(byte0Bits, byte3Bits, matches, &counters);
+             for (int match = 0; match < matchCount && running; match++) {
+                 int outerIdx = ((matches[match] >> 8) << 12) | ((matches[match] & 0xFF) << 4) | lowBits;
+                 running = acceptStageKey(pool, workerId, task, constructOuterKeyCandidate(outerIdx, task->innerKey)) &&
+                           !taskPoolStopped(pool);
+             }
+             continue;
+         }
+ 
+         for (int b0 = 0; b0 < run->outerByteLimit && running; b0++) {
+             if (taskPoolStopped(pool)) {
+                 running = 0;
+                 break;
+             }
+ 
+             const uint64_t *byte0Row = &byte0Bits[b0 * run->prepared.maskWords];
+             int maxDisagreements = task->heap ? rankingBound(task->heap) : run->allowedDisagreements;
+ 
+             for (int b3 = 0; b3 < run->outerByteLimit; b3++) {
+                 int score = splitOuterAgreement(byte0Row, &byte3Bits[b3 * run->prepared.maskWords],
+                                                 maxDisagreements, &counters);
+                 if (score == 0) {
+                     continue;
+                 }
+ 
+                 uint32_t key = constructOuterKeyCandidate((b0 << 12) | (b3 << 4) | lowBits, task->innerKey);
+                 if (task->heap) {
+                     candidateHeapOffer(task->heap, score, key);
+                 } else if (!acceptStageKey(pool, workerId, task, key)) {
+                     running = 0;
+                     break;
+                 }
+             }
+         }
+     }
+ 
+     mergeSweepCounters(task->stage, 1, &counters);
+     free(byte0Bits);
+     free(matches);
+ }
+ 
+ /*
+  * ranked mode: scoring a candidate range into the task's heap
+  */
+ static void scoreSearchRange(TaskPool *pool, const SearchTask *task) {
+     int outer = task->kind == TASK_OUTER_SCORE;
+     SweepCounters counters = {0, 0, 0, 0, 0};
+ 
+     for (int candidateIdx = task->rangeStart; candidateIdx < task->rangeEnd; candidateIdx++) {
+         if (candidateIdx % STOP_CHECK_INTERVAL == 0 && taskPoolStopped(pool)) {
+             break;
+         }
+ 
+         if (outer && !searchedOuterIndex(candidateIdx)) {
+             continue;
+         }
+         
+         uint32_t key = outer ? constructOuterKeyCandidate(candidateIdx, task->innerKey)
+                              : constructInnerKeyCandidate(candidateIdx);
+         int score = candidateAgreement(task->stage, outer, key, task->state,
+                                        rankingBound(task->heap), &counters);
+         if (score > 0) {
+             candidateHeapOffer(task->heap, score, key);
+         }
+     }
+     
+     mergeSweepCounters(task->stage, outer, &counters);
+ }
+ 
+ // parity bits of one lead pair row for count prefixes, the scalar kernels one by one
+ static uint64_t leadParityBits(const uint32_t *row, uint32_t key, uint32_t outputMask, int count) {
+     if (run->blockPairs > 0) {
+         return fealFParityBatch(row, key, outputMask, count);
+     }
+     
+     uint64_t bits = 0;
+     for (int lane = 0; lane < count; lane++) {
+         bits |= (uint64_t)fealFParity(row[lane] ^ key, outputMask) << lane;
+     }
+     return bits;
+ }
+ 
+ /*
+  * batched inner sweep of a prefix group: every candidate of the task range is tested on
+  * the leading pairs of up to BATCH_GROUP_PREFIXES prefixes at once (candidate outer loop,
+  * prefixes inner, bit p of a parity word is prefix firstPrefix + p), the few prefixes
+  * still consistent after the leading pairs are checked on all pairs one by one,
+  * consistent inner keys go to the sets of their prefixes
+  */
+ static void batchedInnerSweep(TaskPool *pool, const SearchTask *task) {
+     const PrefixBatch *batch = task->batch;
+     int approximation = approximationIndex(task->stage, 0);
+     uint32_t outputMask = run->approximations[approximation].outputMask;
+     int remaining = batch->count - task->firstPrefix;
+     int groupSize = remaining < BATCH_GROUP_PREFIXES ? remaining : BATCH_GROUP_PREFIXES;
+     uint64_t groupMask = groupSize < 64 ? (1ULL << groupSize) - 1 : ~0ULL;
+     int ones[BATCH_GROUP_PREFIXES];
+     SweepCounters counters = {0, 0, 0, 0, 0};
+     int running = 1;
+     
+     for (int innerIdx = task->rangeStart; innerIdx < task->rangeEnd && running; innerIdx++) {
+         uint32_t innerKey = constructInnerKeyCandidate(innerIdx);
+         uint64_t alive = groupMask;
+         uint64_t firstBits = 0;
+         
+         counters.candidates += groupSize;
+         memset(ones, 0, groupSize * sizeof(int));
+         for (int pairIdx = 0; pairIdx < batch->leadPairs && alive; pairIdx++) {
+             const uint32_t *row = &batch->leadInputs[(size_t)pairIdx * batch->count + task->firstPrefix];
+             uint64_t bits = leadParityBits(row, innerKey, outputMask, groupSize);
+             if (fixedTerm(pairIdx, approximation)) {
+                 bits ^= groupMask;
+             }
+             counters.pairs += __builtin_popcountll(alive);
+             counters.fCalls += groupSize;
+             
+             if (run->allowedDisagreements == 0) {
+                 // exact mode: every pair agrees with the first one
+                 firstBits = pairIdx == 0 ? bits : firstBits;
+                 alive &= ~(bits ^ firstBits);
+                 continue;
+             }
+             for (uint64_t pending = alive; pending; pending &= pending - 1) {
+                 int lane = __builtin_ctzll(pending);
+                 ones[lane] += (int)((bits >> lane) & 1);
+                 if (minorityCount(ones[lane], pairIdx + 1 - ones[lane]) > run->allowedDisagreements) {
+                     alive &= ~(1ULL << lane);
+                 }
+             }
+         }
+         
+         for (uint64_t pending = alive; pending; pending &= pending - 1) {
+             int prefixIdx = task->firstPrefix + __builtin_ctzll(pending);
+             SweepCounters rest = {0, 0, 0, 0, 0};
+             int consistent = candidateAgreement(task->stage, 0, innerKey, batch->states[prefixIdx],
+                                                 run->allowedDisagreements, &rest) > 0;
+             counters.pairs += rest.pairs;
+             counters.fCalls += rest.fCalls;
+             counters.survivors += rest.survivors;
+             if (consistent && !candidateSetAdd(batch->innerSets[prefixIdx], innerKey)) {
+                 runError("Memory allocation failed");
+                 taskPoolStop(pool);
+                 running = 0;
+                 break;
+             }
+         }
+     }
+     
+     mergeSweepCounters(task->stage, 0, &counters);
+ }
+ 
+ /*
+  * searching one task's candidate range: inner sweeps spawn outer sweeps for consistent
+  * inner keys, outer sweeps spawn the next stage for consistent keys or validate the full key
+  */
+ static void runSearchRange(TaskPool *pool, int workerId, const SearchTask *task) {
+     if (run->splitOuterSearch && (task->kind == TASK_OUTER_SWEEP || task->kind == TASK_OUTER_SCORE ||
+                              task->kind == TASK_OUTER_COLLECT)) {
+         splitOuterSweep(pool, workerId, task);
+         return;
+     }
+ 
+     if (task->kind == TASK_INNER_SCORE || task->kind == TASK_OUTER_SCORE) {
+         scoreSearchRange(pool, task);
+         return;
+     }
+     
+     if (task->kind == TASK_INNER_BATCH) {
+         batchedInnerSweep(pool, task);
+         return;
+     }
+ 
+     SweepCounters counters = {0, 0, 0, 0, 0};
+ 
+     if (task->kind == TASK_INNER_SWEEP) {
+         for (int innerIdx = task->rangeStart; innerIdx < task->rangeEnd; innerIdx++) {
+             uint32_t innerKey = constructInnerKeyCandidate(innerIdx);
+             if (innerKeyConsistent(task->stage, innerKey, task->state, &counters)) {
+                 // inner key candidate found, now searching for outer bytes
+                 pushOuterSweep(pool, workerId, task, innerKey);
+             }
+         }
+         mergeSweepCounters(task->stage, 0, &counters);
+         return;
+     }
+ 
+     for (int outerIdx = task->rangeStart; outerIdx < task->rangeEnd; outerIdx++) {
+         if (outerIdx % STOP_CHECK_INTERVAL == 0 && taskPoolStopped(pool)) {
+             break;
+         }
+ 
+         if (!searchedOuterIndex(outerIdx)) {
+             continue;
+         }
+         
+         uint32_t key = constructOuterKeyCandidate(outerIdx, task->innerKey);
+         if (outerKeyConsistent(task->stage, key, task->state, &counters) &&
+             !acceptStageKey(pool, workerId, task, key)) {
+             break;
+         }
+     }
+     
+     mergeSweepCounters(task->stage, 1, &counters);
+ }
+ 
+ /*
+  * pool entry point, tasks are still delivered after a stop so their state references are dropped
+  */
+ static void runSearchTask(TaskPool *pool, int workerId, void *taskData) {
+     SearchTask *task = (SearchTask *)taskData;
+ 
+     // pool threads serve one attack at a time, the thread starting it is worker 0
+     run = (AttackRun *)taskPoolContext(pool);
+     localTerms = run->workerNodes ? &run->termReplicas[run->workerNodes[workerId]] : NULL;
+     
+     if (task->kind == TASK_REJECTION_BITS) {
+         if (!taskPoolStopped(pool)) {
+             computeRejectionBits(task->rangeStart, task->rangeEnd);
+         }
+     } else if (!taskPoolStopped(pool) && run->instrumented) {
+         struct timespec start, end;
+         int outer = task->kind == TASK_OUTER_SWEEP || task->kind == TASK_OUTER_SCORE ||
+                     task->kind == TASK_OUTER_COLLECT;
+         
+         clock_gettime(CLOCK_MONOTONIC, &start);
+         runSearchRange(pool, workerId, task);
+         clock_gettime(CLOCK_MONOTONIC, &end);
+         __atomic_add_fetch(&run->sweepCounters[task->stage][outer].nanoseconds,
+                            (end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec),
+                            __ATOMIC_RELAXED);
+         if (task->kind == TASK_OUTER_COLLECT) {
+             __atomic_add_fetch(&run->progressBatchWorkDone, task->rangeEnd - task->rangeStart, __ATOMIC_RELAXED);
+         }
+     } else if (!taskPoolStopped(pool)) {
+         runSearchRange(pool, workerId, task);
+     }
+     releaseRoundState(task->state);
+ }
+ 
+ /*
+  * bias-ranked search in the style of Matsui's algorithm 2: a stage keeps the rankLimit
+  * best scoring inner keys, then the rankLimit best outer keys over all of them, and
+  * descends into those best first so the right key is usually confirmed first,
+  * every sweep runs on the pool, returns 1 once keyLimit keys are confirmed
+  */
+ static int rankedSearchStage(TaskPool *pool, CandidateHeap *heap, int stage,
+                              const uint32_t *prefix, RoundState *state) {
+     uint32_t *innerKeys = (uint32_t *)malloc(run->rankLimit * sizeof(uint32_t));
+     uint32_t *stageKeys = (uint32_t *)malloc(run->rankLimit * sizeof(uint32_t));
+     
+     if (!innerKeys || !stageKeys) {
+         runError("Memory allocation failed");
+         free(innerKeys);
+         free(stageKeys);
+         return 1;
+     }
+     
+     SearchTask task;
+     memset(&task, 0, sizeof(task));
+     task.kind = TASK_INNER_SCORE;
+     task.stage = stage;
+     task.state = state;
+     task.heap = heap;
+     if (stage > 0) {
+         memcpy(task.prefix, prefix, stage * sizeof(uint32_t));
+     }
+     
+     pushRangeTasks(pool, 0, 1, &task, INNER_KEY_SPACE, INNER_TASK_CHUNK);
+     taskPoolRun(pool);
+     int innerCount = candidateHeapDrain(heap, innerKeys, NULL);
+     
+     task.kind = TASK_OUTER_SCORE;
+     for (int innerIdx = 0; innerIdx < innerCount; innerIdx++) {
+         task.innerKey = innerKeys[innerIdx];
+         pushOuterRange(pool, innerIdx, 1, &task);
+     }
+     taskPoolRun(pool);
+     int stageCount = candidateHeapDrain(heap, stageKeys, NULL);
+     
+     int finished = taskPoolStopped(pool);
+     for (int rank = 0; rank < stageCount && !finished; rank++) {
+         uint32_t key = stageKeys[rank];
+         
+         // the shards take turns on the ranked K0 keys
+         if (stage == 0 && rank % run->shardCount != run->shardIndex) {
+             continue;
+         }
+         
+         if (stage == run->keyStages - 1) {
+             uint32_t keys[MAX_KEY_STAGES];
+             if (stage > 0) {
+                 memcpy(keys, prefix, stage * sizeof(uint32_t));
+             }
+             keys[stage] = key;
+             validateKeyClass(pool, keys);
+             finished = taskPoolStopped(pool);
+             continue;
+         }
+         
+         RoundState *nextState = createRoundState(state, key);
+         if (!nextState) {
+             runError("Memory allocation failed");
+             finished = 1;
+             break;
+         }
+         
+         uint32_t nextPrefix[MAX_KEY_STAGES - 1];
+         if (stage > 0) {
+             memcpy(nextPrefix, prefix, stage * sizeof(uint32_t));
+         }
+         nextPrefix[stage] = key;
+         finished = rankedSearchStage(pool, heap, stage + 1, nextPrefix, nextState);
+         releaseRoundState(nextState);
+     }
+     
+     free(innerKeys);
+     free(stageKeys);
+     return finished;
+ }
+ 
+ /*
+  * milliseconds of wall-clock time elapsed since the attack started
+  */
+ static long elapsedMillis(void) {
+     struct timespec now;
+     clock_gettime(CLOCK_MONOTONIC, &now);
+     return (long)(now.tv_sec - run->attackStartTime.tv_sec) * 1000 +
+            (now.tv_nsec - run->attackStartTime.tv_nsec) / 1000000;
+ }
+ 
+ // accepted key prefixes of one breadth-first level, MAX_KEY_STAGES words per row
+ typedef struct {
+     uint32_t *keys;
+     int count;
+     int capacity;
+ } PrefixFrontier;
+ 
+ static int appendPrefix(PrefixFrontier *frontier, const uint32_t *prefix) {
+     if (frontier->count == frontier->capacity) {
+         int newCapacity = frontier->capacity ? frontier->capacity * 2 : 64;
+         uint32_t *grown = (uint32_t *)realloc(frontier->keys,
+                                               (size_t)newCapacity * MAX_KEY_STAGES * sizeof(uint32_t));
+         if (!grown) {
+             return 0;
+         }
+         frontier->keys = grown;
+         frontier->capacity = newCapacity;
+     }
+     
+     memcpy(&frontier->keys[(size_t)frontier->count * MAX_KEY_STAGES], prefix, MAX_KEY_STAGES * sizeof(uint32_t));
+     frontier->count++;
+     return 1;
+ }
+ 
+ /*
+  * the inner and outer sweeps of a prefix batch on the GPU backend: the round inputs of
+  * all prefixes are uploaded together, one kernel tests every inner candidate of every
+  * prefix and one every outer candidate of the consistent (prefix, inner key) rows, the
+  * survivors fill the same sets as the pool tasks, returns -1 on a device error
+  * (nothing is added to the stage sets then) and 0 if memory ran out
+  */
+ static int sweepPrefixBatchOnGpu(int stage, RoundState **states, CandidateSet **innerSets,
+                                  CandidateSet **stageSets, int batchCount) {
+     const uint32_t *inputs[BFS_BATCH_PREFIXES];
+     const uint32_t *survivors;
+     int innerApproximation = approximationIndex(stage, 0);
+     int outerApproximation = approximationIndex(stage, 1);
+     struct timespec start, end;
+     
+     clock_gettime(CLOCK_MONOTONIC, &start);
+     for (int i = 0; i < batchCount; i++) {
+         inputs[i] = states[i]->input;
+     }
+     if (!gpuSweeperLoadInputs(run->gpuSweeper, inputs, batchCount)) {
+         return -1;
+     }
+     
+     int innerFound = gpuSweeperInner(run->gpuSweeper, innerApproximation, run->approximations[innerApproximation].outputMask,
+                                      run->allowedDisagreements, &survivors);
+     if (innerFound < 0) {
+         return -1;
+     }
+     for (int found = 0; found < innerFound; found++) {
+         if (!candidateSetAdd(innerSets[survivors[2 * found]], survivors[2 * found + 1])) {
+             return 0;
+         }
+     }
+     
+     // the sorted inner sets, prefix by prefix, are the rows of the outer sweep
+     uint32_t *rows = (uint32_t *)malloc(2 * (size_t)(innerFound > 0 ? innerFound : 1) * sizeof(uint32_t));
+     int rowCount = 0;
+     if (!rows) {
+         return 0;
+     }
+     for (int i = 0; i < batchCount; i++) {
+         int innerCount = candidateSetSortUnique(innerSets[i]);
+         for (int innerIdx = 0; innerIdx < innerCount; innerIdx++) {
+             rows[2 * rowCount] = (uint32_t)i;
+             rows[2 * rowCount + 1] = candidateSetKeys(innerSets[i])[innerIdx];
+             rowCount++;
+         }
+     }
+     
+     int outerFound = gpuSweeperOuter(run->gpuSweeper, outerApproximation, run->approximations[outerApproximation].outputMask,
+                                      run->allowedDisagreements, rows, rowCount,
+                                      run->outerByteLimit == OUTER_BYTE_VALUES ? 0 : CLASS_OUTER_INDEX_BITS, &survivors);
+     free(rows);
+     if (outerFound < 0) {
+         return -1;
+     }
+     for (int found = 0; found < outerFound; found++) {
+         if (!candidateSetAdd(stageSets[survivors[2 * found]], survivors[2 * found + 1])) {
+             return 0;
+         }
+     }
+     
+     // the device reports no per-pair work, only candidates and survivors are counted
+     clock_gettime(CLOCK_MONOTONIC, &end);
+     run->sweepCounters[stage][0].candidates += (long long)batchCount * INNER_KEY_SPACE;
+     run->sweepCounters[stage][0].survivors += innerFound;
+     run->bfsStageCounts[stage].innerKeys += rowCount;
+     run->sweepCounters[stage][1].candidates += ((long long)rowCount * run->outerByteLimit * run->outerByteLimit) << OUTER_LOW_BITS;
+     run->sweepCounters[stage][1].survivors += outerFound;
+     run->sweepCounters[stage][1].nanoseconds += (end.tv_sec - start.tv_sec) * 1000000000LL +
+                                            (end.tv_nsec - start.tv_nsec);
+     return 1;
+ }
+ 
+ /*
+  * queueing the batched inner sweeps of a prefix batch, one task per INNER_TASK_CHUNK
+  * candidates and group of BATCH_GROUP_PREFIXES prefixes, returns 0 if memory ran out,
+  * batch->leadInputs is allocated here and freed by the caller
+  */
+ static int pushBatchedInnerSweeps(TaskPool *pool, int stage, PrefixBatch *batch) {
+     // a candidate can only be rejected after more than 2 * allowedDisagreements pairs
+     int leadPairs = run->allowedDisagreements <= BATCH_MAX_DISAGREEMENTS ? BATCH_LEAD_PAIRS + 2 * run->allowedDisagreements : 0;
+     batch->leadPairs = run->prepared.count < leadPairs ? run->prepared.count : leadPairs;
+     batch->leadInputs = (uint32_t *)malloc(((size_t)batch->leadPairs * batch->count + 1) * sizeof(uint32_t));
+     if (!batch->leadInputs) {
+         return 0;
+     }
+     
+     for (int pairIdx = 0; pairIdx < batch->leadPairs; pairIdx++) {
+         for (int prefixIdx = 0; prefixIdx < batch->count; prefixIdx++) {
+             batch->leadInputs[(size_t)pairIdx * batch->count + prefixIdx] = batch->states[prefixIdx]->input[pairIdx];
+         }
+     }
+     
+     SearchTask task;
+     memset(&task, 0, sizeof(task));
+     task.kind = TASK_INNER_BATCH;
+     task.stage = stage;
+     task.batch = batch;
+     for (int group = 0; group * BATCH_GROUP_PREFIXES < batch->count; group++) {
+         task.firstPrefix = group * BATCH_GROUP_PREFIXES;
+         pushRangeTasks(pool, group, 1, &task, INNER_KEY_SPACE, INNER_TASK_CHUNK);
+     }
+     return 1;
+ }
+ 
+ /*
+  * one breadth-first stage for up to BFS_BATCH_PREFIXES prefixes at once: their inner
+  * sweeps run on the pool as batched sweeps over groups of prefixes, then all outer
+  * sweeps of the consistent inner keys,
+  * each prefix collects into its own sets (on the GPU backend if it is enabled, falling
+  * back to the pool for good after a device error), the extended prefixes go to next,
+  * returns 0 if the search has to stop
+  */
+ static int expandPrefixBatch(TaskPool *pool, int stage, const uint32_t *prefixes, int batchCount,
+                              PrefixFrontier *next) {
+     RoundState *states[BFS_BATCH_PREFIXES] = {NULL};
+     CandidateSet *innerSets[BFS_BATCH_PREFIXES] = {NULL};
+     CandidateSet *stageSets[BFS_BATCH_PREFIXES] = {NULL};
+     int running = 1;
+     
+     for (int i = 0; i < batchCount && running; i++) {
+         states[i] = createPrefixRoundState(&prefixes[(size_t)i * MAX_KEY_STAGES], stage);
+         innerSets[i] = candidateSetCreate();
+         stageSets[i] = candidateSetCreate();
+         running = states[i] && innerSets[i] && stageSets[i];
+     }
+     
+     SearchTask task;
+     memset(&task, 0, sizeof(task));
+     task.stage = stage;
+     __atomic_store_n(&run->progressBatchWork, 0, __ATOMIC_RELAXED);
+     __atomic_store_n(&run->progressBatchWorkDone, 0, __ATOMIC_RELAXED);
+     __atomic_store_n(&run->progressBatchPrefixes, batchCount, __ATOMIC_RELAXED);
+     
+     int swept = 0;
+     if (run->gpuSweeper && running) {
+         int status = sweepPrefixBatchOnGpu(stage, states, innerSets, stageSets, batchCount);
+         if (status < 0) {
+             runWarning("GPU sweep failed, the search continues on the CPU");
+             gpuSweeperFree(run->gpuSweeper);
+             run->gpuSweeper = NULL;
+             for (int i = 0; i < batchCount; i++) {
+                 candidateSetFree(innerSets[i]);
+                 innerSets[i] = candidateSetCreate();
+                 running = running && innerSets[i];
+             }
+         }
+         running = running && status != 0;
+         swept = status > 0;
+     }
+     
+     PrefixBatch batch = {states, innerSets, NULL, 0, batchCount};
+     if (running && !swept) {
+         running = pushBatchedInnerSweeps(pool, stage, &batch);
+     }
+     if (running && !swept) {
+         taskPoolRun(pool);
+     }
+     
+     for (int i = 0; i < batchCount && running && !swept; i++) {
+         int innerCount = candidateSetSortUnique(innerSets[i]);
+         task.kind = TASK_OUTER_COLLECT;
+         task.state = states[i];
+         task.set = stageSets[i];
+         memcpy(task.prefix, &prefixes[(size_t)i * MAX_KEY_STAGES], sizeof(task.prefix));
+         for (int innerIdx = 0; innerIdx < innerCount; innerIdx++) {
+             task.innerKey = candidateSetKeys(innerSets[i])[innerIdx];
+             pushOuterRange(pool, i + innerIdx, 1, &task);
+         }
+         run->bfsStageCounts[stage].innerKeys += innerCount;
+         __atomic_add_fetch(&run->progressBatchWork, (long long)innerCount *
+                            (run->splitOuterSearch ? 1 << OUTER_LOW_BITS : OUTER_KEY_SPACE), __ATOMIC_RELAXED);
+     }
+     if (running && !swept) {
+         taskPoolRun(pool);
+     }
+     
+     for (int i = 0; i < batchCount && running; i++) {
+         int keyCount = candidateSetSortUnique(stageSets[i]);
+         uint32_t prefix[MAX_KEY_STAGES];
+         memcpy(prefix, &prefixes[(size_t)i * MAX_KEY_STAGES], sizeof(prefix));
+         
+         for (int keyIdx = 0; keyIdx < keyCount && running; keyIdx++) {
+             prefix[stage] = candidateSetKeys(stageSets[i])[keyIdx];
+             running = appendPrefix(next, prefix);
+         }
+         run->bfsStageCounts[stage].stageKeys += keyCount;
+     }
+     
+     if (!running && !taskPoolStopped(pool)) {
+         runError("Memory allocation failed");
+     }
+     
+     for (int i = 0; i < batchCount; i++) {
+         releaseRoundState(states[i]);
+         candidateSetFree(innerSets[i]);
+         candidateSetFree(stageSets[i]);
+     }
+     free(batch.leadInputs);
+     return running && !taskPoolStopped(pool);
+ }
+ 
+ /*
+  * where a breadth-first search stands: the frontier of the stage being expanded,
+  * how many of its prefixes are done and the next frontier built from them so far
+  */
+ typedef struct {
+     int stage;                  // keyStages once only the validation is left
+     int prefixesDone;
+     int sharded;                // the frontier holds only this shard's prefixes
+     PrefixFrontier frontier;
+     PrefixFrontier next;
+ } BfsProgress;
+ 
+ // checkpoint file: header, stage counts, then the frontier and next prefixes
+ #define CHECKPOINT_MAGIC "FEALCKPT"
+ #define CHECKPOINT_VERSION 4
+ 
+ typedef struct {
+     char magic[8];
+     uint32_t version;
+     uint32_t pairCount;         // the checkpoint belongs to this exact dataset
+     uint32_t pairChecksum;
+     int allowedDisagreements;   // and to these search parameters
+     int rounds;
+     int shardIndex;
+     int shardCount;
+     int keyClassMode;
+     int stage;
+     int prefixesDone;
+     int sharded;
+     int frontierCount;
+     int nextCount;
+ } CheckpointHeader;
+ 
+ static size_t prefixBytes(int count) {
+     return (size_t)count * MAX_KEY_STAGES * sizeof(uint32_t);
+ }
+ 
+ /*
+  * handing the progress to the checkpoint writer if the interval has passed (or always
+  * when forced), only the snapshot copy is made on the search thread
+  */
+ static void saveCheckpoint(const BfsProgress *progress, int force) {
+     long now = elapsedMillis();
+     if (!run->checkpointWriter || (!force && now - run->lastCheckpointMs < run->checkpointIntervalMs)) {
+         return;
+     }
+     
+     CheckpointHeader header;
+     memset(&header, 0, sizeof(header));
+     memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+     header.version = CHECKPOINT_VERSION;
+     header.pairCount = (uint32_t)pairDatasetCount(run->dataset);
+     header.pairChecksum = run->pairFingerprint;
+     header.allowedDisagreements = run->allowedDisagreements;
+     header.rounds = run->keyStages;
+     header.shardIndex = run->shardIndex;
+     header.shardCount = run->shardCount;
+     header.keyClassMode = run->keyClassMode;
+     header.stage = progress->stage;
+     header.prefixesDone = progress->prefixesDone;
+     header.sharded = progress->sharded;
+     header.frontierCount = progress->frontier.count;
+     header.nextCount = progress->next.count;
+     
+     size_t size = sizeof(header) + sizeof(run->bfsStageCounts) +
+                   prefixBytes(header.frontierCount) + prefixBytes(header.nextCount);
+     unsigned char *snapshot = (unsigned char *)malloc(size);
+     if (!snapshot) {
+         return;
+     }
+     
+     unsigned char *cursor = snapshot;
+     memcpy(cursor, &header, sizeof(header));
+     cursor += sizeof(header);
+     memcpy(cursor, run->bfsStageCounts, sizeof(run->bfsStageCounts));
+     cursor += sizeof(run->bfsStageCounts);
+     memcpy(cursor, progress->frontier.keys, prefixBytes(header.frontierCount));
+     cursor += prefixBytes(header.frontierCount);
+     memcpy(cursor, progress->next.keys, prefixBytes(header.nextCount));
+     
+     checkpointWriterSubmit(run->checkpointWriter, snapshot, size);
+     free(snapshot);
+     run->lastCheckpointMs = now;
+ }
+ 
+ static int loadPrefixes(PrefixFrontier *frontier, const unsigned char *data, int count) {
+     for (int prefixIdx = 0; prefixIdx < count; prefixIdx++) {
+         uint32_t prefix[MAX_KEY_STAGES];
+         memcpy(prefix, data + prefixBytes(prefixIdx), sizeof(prefix));
+         if (!appendPrefix(frontier, prefix)) {
+             return 0;
+         }
+     }
+     return 1;
+ }
+ 
+ /*
+  * restoring the progress of an interrupted breadth-first search, the checkpoint has to
+  * come from the same pairs and search parameters, returns 1 on success
+  */
+ static int loadCheckpoint(const char *path, BfsProgress *progress) {
+     size_t size = 0;
+     unsigned char *data = (unsigned char *)checkpointRead(path, &size);
+     CheckpointHeader header;
+     
+     if (!data) {
+         runError("Cannot read checkpoint %s", path);
+         return 0;
+     }
+     
+     int valid = size >= sizeof(header) + sizeof(run->bfsStageCounts);
+     if (valid) {
+         memcpy(&header, data, sizeof(header));
+         valid = memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) == 0 &&
+                 header.version == CHECKPOINT_VERSION &&
+                 header.stage >= 0 && header.stage <= MAX_KEY_STAGES &&
+                 header.frontierCount >= 0 && header.nextCount >= 0 &&
+                 header.prefixesDone >= 0 && header.prefixesDone <= header.frontierCount &&
+                 size == sizeof(header) + sizeof(run->bfsStageCounts) +
+                         prefixBytes(header.frontierCount) + prefixBytes(header.nextCount);
+     }
+     if (!valid) {
+         runError("Invalid checkpoint %s", path);
+         free(data);
+         return 0;
+     }
+     
+     if (header.pairCount != (uint32_t)pairDatasetCount(run->dataset) ||
+         header.pairChecksum != run->pairFingerprint ||
+         header.allowedDisagreements != run->allowedDisagreements || header.rounds != run->keyStages ||
+         header.shardIndex != run->shardIndex || header.shardCount != run->shardCount ||
+         (header.keyClassMode == KEY_CLASSES_OFF) != (run->keyClassMode == KEY_CLASSES_OFF)) {
+         runError("Checkpoint %s belongs to other pairs or search parameters", path);
+         free(data);
+         return 0;
+     }
+     
+     const unsigned char *cursor = data + sizeof(header);
+     memcpy(run->bfsStageCounts, cursor, sizeof(run->bfsStageCounts));
+     cursor += sizeof(run->bfsStageCounts);
+     
+     int loaded = loadPrefixes(&progress->frontier, cursor, header.frontierCount) &&
+                  loadPrefixes(&progress->next, cursor + prefixBytes(header.frontierCount), header.nextCount);
+     if (!loaded) {
+         runError("Memory allocation failed");
+     }
+     
+     progress->stage = header.stage;
+     progress->prefixesDone = header.prefixesDone;
+     progress->sharded = header.sharded;
+     free(data);
+     return loaded;
+ }
+ 
+ /*
+  * keeping every shardCount-th prefix of the frontier, all shards build the same
+  * frontiers up to this point since their order is deterministic
+  */
+ static void shardFrontier(BfsProgress *progress) {
+     PrefixFrontier *frontier = &progress->frontier;
+     int kept = 0;
+     
+     for (int prefixIdx = run->shardIndex; prefixIdx < frontier->count; prefixIdx += run->shardCount) {
+         memmove(&frontier->keys[(size_t)kept * MAX_KEY_STAGES], &frontier->keys[(size_t)prefixIdx * MAX_KEY_STAGES],
+                 MAX_KEY_STAGES * sizeof(uint32_t));
+         kept++;
+     }
+     frontier->count = kept;
+     progress->sharded = 1;
+ }
+ 
+ // current hardware counts, zeros without --hardware-counters
+ static void readHardwareCounters(uint64_t *values) {
+     if (!run->hardwareCounters || !hardwareCountersRead(run->hardwareCounters, values)) {
+         memset(values, 0, HARDWARE_COUNTER_COUNT * sizeof(uint64_t));
+     }
+ }
+ 
+ /*
+  * entering a breadth-first stage (keyStages for the validation) for the progress
+  * reports and the stage timings, hardwareStart receives the counts at entry
+  */
+ static void beginBfsPhase(int stage, int prefixesDone, int prefixCount, uint64_t *hardwareStart) {
+     __atomic_store_n(&run->progressStageStartMs, elapsedMillis(), __ATOMIC_RELAXED);
+     __atomic_store_n(&run->progressPrefixCount, prefixCount, __ATOMIC_RELAXED);
+     __atomic_store_n(&run->progressPrefixesDone, prefixesDone, __ATOMIC_RELAXED);
+     __atomic_store_n(&run->progressStage, stage, __ATOMIC_RELAXED);
+     readHardwareCounters(hardwareStart);
+ }
+ 
+ static void endBfsPhase(int stage, const uint64_t *hardwareStart) {
+     uint64_t hardware[HARDWARE_COUNTER_COUNT];
+     readHardwareCounters(hardware);
+     
+     run->bfsStageTimings[stage].elapsedMs += elapsedMillis() - run->progressStageStartMs;
+     for (int counterIdx = 0; counterIdx < HARDWARE_COUNTER_COUNT; counterIdx++) {
+         run->bfsStageTimings[stage].hardware[counterIdx] += hardware[counterIdx] - hardwareStart[counterIdx];
+     }
+ }
+ 
+ /*
+  * breadth-first search: every stage turns the frontier of accepted prefixes into the
+  * next one in batches, duplicates are dropped per prefix, the complete keys of the
+  * last frontier are then validated, progress is checkpointed between batches,
+  * a sharded search splits the first frontier with a prefix for every shard
+  */
+ static void breadthFirstSearch(TaskPool *pool, BfsProgress *progress) {
+     int running = 1;
+     
+     while (progress->stage < run->keyStages && running) {
+         int stage = progress->stage;
+         if (progress->prefixesDone == 0) {
+             if (!progress->sharded && progress->frontier.count >= run->shardCount) {
+                 shardFrontier(progress);
+             }
+             run->bfsStageCounts[stage].prefixes = progress->frontier.count;
+         }
+         
+         uint64_t hardwareStart[HARDWARE_COUNTER_COUNT];
+         beginBfsPhase(stage, progress->prefixesDone, progress->frontier.count, hardwareStart);
+         
+         while (progress->prefixesDone < progress->frontier.count && running) {
+             int remaining = progress->frontier.count - progress->prefixesDone;
+             int batchCount = remaining < BFS_BATCH_PREFIXES ? remaining : BFS_BATCH_PREFIXES;
+             running = expandPrefixBatch(pool, stage,
+                                         &progress->frontier.keys[(size_t)progress->prefixesDone * MAX_KEY_STAGES],
+                                         batchCount, &progress->next);
+             if (running) {
+                 progress->prefixesDone += batchCount;
+                 __atomic_store_n(&run->progressPrefixesDone, progress->prefixesDone, __ATOMIC_RELAXED);
+                 saveCheckpoint(progress, 0);
+             }
+         }
+         endBfsPhase(stage, hardwareStart);
+         
+         if (running) {
+             free(progress->frontier.keys);
+             progress->frontier = progress->next;
+             memset(&progress->next, 0, sizeof(progress->next));
+             progress->prefixesDone = 0;
+             progress->stage++;
+         }
+     }
+     
+     if (running && !progress->sharded) {
+         shardFrontier(progress);
+     }
+     if (running) {
+         saveCheckpoint(progress, 1);
+     }
+     
+     const PrefixFrontier *complete = &progress->frontier;
+     uint64_t hardwareStart[HARDWARE_COUNTER_COUNT];
+     beginBfsPhase(run->keyStages, 0, complete->count, hardwareStart);
+     for (int keyIdx = 0; keyIdx < complete->count && running && !taskPoolStopped(pool); keyIdx++) {
+         validateKeyClass(pool, &complete->keys[(size_t)keyIdx * MAX_KEY_STAGES]);
+         __atomic_store_n(&run->progressPrefixesDone, keyIdx + 1, __ATOMIC_RELAXED);
+     }
+     endBfsPhase(run->keyStages, hardwareStart);
+ }
+ 
+ /*
+  * deriving the whitening subkeys K(rounds) and K(rounds+1) from the round keys with
+  * one known pair as the basis: X(s+1) = X(s-1) ⊕ F(X(s) ⊕ K(s)) up to X(rounds), then
+  * LN = X(rounds) ⊕ K(rounds) and RN = X(rounds-1) ⊕ X(rounds) ⊕ K(rounds+1)
+  */
+ static void deriveOuterSubkeys(int basisPair, uint32_t *fullKey) {
+     uint32_t pLeft = pairDatasetPlaintextLeft(run->dataset)[basisPair];
+     uint32_t pRight = pairDatasetPlaintextRight(run->dataset)[basisPair];
+     uint32_t cLeft = pairDatasetCiphertextLeft(run->dataset)[basisPair];
+     uint32_t cRight = pairDatasetCiphertextRight(run->dataset)[basisPair];
+     uint32_t previousInput = pLeft;       // X(-1)
+     uint32_t input = pLeft ^ pRight;      // X(0)
+     
+     for (int stage = 0; stage < run->keyStages; stage++) {
+         uint32_t nextInput = previousInput ^ fealFFunction(input ^ fullKey[stage]);
+         previousInput = input;
+         input = nextInput;
+     }
+     
+     fullKey[run->keyStages] = input ^ cLeft;
+     fullKey[run->keyStages + 1] = previousInput ^ input ^ cRight;
+ }
+ 
+ /*
+  * checking every known pair against the full key, returns 1 if at most allowedDisagreements
+  * pairs fail (0 in the default exact mode), FEAL-4 keys decrypt all pairs at once with the
+  * bitsliced kernels, the other variants encrypt pair by pair
+  */
+ static int decryptsKnownPairs(const uint32_t *fullKey) {
+     if (run->keyStages == FEAL_ROUNDS) {
+         return fealBitslicedDecryptMismatches(run->prepared.cipherSlices, run->prepared.plainSlices, fullKey,
+                                               run->prepared.count, run->allowedDisagreements) <= run->allowedDisagreements;
+     }
+     
+     int mismatches = 0;
+     for (int pairIdx = 0; pairIdx < pairDatasetCount(run->dataset); pairIdx++) {
+         uint32_t halves[2] = {pairDatasetPlaintextLeft(run->dataset)[pairIdx],
+                               pairDatasetPlaintextRight(run->dataset)[pairIdx]};
+         fealEncryptRounds(halves, fullKey, run->keyStages);
+         if ((halves[0] != pairDatasetCiphertextLeft(run->dataset)[pairIdx] ||
+              halves[1] != pairDatasetCiphertextRight(run->dataset)[pairIdx]) &&
+             ++mismatches > run->allowedDisagreements) {
+             return 0;
+         }
+     }
+     return 1;
+ }
+ 
+ /*
+  * first validation tier: encrypting the first allowedDisagreements + VALIDATION_QUICK_PAIRS
+  * pairs other than the basis pair, returns 0 once more than allowedDisagreements of them
+  * fail, wrong keys fail nearly every pair so the full check only sees likely keys
+  */
+ static int encryptsQuickPairs(int basisPair, const uint32_t *fullKey) {
+     int numPairs = pairDatasetCount(run->dataset);
+     int quickPairs = run->allowedDisagreements + VALIDATION_QUICK_PAIRS;
+     int mismatches = 0;
+     
+     for (int pairIdx = 0, checked = 0; pairIdx < numPairs && checked < quickPairs; pairIdx++) {
+         if (pairIdx == basisPair) {
+             continue;
+         }
+         
+         uint32_t halves[2] = {pairDatasetPlaintextLeft(run->dataset)[pairIdx],
+                               pairDatasetPlaintextRight(run->dataset)[pairIdx]};
+         fealEncryptRounds(halves, fullKey, run->keyStages);
+         if ((halves[0] != pairDatasetCiphertextLeft(run->dataset)[pairIdx] ||
+              halves[1] != pairDatasetCiphertextRight(run->dataset)[pairIdx]) &&
+             ++mismatches > run->allowedDisagreements) {
+             return 0;
+         }
+         checked++;
+     }
+     return 1;
+ }
+ 
+ /*
+  * deriving the whitening subkeys from the round keys, then validating the complete key in tiers, a few pairs
+  * by forward encryption and then all known pairs at once, with noisy data the basis pair
+  * itself may be corrupted so up to allowedDisagreements + 1 pairs are tried as the basis
+  */
+ static int deriveAndValidateKey(TaskPool *pool, const uint32_t *keys) {
+     int numPairs = pairDatasetCount(run->dataset);
+     int basisPairs = run->allowedDisagreements + 1 < numPairs ? run->allowedDisagreements + 1 : numPairs;
+     uint32_t fullKey[MAX_KEY_WORDS];
+     int confirmed = 0;
+     
+     memcpy(fullKey, keys, run->keyStages * sizeof(uint32_t));
+     
+     for (int basisPair = 0; basisPair < basisPairs && !confirmed; basisPair++) {
+         deriveOuterSubkeys(basisPair, fullKey);
+         __atomic_add_fetch(&run->validationCounters.derived, 1, __ATOMIC_RELAXED);
+         if (!encryptsQuickPairs(basisPair, fullKey)) {
+             continue;
+         }
+         __atomic_add_fetch(&run->validationCounters.quickPassed, 1, __ATOMIC_RELAXED);
+         confirmed = decryptsKnownPairs(fullKey);
+     }
+     
+     if (!confirmed) {
+         return 0;
+     }
+     __atomic_add_fetch(&run->validationCounters.confirmed, 1, __ATOMIC_RELAXED);
+     
+     // valid key found - claiming one of the keyLimit report slots, then storing and reporting it
+     int discovered = __atomic_load_n(&run->validKeysDiscovered, __ATOMIC_RELAXED);
+     while (discovered < run->keyLimit &&
+            !__atomic_compare_exchange_n(&run->validKeysDiscovered, &discovered, discovered + 1, 1,
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+         // discovered was reloaded with the current count
+     }
+     if (discovered >= run->keyLimit) {
+         return 0;
+     }
+     
+     memcpy(&run->foundKeys[(size_t)discovered * MAX_KEY_WORDS], fullKey, sizeof(fullKey));
+     if (run->keyReporter) {
+         run->keyReporter(run->keyContext, fullKey, run->keyStages + 2);
+     }
+     if (discovered + 1 >= run->keyLimit) {
+         // all workers stop once keyLimit keys are reported
+         taskPoolStop(pool);
+     }
+     return 1;
+ }
+ 
+ // change of the round F output when its subkey moves to another member of the class
+ static uint32_t classDelta(uint32_t flip) {
+     return ((flip & CLASS_FLIP_HIGH) ? CLASS_DELTA_HIGH : 0) | ((flip & CLASS_FLIP_LOW) ? CLASS_DELTA_LOW : 0);
+ }
+ 
+ /*
+  * validating the class of a representative K0..K(rounds-1): the representative first, then
+  * every other member unless only representatives are printed, moving Ks to an equivalent
+  * changes X(s+1) by classDelta, which K(s+1), K(s+3), ... absorb (the whitening subkeys
+  * are derived again), returns the number of keys reported
+  */
+ static int validateKeyClass(TaskPool *pool, const uint32_t *keys) {
+     static const uint32_t flips[4] = {0, CLASS_FLIP_HIGH, CLASS_FLIP_LOW, CLASS_FLIP_HIGH ^ CLASS_FLIP_LOW};
+     int reported = deriveAndValidateKey(pool, keys);
+     int members = 1 << (2 * run->keyStages);
+     
+     if (!reported || run->keyClassMode != KEY_CLASSES_EXPAND) {
+         return reported;
+     }
+     
+     for (int member = 1; member < members && !taskPoolStopped(pool); member++) {
+         uint32_t memberKeys[MAX_KEY_STAGES];
+         memcpy(memberKeys, keys, run->keyStages * sizeof(uint32_t));
+         
+         for (int stage = 0; stage < run->keyStages; stage++) {
+             uint32_t flip = flips[(member >> (2 * (run->keyStages - 1 - stage))) & 3];
+             memberKeys[stage] ^= flip;
+             for (int later = stage + 1; later < run->keyStages; later += 2) {
+                 memberKeys[later] ^= classDelta(flip);
+             }
+         }
+         reported += deriveAndValidateKey(pool, memberKeys);
+     }
+     return reported;
+ }
+ 
+ /*
+  * progress line on stderr, called from the monitor thread every --progress seconds,
+  * the breadth-first search knows how many prefixes of the stage are left and
+  * extrapolates the stage's remaining time, the depth-first and ranked searches do not
+  */
+ static void reportProgress(void *context) {
+     long nowMs = elapsedMillis();
+     long long candidates = 0;
+     char position[96] = "";
+     char eta[48] = "";
+     run = (AttackRun *)context;
+     
+     for (int stage = 0; stage < run->keyStages; stage++) {
+         for (int outer = 0; outer < 2; outer++) {
+             candidates += __atomic_load_n(&run->sweepCounters[stage][outer].candidates, __ATOMIC_RELAXED);
+         }
+     }
+     
+     int stage = __atomic_load_n(&run->progressStage, __ATOMIC_RELAXED);
+     if (stage >= 0) {
+         int done = __atomic_load_n(&run->progressPrefixesDone, __ATOMIC_RELAXED);
+         int count = __atomic_load_n(&run->progressPrefixCount, __ATOMIC_RELAXED);
+         long stageMs = nowMs - __atomic_load_n(&run->progressStageStartMs, __ATOMIC_RELAXED);
+         
+         double finished = done;
+         
+         if (stage < run->keyStages) {
+             // the batch in flight counts by the share of its outer ranges already swept
+             long long work = __atomic_load_n(&run->progressBatchWork, __ATOMIC_RELAXED);
+             long long workDone = __atomic_load_n(&run->progressBatchWorkDone, __ATOMIC_RELAXED);
+             if (work > 0 && workDone < work) {
+                 finished += __atomic_load_n(&run->progressBatchPrefixes, __ATOMIC_RELAXED) * (double)workDone / work;
+             }
+             snprintf(position, sizeof(position), "K%d %d of %d prefixes (%.1f%%), ", stage, done, count,
+                      count > 0 ? 100.0 * finished / count : 0.0);
+         } else {
+             snprintf(position, sizeof(position), "validation %d of %d keys, ", done, count);
+         }
+         if (finished > 0 && finished < count) {
+             snprintf(eta, sizeof(eta), ", stage ETA %.1f s", stageMs * (count - finished) / finished / 1000.0);
+         }
+     }
+     
+     fprintf(stderr, "Progress %.1f s: %s%lld candidates (%.0f/s), %d keys%s\n", nowMs / 1000.0, position,
+             candidates, nowMs > 0 ? candidates * 1000.0 / nowMs : 0.0,
+             __atomic_load_n(&run->validKeysDiscovered, __ATOMIC_RELAXED), eta);
+ }
+ 
+ /*
+  * opening the hardware counters and starting the progress reports of a run,
+  * before the workers are created so the counters include them
+  */
+ static ProgressMonitor *startInstrumentation(int wantHardwareCounters) {
+     ProgressMonitor *monitor = NULL;
+     
+     if (wantHardwareCounters) {
+         run->hardwareCounters = hardwareCountersOpen();
+         if (!run->hardwareCounters) {
+             runWarning("Hardware counters are unavailable (perf events), continuing without");
+         }
+     }
+     if (run->progressIntervalMs > 0) {
+         monitor = progressMonitorCreate(run->progressIntervalMs, reportProgress, run);
+         if (!monitor) {
+             runWarning("Cannot start the progress reports");
+         }
+     }
+     return monitor;
+ }
+ 
+ typedef struct {
+     const PreparedPairs *source;
+     PairTermReplica *replica;
+ } ReplicaCopy;
+ 
+ // filling one node's copy of the pair data on a thread pinned to that node
+ static void *copyPairTerms(void *context) {
+     const PreparedPairs *source = ((ReplicaCopy *)context)->source;
+     PairTermReplica *replica = ((ReplicaCopy *)context)->replica;
+     size_t maskBytes = (size_t)APPROXIMATION_COUNT * source->maskWords * sizeof(uint64_t);
+     
+     replica->fixedTerms = (uint8_t *)malloc(source->count * sizeof(uint8_t));
+     replica->fixedMasks = (uint64_t *)malloc(maskBytes);
+     replica->plaintextLeft = (uint32_t *)malloc(source->count * sizeof(uint32_t));
+     replica->roundZeroInput = (uint32_t *)malloc(source->count * sizeof(uint32_t));
+     if (replica->fixedTerms && replica->fixedMasks && replica->plaintextLeft && replica->roundZeroInput) {
+         memcpy(replica->fixedTerms, source->fixedTerms, source->count * sizeof(uint8_t));
+         memcpy(replica->fixedMasks, source->fixedMasks, maskBytes);
+         memcpy(replica->plaintextLeft, source->plaintextLeft, source->count * sizeof(uint32_t));
+         memcpy(replica->roundZeroInput, source->roundZeroInput, source->count * sizeof(uint32_t));
+     }
+     return NULL;
+ }
+ 
+ /*
+  * --affinity: pinning worker i to the i-th cpu of the placement order (wrapping around
+  * when there are more workers than cpus) and copying the pair data to every NUMA node
+  * that runs workers, must follow the final pair order, returns 0 on failure
+  */
+ static int placeWorkers(TaskPool *pool, int threadCount, int spread) {
+     int cpus[MAX_PLACED_CPUS];
+     int nodes[MAX_PLACED_CPUS];
+     int cpuCount = topologyCpuOrder(spread, cpus, nodes, MAX_PLACED_CPUS);
+     
+     if (cpuCount == 0) {
+         runError("Cannot read the cpus this process may run on");
+         return 0;
+     }
+     for (int cpuIdx = 0; cpuIdx < cpuCount; cpuIdx++) {
+         if (nodes[cpuIdx] >= MAX_NUMA_NODES) {
+             runWarning("NUMA node %d is beyond the %d supported, the workers are not pinned",
+                        nodes[cpuIdx], MAX_NUMA_NODES);
+             return 1;
+         }
+     }
+     
+     int *workerCpus = (int *)malloc(threadCount * sizeof(int));
+     run->workerNodes = (int *)malloc(threadCount * sizeof(int));
+     if (!workerCpus || !run->workerNodes) {
+         runError("Memory allocation failed");
+         free(workerCpus);
+         return 0;
+     }
+     
+     int nodeCount = 0;
+     for (int worker = 0; worker < threadCount; worker++) {
+         int node = nodes[worker % cpuCount];
+         workerCpus[worker] = cpus[worker % cpuCount];
+         run->workerNodes[worker] = node;
+         if (run->termReplicas[node].fixedTerms) {
+             continue;
+         }
+         
+         run->termReplicas[node].node = node;
+         ReplicaCopy copy = {&run->prepared, &run->termReplicas[node]};
+         if (!topologyRunOnCpu(workerCpus[worker], copyPairTerms, &copy) ||
+             !run->termReplicas[node].fixedTerms || !run->termReplicas[node].fixedMasks ||
+             !run->termReplicas[node].plaintextLeft || !run->termReplicas[node].roundZeroInput) {
+             runError("Cannot copy the pair data to NUMA node %d", node);
+             free(workerCpus);
+             return 0;
+         }
+         nodeCount++;
+     }
+     
+     int pinned = taskPoolSetAffinity(pool, workerCpus);
+     free(workerCpus);
+     if (!pinned) {
+         runError("Cannot pin the worker threads");
+         return 0;
+     }
+     // the calling thread is worker 0, round states it builds between the sweeps live on its node
+     localTerms = &run->termReplicas[run->workerNodes[0]];
+     
+     runReport("Pinned %d workers to %d cpus (%s), pair data copied to %d NUMA nodes\n", threadCount,
+            threadCount < cpuCount ? threadCount : cpuCount, spread ? "spread" : "compact", nodeCount);
+     return 1;
+ }
+ 
+ // the pool of the running search, published for fealAttackCancel
+ static void publishPool(TaskPool *pool) {
+     pthread_mutex_lock(&run->poolLock);
+     run->pool = pool;
+     if (pool && run->cancelRequested) {
+         taskPoolStop(pool);
+     }
+     pthread_mutex_unlock(&run->poolLock);
+ }
+ 
+ // the breadth-first search from the root or from the resumed checkpoint, 0 if it cannot start
+ static int runBreadthFirstAttack(TaskPool *pool) {
+     BfsProgress progress;
+     memset(&progress, 0, sizeof(progress));
+     uint32_t rootPrefix[MAX_KEY_STAGES] = {0};
+     int ready = run->resumeFile ? loadCheckpoint(run->resumeFile, &progress)
+                                 : appendPrefix(&progress.frontier, rootPrefix);
+     
+     if (ready && run->resumeFile) {
+         runReport("Resuming from %s at stage K%d, %d of %d prefixes done\n\n", run->resumeFile,
+                   progress.stage, progress.prefixesDone, progress.frontier.count);
+     } else if (!ready && !run->resumeFile) {
+         runError("Memory allocation failed");
+     }
+     
+     const char *savePath = run->checkpointFile ? run->checkpointFile : run->resumeFile;
+     if (ready && savePath) {
+         run->checkpointWriter = checkpointWriterCreate(savePath);
+         ready = run->checkpointWriter != NULL;
+         if (!ready) {
+             runError("Cannot start checkpoint writer for %s", savePath);
+         }
+     }
+     
+     if (ready) {
+         run->lastCheckpointMs = elapsedMillis();
+         breadthFirstSearch(pool, &progress);
+     }
+     checkpointWriterFree(run->checkpointWriter);
+     run->checkpointWriter = NULL;
+     free(progress.frontier.keys);
+     free(progress.next.keys);
+     return ready;
+ }
+ 
+ // the search of the configured mode on a ready pool, 0 if it cannot start
+ static int runSearch(TaskPool *pool) {
+     RoundState *rootState = createRootRoundState();
+     if (!rootState) {
+         runError("Memory allocation failed");
+         return 0;
+     }
+     
+     if (run->rankLimit > 0) {
+         CandidateHeap *heap = candidateHeapCreate(run->rankLimit);
+         if (heap) {
+             rankedSearchStage(pool, heap, 0, NULL, rootState);
+             candidateHeapFree(heap);
+         } else {
+             runError("Memory allocation failed");
+         }
+         releaseRoundState(rootState);
+         return 1;
+     }
+     
+     if (run->breadthFirst) {
+         releaseRoundState(rootState);
+         return runBreadthFirstAttack(pool);
+     }
+     
+     // searching for K0 candidates, the inner chunks are spread over all workers
+     pushStageSweep(pool, 0, 1, 0, NULL, rootState);
+     releaseRoundState(rootState);
+     taskPoolRun(pool);
+     return 1;
+ }
+ 
+ /*
+  * running the configured attack on the pairs of run->dataset from the calling thread:
+  * the pairs are prepared, the pool (and GPU, placement, checkpoints) started and the
+  * search runs until keyLimit keys are found, the key space is exhausted or the attack
+  * is cancelled, everything but the dataset, the found keys and the hardware counters
+  * (still read by the report) is released again, returns 0 if the search cannot run
+  */
+ static int executeAttack(void) {
+     int pairCount = pairDatasetCount(run->dataset);
+     run->pairFingerprint = pairDatasetChecksum(run->dataset);
+     
+     // the reported time includes preparing and ordering the pairs
+     clock_gettime(CLOCK_MONOTONIC, &run->attackStartTime);
+     if (!preparePairData()) {
+         runError("Memory allocation failed");
+         return 0;
+     }
+     
+     TaskPool *pool = taskPoolCreate(run->threadCount, sizeof(SearchTask), runSearchTask);
+     if (!pool) {
+         runError("Cannot create worker pool");
+         releasePreparedPairs();
+         return 0;
+     }
+     taskPoolSetContext(pool, run);
+     publishPool(pool);
+     
+     run->foundKeys = (uint32_t *)calloc((size_t)run->keyLimit * MAX_KEY_WORDS, sizeof(uint32_t));
+     int searched = run->foundKeys && (!run->reorderPairs || reorderPairsByRejections(pool));
+     if (!searched) {
+         runError("Memory allocation failed");
+     }
+     
+     // majority of at least (1/2 + bias) * pairs, the epsilon keeps 0.5 exact
+     run->allowedDisagreements = (int)(pairCount * (0.5 - run->minimumBias) + 1e-9);
+     if (searched && run->allowedDisagreements > 0) {
+         runReport("Statistical mode: up to %d disagreeing pairs per candidate\n", run->allowedDisagreements);
+     }
+     
+     // the pair order is final here, the device keeps the fixed terms for the whole run
+     if (searched && run->useGpu) {
+         run->gpuSweeper = gpuSweeperCreate();
+         if (!run->gpuSweeper || !gpuSweeperLoadPairs(run->gpuSweeper, run->prepared.fixedTerms, run->prepared.count)) {
+             gpuSweeperFree(run->gpuSweeper);
+             run->gpuSweeper = NULL;
+             searched = 0;
+         } else {
+             runReport("GPU sweeps on %s\n", gpuSweeperDeviceName(run->gpuSweeper));
+         }
+     }
+     
+     if (searched) {
+         runReport("Starting attack with %d threads, %s kernels...\n\n", run->threadCount,
+                   run->blockPairs > 0 ? fealBatchKernelName() : "scalar");
+         if (run->verbose) {
+             fflush(stdout);
+         }
+     }
+     
+     searched = searched && (run->affinity < 0 || placeWorkers(pool, run->threadCount, run->affinity));
+     if (searched) {
+         ProgressMonitor *monitor = startInstrumentation(run->wantHardwareCounters);
+         searched = runSearch(pool);
+         progressMonitorFree(monitor);
+     }
+     
+     publishPool(NULL);
+     gpuSweeperFree(run->gpuSweeper);
+     run->gpuSweeper = NULL;
+     taskPoolFree(pool);
+     releasePreparedPairs();
+     return searched;
+ }
+ 
+ /*
+  * library API (fealattack.h): an attack is an AttackRun with its thread, the calling
+  * thread of fealAttackRun becomes the run's worker 0 like main's thread does
+  */
+ struct FealAttack {
+     AttackRun run;
+     pthread_t thread;
+     int started;                // fealAttackStart created thread, joined by fealAttackWait
+     int ran;                    // an attack runs once
+     int result;
+     long elapsedMs;
+     void (*done)(FealAttack *attack, int result, void *context);
+     void *doneContext;
+ };
+ 
+ // an error of an API call outside the run, kept like the errors of the run
+ static void attackError(FealAttack *attack, const char *format, ...) {
+     va_list arguments;
+     va_start(arguments, format);
+     keepAttackError(&attack->run, format, arguments);
+     va_end(arguments);
+ }
+ 
+ void fealAttackDefaults(FealAttackConfig *config) {
+     memset(config, 0, sizeof(*config));
+     config->rounds = FEAL_ROUNDS;
+     config->minimumBias = 0.5;
+     config->search = FEAL_SEARCH_BREADTH_FIRST;
+     config->keyClasses = FEAL_KEY_CLASSES_EXPAND;
+     config->splitOuterSearch = 1;
+     config->reorderPairs = 1;
+     config->shardCount = 1;
+ }
+ 
+ const char *fealAttackConfigError(const FealAttackConfig *config) {
+     int knownRounds = 0;
+     for (size_t variantIdx = 0; variantIdx < sizeof(variants) / sizeof(variants[0]); variantIdx++) {
+         knownRounds |= variants[variantIdx].rounds == config->rounds;
+     }
+     
+     if (!knownRounds) {
+         return "No approximations for these rounds, 3 and 4 are supported";
+     }
+     if (config->threads < 0) {
+         return "Thread count must not be negative";
+     }
+     if (config->minimumBias <= 0.0 || config->minimumBias > 0.5) {
+         return "Minimum bias must be in (0, 0.5]";
+     }
+     if (config->rankLimit < 0 || config->maxKeys < 0) {
+         return "Rank and key limits must not be negative";
+     }
+     if (config->search != FEAL_SEARCH_BREADTH_FIRST && config->search != FEAL_SEARCH_DEPTH_FIRST) {
+         return "Unknown search order";
+     }
+     if (config->keyClasses < FEAL_KEY_CLASSES_EXPAND || config->keyClasses > FEAL_KEY_CLASSES_OFF) {
+         return "Unknown key class mode";
+     }
+     if (config->shardCount < 1 || config->shardIndex < 0 || config->shardIndex >= config->shardCount) {
+         return "Shard index must be below a positive shard count";
+     }
+     return NULL;
+ }
+ 
+ FealAttack *fealAttackCreate(const FealAttackConfig *config) {
+     if (fealAttackConfigError(config)) {
+         return NULL;
+     }
+     
+     FealAttack *attack = (FealAttack *)calloc(1, sizeof(FealAttack));
+     if (!attack) {
+         return NULL;
+     }
+     
+     AttackRun *settings = &attack->run;
+     initAttackRun(settings);
+     selectVariant(settings, config->rounds);
+     
+     long onlineCpus = sysconf(_SC_NPROCESSORS_ONLN);
+     settings->threadCount = config->threads > 0 ? config->threads : onlineCpus > 0 ? (int)onlineCpus : 1;
+     settings->blockPairs = fealBatchLanes();
+     settings->minimumBias = config->minimumBias;
+     settings->rankLimit = config->rankLimit;
+     if (config->maxKeys > 0 && config->maxKeys < settings->keyLimit) {
+         settings->keyLimit = config->maxKeys;
+     }
+     settings->breadthFirst = config->search == FEAL_SEARCH_BREADTH_FIRST;
+     settings->keyClassMode = config->keyClasses;
+     settings->outerByteLimit = config->keyClasses == FEAL_KEY_CLASSES_OFF ? OUTER_BYTE_VALUES : OUTER_BYTE_VALUES / 2;
+     settings->splitOuterSearch = config->splitOuterSearch;
+     settings->reorderPairs = config->reorderPairs;
+     settings->shardIndex = config->shardIndex;
+     settings->shardCount = config->shardCount;
+     settings->keyReporter = config->keyFound;
+     settings->keyContext = config->context;
+     
+     settings->dataset = pairDatasetCreate();
+     if (!settings->dataset) {
+         fealAttackFree(attack);
+         return NULL;
+     }
+     pairDatasetSetQuiet(settings->dataset, 1);
+     return attack;
+ }
+ 
+ void fealAttackFree(FealAttack *attack) {
+     if (!attack) {
+         return;
+     }
+     if (attack->started) {
+         fealAttackCancel(attack);
+         fealAttackWait(attack);
+     }
+     pairDatasetFree(attack->run.dataset);
+     free(attack->run.foundKeys);
+     pthread_mutex_destroy(&attack->run.poolLock);
+     free(attack);
+ }
+ 
+ int fealAttackLoadFile(FealAttack *attack, const char *path) {
+     if (attack->ran || attack->started) {
+         attackError(attack, "Pairs must be added before the attack runs");
+         return 0;
+     }
+     
+     int held = pairDatasetCount(attack->run.dataset);
+     int loaded = pairDatasetLoadThreaded(attack->run.dataset, path, attack->run.threadCount);
+     if (pairDatasetError(attack->run.dataset)) {
+         attackError(attack, "%s", pairDatasetError(attack->run.dataset));
+         return 0;
+     }
+     if (loaded == held) {
+         attackError(attack, "No pairs in %s", path);
+         return 0;
+     }
+     return loaded;
+ }
+ 
+ int fealAttackAddPairs(FealAttack *attack, const uint32_t *plaintextLeft, const uint32_t *plaintextRight,
+                        const uint32_t *ciphertextLeft, const uint32_t *ciphertextRight, int count) {
+     if (attack->ran || attack->started) {
+         attackError(attack, "Pairs must be added before the attack runs");
+         return 0;
+     }
+     if (count < 0 || !pairDatasetAppendArrays(attack->run.dataset, plaintextLeft, plaintextRight,
+                                               ciphertextLeft, ciphertextRight, count)) {
+         attackError(attack, count < 0 ? "Pair count must not be negative" : "Memory allocation failed");
+         return 0;
+     }
+     return pairDatasetCount(attack->run.dataset);
+ }
+ 
+ int fealAttackRun(FealAttack *attack) {
+     if (attack->ran) {
+         attackError(attack, "The attack already ran");
+         return FEAL_ATTACK_FAILED;
+     }
+     attack->ran = 1;
+     
+     if (pairDatasetCount(attack->run.dataset) == 0) {
+         attackError(attack, "No pairs loaded");
+         attack->result = FEAL_ATTACK_FAILED;
+         return attack->result;
+     }
+     
+     // the thread may have served another attack before, it works for this one now
+     run = &attack->run;
+     localTerms = NULL;
+     
+     int searched = executeAttack();
+     attack->elapsedMs = elapsedMillis();
+     hardwareCountersClose(run->hardwareCounters);
+     run->hardwareCounters = NULL;
+     
+     pthread_mutex_lock(&run->poolLock);
+     int cancelled = run->cancelRequested;
+     pthread_mutex_unlock(&run->poolLock);
+     
+     attack->result = !searched ? FEAL_ATTACK_FAILED : cancelled ? FEAL_ATTACK_CANCELLED : FEAL_ATTACK_COMPLETED;
+     run = NULL;
+     return attack->result;
+ }
+ 
+ static void *attackThreadMain(void *arg) {
+     FealAttack *attack = (FealAttack *)arg;
+     int result = fealAttackRun(attack);
+     
+     if (attack->done) {
+         attack->done(attack, result, attack->doneContext);
+     }
+     return NULL;
+ }
+ 
+ int fealAttackStart(FealAttack *attack, void (*done)(FealAttack *attack, int result, void *context),
+                     void *context) {
+     if (attack->ran || attack->started) {
+         attackError(attack, "The attack already ran");
+         return 0;
+     }
+     
+     attack->done = done;
+     attack->doneContext = context;
+     if (pthread_create(&attack->thread, NULL, attackThreadMain, attack) != 0) {
+         attackError(attack, "Cannot start the attack thread");
+         return 0;
+     }
+     attack->started = 1;
+     return 1;
+ }
+ 
+ int fealAttackWait(FealAttack *attack) {
+     if (attack->started) {
+         pthread_join(attack->thread, NULL);
+         attack->started = 0;
+     }
+     return attack->result;
+ }
+ 
+ void fealAttackCancel(FealAttack *attack) {
+     pthread_mutex_lock(&attack->run.poolLock);
+     attack->run.cancelRequested = 1;
+     if (attack->run.pool) {
+         taskPoolStop(attack->run.pool);
+     }
+     pthread_mutex_unlock(&attack->run.poolLock);
+ }
+ 
+ const char *fealAttackError(const FealAttack *attack) {
+     return __atomic_load_n(&attack->run.errorClaimed, __ATOMIC_ACQUIRE) ? attack->run.error : NULL;
+ }
+ 
+ int fealAttackKeyCount(const FealAttack *attack) {
+     return attack->run.validKeysDiscovered;
+ }
+ 
+ int fealAttackKeyWords(const FealAttack *attack) {
+     return attack->run.keyStages + 2;
+ }
+ 
+ const uint32_t *fealAttackKey(const FealAttack *attack, int index) {
+     if (index < 0 || index >= attack->run.validKeysDiscovered || !attack->run.foundKeys) {
+         return NULL;
+     }
+     return &attack->run.foundKeys[(size_t)index * MAX_KEY_WORDS];
+ }
+ 
+ long fealAttackElapsedMs(const FealAttack *attack) {
+     return attack->elapsedMs;
+ }
+ 
+ // the command line tool, built unless FEAL_ATTACK_LIBRARY
+ #ifndef FEAL_ATTACK_LIBRARY
+ 
+ // confirmed keys go to the sink's writer thread, to stdout unless --output names a file
+ static KeySink *keySink = NULL;
+ static const char *keyOutputFile = NULL;
+ static int keyOutputFormat = 0;     // keySinkParseFormat index, 0 = text lines
+ 
+ static int printStats = 0;
+ 
+ // the command line tool reports every confirmed key to the sink
+ static void writeKeyToSink(void *context, const uint32_t *key, int words) {
+     (void)context;
+     (void)words;
+     keySinkSubmit(keySink, key);
+ }
+ 
+ /*
+  * reporting how many pairs the sweeps evaluated per candidate on average
+  */
+ static void printSweepStatistics(void) {
+     SweepCounters total = {0, 0, 0, 0, 0};
+     
+     printf("\nMean pairs tested per candidate:\n");
+     for (int stage = 0; stage < run->keyStages; stage++) {
+         for (int outer = 0; outer < 2; outer++) {
+             const SweepCounters *counters = &run->sweepCounters[stage][outer];
+             if (counters->candidates > 0) {
+                 printf("  K%d %s: %lld candidates, %.3f pairs each, %lld survivors, %lld F calls, %.2f ms\n",
+                        stage, outer ? "outer" : "inner", counters->candidates,
+                        (double)counters->pairs / counters->candidates, counters->survivors,
+                        counters->fCalls, counters->nanoseconds / 1e6);
+                 total.candidates += counters->candidates;
+                 total.pairs += counters->pairs;
+                 total.fCalls += counters->fCalls;
+                 total.nanoseconds += counters->nanoseconds;
+             }
+         }
+     }
+     
+     if (total.candidates > 0) {
+         printf("  all sweeps: %lld candidates, %.3f pairs each, %lld F calls, %.2f ms of task time\n",
+                total.candidates, (double)total.pairs / total.candidates, total.fCalls,
+                total.nanoseconds / 1e6);
+         printf("  round inputs below accepted subkeys: %lld F calls\n", run->roundStateFCalls);
+         if (run->gpuSweeper) {
+             printf("  GPU sweeps count candidates and survivors only, not pairs or F calls\n");
+         }
+     }
+     
+     if (run->validationCounters.derived > 0) {
+         printf("\nFull keys per validation tier:\n");
+         printf("  derived: %lld, passed %d quick pairs: %lld, passed all pairs: %lld\n",
+                run->validationCounters.derived, run->allowedDisagreements + VALIDATION_QUICK_PAIRS,
+                run->validationCounters.quickPassed, run->validationCounters.confirmed);
+     }
+     
+     if (run->bfsStageCounts[0].prefixes > 0) {
+         printf("\nBreadth-first candidate sets:\n");
+         for (int stage = 0; stage < run->keyStages; stage++) {
+             const StageSetCounts *counts = &run->bfsStageCounts[stage];
+             printf("  K%d: %lld prefixes, %lld inner keys, %lld subkeys, %lld ms\n", stage,
+                    counts->prefixes, counts->innerKeys, counts->stageKeys, run->bfsStageTimings[stage].elapsedMs);
+         }
+         printf("  validation: %lld ms\n", run->bfsStageTimings[run->keyStages].elapsedMs);
+     }
+     
+     uint64_t hardware[HARDWARE_COUNTER_COUNT];
+     if (run->hardwareCounters && hardwareCountersRead(run->hardwareCounters, hardware)) {
+         printf("\nHardware counters: %" PRIu64 " cycles, %" PRIu64 " instructions (%.2f per cycle), "
+                "%" PRIu64 " cache misses\n",
+                hardware[0], hardware[1], hardware[0] ? (double)hardware[1] / hardware[0] : 0.0, hardware[2]);
+         if (run->bfsStageCounts[0].prefixes > 0) {
+             for (int stage = 0; stage <= run->keyStages; stage++) {
+                 const uint64_t *counts = run->bfsStageTimings[stage].hardware;
+                 char label[16];
+                 snprintf(label, sizeof(label), stage < run->keyStages ? "K%d" : "validation", stage);
+                 printf("  %s: %" PRIu64 " cycles, %" PRIu64 " instructions, %" PRIu64 " cache misses\n",
+                        label, counts[0], counts[1], counts[2]);
+             }
+         }
+     }
+ }
+ 
+ /*
+  * machine-readable summary of a finished run for --json, the same counters as --stats,
+  * returns 0 if the file cannot be written
+  */
+ static int writeJsonSummary(const char *path, const char *search, int threadCount, long elapsedMs) {
+     FILE *file = fopen(path, "w");
+     if (!file) {
+         runError("Cannot open file %s", path);
+         return 0;
+     }
+     
+     fprintf(file, "{\n  \"rounds\": %d,\n  \"search\": \"%s\",\n  \"kernel\": \"%s\",\n  \"threads\": %d,\n"
+                   "  \"pairs\": %d,\n  \"allowedDisagreements\": %d,\n  \"keysFound\": %d,\n"
+                   "  \"elapsedMs\": %ld,\n  \"sweeps\": [",
+             run->keyStages, search, run->blockPairs > 0 ? fealBatchKernelName() : "scalar", threadCount,
+             pairDatasetCount(run->dataset), run->allowedDisagreements, run->validKeysDiscovered, elapsedMs);
+     
+     const char *separator = "";
+     for (int stage = 0; stage < run->keyStages; stage++) {
+         for (int outer = 0; outer < 2; outer++) {
+             const SweepCounters *counters = &run->sweepCounters[stage][outer];
+             if (counters->candidates == 0) {
+                 continue;
+             }
+             fprintf(file, "%s\n    {\"stage\": %d, \"sweep\": \"%s\", \"candidates\": %lld, \"survivors\": %lld, "
+                           "\"pairs\": %lld, \"fCalls\": %lld, \"taskMs\": %.3f}",
+                     separator, stage, outer ? "outer" : "inner", counters->candidates, counters->survivors,
+                     counters->pairs, counters->fCalls, counters->nanoseconds / 1e6);
+             separator = ",";
+         }
+     }
+     
+     fprintf(file, "\n  ],\n  \"roundStateFCalls\": %lld,\n"
+                   "  \"validation\": {\"derived\": %lld, \"quickPassed\": %lld, \"confirmed\": %lld},\n"
+                   "  \"breadthFirstStages\": [",
+             run->roundStateFCalls, run->validationCounters.derived, run->validationCounters.quickPassed,
+             run->validationCounters.confirmed);
+     
+     for (int stage = 0; run->bfsStageCounts[0].prefixes > 0 && stage <= run->keyStages; stage++) {
+         const StageTiming *timing = &run->bfsStageTimings[stage];
+         if (stage < run->keyStages) {
+             const StageSetCounts *counts = &run->bfsStageCounts[stage];
+             fprintf(file, "%s\n    {\"stage\": %d, \"prefixes\": %lld, \"innerKeys\": %lld, \"subkeys\": %lld, ",
+                     stage ? "," : "", stage, counts->prefixes, counts->innerKeys, counts->stageKeys);
+         } else {
+             fprintf(file, ",\n    {\"stage\": \"validation\", ");
+         }
+         fprintf(file, "\"elapsedMs\": %lld, \"cycles\": %" PRIu64 ", \"instructions\": %" PRIu64 ", "
+                       "\"cacheMisses\": %" PRIu64 "}",
+                 timing->elapsedMs, timing->hardware[0], timing->hardware[1], timing->hardware[2]);
+     }
+     
+     uint64_t hardware[HARDWARE_COUNTER_COUNT];
+     if (run->hardwareCounters && hardwareCountersRead(run->hardwareCounters, hardware)) {
+         fprintf(file, "\n  ],\n  \"hardwareCounters\": {\"cycles\": %" PRIu64 ", \"instructions\": %" PRIu64 ", "
+                       "\"cacheMisses\": %" PRIu64 "}\n}\n", hardware[0], hardware[1], hardware[2]);
+     } else {
+         fprintf(file, "\n  ],\n  \"hardwareCounters\": null\n}\n");
+     }
+     
+     int written = !ferror(file);
+     if (fclose(file) != 0 || !written) {
+         runError("Cannot write file %s", path);
+         return 0;
+     }
+     return 1;
+ }
+ 
+ /*
+  * one surviving partial key of the streaming search: the inner keys of the first
+  * innerStages stages, the full keys of the first keyStages, and the value every
+  * determined approximation had on the first pair, which all later pairs must reproduce
+  */
+ typedef struct {
+     uint32_t innerKeys[MAX_KEY_STAGES];
+     uint32_t keys[MAX_KEY_STAGES];
+     uint8_t innerStages;
+     uint8_t keyStages;      // innerStages or innerStages - 1
+     uint8_t referenceBits;  // laid out like the fixed terms, bit FIXED_Kn_INNER / FIXED_Kn_OUTER
+     uint8_t reported;
+ } StreamChain;
+ 
+ typedef struct {
+     StreamChain *chains;
+     int count;
+     int capacity;
+ } StreamChainList;
+ 
+ // adding a chain, returns 0 if the list is full (STREAM_MAX_CHAINS) or memory ran out
+ static int appendStreamChain(StreamChainList *list, const StreamChain *chain) {
+     if (list->count >= STREAM_MAX_CHAINS) {
+         return 0;
+     }
+     
+     if (list->count == list->capacity) {
+         int newCapacity = list->capacity ? list->capacity * 2 : 256;
+         StreamChain *grown = (StreamChain *)realloc(list->chains, newCapacity * sizeof(StreamChain));
+         if (!grown) {
+             return 0;
+         }
+         list->chains = grown;
+         list->capacity = newCapacity;
+     }
+     
+     list->chains[list->count++] = *chain;
+     return 1;
+ }
+ 
+ // approximation bits a chain has fixed, in the fixed term layout
+ static uint8_t streamChainBits(const StreamChain *chain) {
+     uint8_t bits = 0;
+     for (int stage = 0; stage < chain->innerStages; stage++) {
+         bits |= (uint8_t)(1 << approximationIndex(stage, 0));
+     }
+     for (int stage = 0; stage < chain->keyStages; stage++) {
+         bits |= (uint8_t)(1 << approximationIndex(stage, 1));
+     }
+     return bits;
+ }
+ 
+ /*
+  * testing a chain against one new pair: the round inputs are recomputed along the chain's
+  * keys and every approximation it has fixed must give the first pair's value again
+  */
+ static int streamChainMatchesPair(const StreamChain *chain, uint32_t pLeft, uint32_t pRight,
+                                   uint32_t cLeft, uint32_t cRight) {
+     uint8_t bits = pairFixedTerms(pLeft, pRight, cLeft, cRight);
+     uint32_t previousInput = pLeft;       // X(-1)
+     uint32_t input = pLeft ^ pRight;      // X(0)
+     
+     for (int stage = 0; stage < chain->innerStages; stage++) {
+         int inner = approximationIndex(stage, 0);
+         bits ^= (uint8_t)(fealFParity(input ^ chain->innerKeys[stage], run->approximations[inner].outputMask) << inner);
+         if (stage == chain->keyStages) {
+             break;
+         }
+         
+         uint32_t output = fealFFunction(input ^ chain->keys[stage]);
+         int outer = approximationIndex(stage, 1);
+         bits ^= (uint8_t)(__builtin_parity(output & run->approximations[outer].outputMask) << outer);
+         uint32_t nextInput = previousInput ^ output;
+         previousInput = input;
+         input = nextInput;
+     }
+     
+     return ((bits ^ chain->referenceBits) & streamChainBits(chain)) == 0;
+ }
+ 
+ /*
+  * growing every incomplete chain by one level over all pairs seen so far (the prepared
+  * pairs): an inner sweep below a full key, a split outer sweep below an inner key,
+  * returns 0 and leaves the list untouched if the next level would not fit
+  */
+ static int expandStreamChains(StreamChainList *list) {
+     StreamChainList next = {NULL, 0, 0};
+     uint64_t *byte0Bits = (uint64_t *)malloc(2 * (size_t)OUTER_BYTE_VALUES * run->prepared.maskWords * sizeof(uint64_t));
+     uint64_t *byte3Bits = byte0Bits + (size_t)OUTER_BYTE_VALUES * run->prepared.maskWords;
+     int *matches = (int *)malloc(OUTER_BYTE_VALUES * OUTER_BYTE_VALUES * sizeof(int));
+     int expanded = byte0Bits && matches;
+     
+     for (int chainIdx = 0; expanded && chainIdx < list->count; chainIdx++) {
+         const StreamChain *chain = &list->chains[chainIdx];
+         int stage = chain->keyStages;
+         
+         if (stage == run->keyStages) {
+             expanded = appendStreamChain(&next, chain);
+             continue;
+         }
+         
+         RoundState *state = createPrefixRoundState(chain->keys, chain->keyStages);
+         if (!state) {
+             expanded = 0;
+             break;
+         }
+         
+         StreamChain child = *chain;
+         SweepCounters counters = {0, 0, 0, 0, 0};
+         int outer = chain->innerStages != stage;
+         if (!outer) {
+             child.innerStages++;
+             for (int innerIdx = 0; expanded && innerIdx < INNER_KEY_SPACE; innerIdx++) {
+                 uint32_t innerKey = constructInnerKeyCandidate(innerIdx);
+                 if (candidateAgreement(stage, 0, innerKey, state, 0, &counters) > 0) {
+                     child.innerKeys[stage] = innerKey;
+                     child.referenceBits = (uint8_t)(chain->referenceBits |
+                         evaluateApprox(approximationIndex(stage, 0), 0, innerKey, state->input) << approximationIndex(stage, 0));
+                     expanded = appendStreamChain(&next, &child);
+                 }
+             }
+         } else {
+             child.keyStages++;
+             for (int lowBits = 0; expanded && lowBits < 1 << OUTER_LOW_BITS; lowBits++) {
+                 buildSplitOuterTables(stage, state, chain->innerKeys[stage], lowBits, byte0Bits, byte3Bits);
+                 int matchCount = matchSplitOuterExact(byte0Bits, byte3Bits, matches, &counters);
+                 for (int match = 0; expanded && match < matchCount; match++) {
+                     int outerIdx = ((matches[match] >> 8) << 12) | ((matches[match] & 0xFF) << 4) | lowBits;
+                     uint32_t key = constructOuterKeyCandidate(outerIdx, chain->innerKeys[stage]);
+                     child.keys[stage] = key;
+                     child.referenceBits = (uint8_t)(chain->referenceBits |
+                         evaluateApprox(approximationIndex(stage, 1), 0, key, state->input) << approximationIndex(stage, 1));
+                     expanded = appendStreamChain(&next, &child);
+                 }
+             }
+         }
+         
+         mergeSweepCounters(stage, outer, &counters);
+         releaseRoundState(state);
+     }
+     
+     free(byte0Bits);
+     free(matches);
+     if (!expanded) {
+         free(next.chains);
+         return 0;
+     }
+     
+     free(list->chains);
+     *list = next;
+     return 1;
+ }
+ 
+ static int streamChainsComplete(const StreamChainList *list) {
+     for (int chainIdx = 0; chainIdx < list->count; chainIdx++) {
+         if (list->chains[chainIdx].keyStages < run->keyStages) {
+             return 0;
+         }
+     }
+     return 1;
+ }
+ 
+ /*
+  * validating the complete chains against every pair seen, confirmed keys are reported
+  * once, chains whose derived key fails are dropped, returns 1 if all chains are reported
+  */
+ static int reportStreamChains(TaskPool *pool, StreamChainList *list) {
+     int kept = 0;
+     int allReported = 1;
+     
+     for (int chainIdx = 0; chainIdx < list->count; chainIdx++) {
+         StreamChain *chain = &list->chains[chainIdx];
+         
+         if (chain->keyStages == run->keyStages && !chain->reported &&
+             pairDatasetCount(run->dataset) >= STREAM_MIN_VALIDATION_PAIRS && !taskPoolStopped(pool)) {
+             // the validation slices have to cover every pair read so far
+             if (run->prepared.count != pairDatasetCount(run->dataset)) {
+                 releasePreparedPairs();
+                 if (!preparePairData()) {
+                     runError("Memory allocation failed");
+                     taskPoolStop(pool);
+                     return 0;
+                 }
+             }
+             if (!validateKeyClass(pool, chain->keys)) {
+                 continue;
+             }
+             chain->reported = 1;
+         }
+         
+         allReported = allReported && chain->reported;
+         list->chains[kept++] = *chain;
+     }
+     
+     list->count = kept;
+     return allReported;
+ }
+ 
+ /*
+  * streaming mode: pairs are read one at a time, every surviving chain is checked against
+  * the new pair only, and small chain lists are expanded by a level (re-sweeping all pairs
+  * seen) once the next level fits into STREAM_MAX_CHAINS, keys are reported as soon as they are
+  * confirmed and reading stops when every survivor is a confirmed key
+  */
+ static void runStreamingAttack(TaskPool *pool, FILE *input) {
+     StreamChainList list = {NULL, 0, 0};
+     StreamChain root;
+     memset(&root, 0, sizeof(root));
+     
+     if (!appendStreamChain(&list, &root)) {
+         runError("Memory allocation failed");
+         return;
+     }
+     
+     int nextExpansion = 2;
+     while (!taskPoolStopped(pool) && pairDatasetReadPairs(run->dataset, input, 1) == 1) {
+         int pairIdx = pairDatasetCount(run->dataset) - 1;
+         uint32_t pLeft = pairDatasetPlaintextLeft(run->dataset)[pairIdx];
+         uint32_t pRight = pairDatasetPlaintextRight(run->dataset)[pairIdx];
+         uint32_t cLeft = pairDatasetCiphertextLeft(run->dataset)[pairIdx];
+         uint32_t cRight = pairDatasetCiphertextRight(run->dataset)[pairIdx];
+         int kept = 0;
+         
+         for (int chainIdx = 0; chainIdx < list.count; chainIdx++) {
+             if (streamChainMatchesPair(&list.chains[chainIdx], pLeft, pRight, cLeft, cRight)) {
+                 list.chains[kept++] = list.chains[chainIdx];
+             }
+         }
+         list.count = kept;
+         
+         if (list.count == 0) {
+             printf("No candidate is consistent with the first %d pairs\n", pairIdx + 1);
+             break;
+         }
+         
+         if (pairIdx + 1 >= nextExpansion && list.count <= STREAM_EXPAND_CHAINS &&
+             !streamChainsComplete(&list)) {
+             releasePreparedPairs();
+             if (!preparePairData()) {
+                 runError("Memory allocation failed");
+                 break;
+             }
+             
+             while (list.count <= STREAM_EXPAND_CHAINS && !streamChainsComplete(&list) &&
+                    expandStreamChains(&list)) {
+                 printf("After %d pairs: %d candidate chains (%ld ms)\n", pairIdx + 1, list.count, elapsedMillis());
+             }
+             nextExpansion = pairIdx + 1 + STREAM_RETRY_PAIRS;
+             fflush(stdout);
+         }
+         
+         if (streamChainsComplete(&list) && reportStreamChains(pool, &list)) {
+             printf("Candidate set collapsed to %d confirmed keys after %d pairs\n",
+                    list.count, pairIdx + 1);
+             break;
+         }
+     }
+     
+     free(list.chains);
+ }
+ 
+ static void printUsage(const char *program) {
+     fprintf(stderr, "Usage: %s [--threads N] [--kernel scalar|sse2|avx2|avx512] [--min-bias B]\n"
+                     "        [--rounds N] [--rank K] [--first-key] [--no-reorder] [--stats]\n"
+                     "        [--outer-search split|full] [--convert OUT] [--verify-checksum]\n"
+                     "        [--stream] [--search bfs|dfs] [--checkpoint FILE] [--resume FILE]\n"
+                     "        [--checkpoint-interval S] [--shard I/N]\n"
+                     "        [--key-classes expand|representatives|off]\n"
+                     "        [--progress S] [--json FILE] [--hardware-counters] [--gpu]\n"
+                     "        [--affinity compact|spread] [--output FILE]\n"
+                     "        [--output-format text|json|binary]\n"
+                     "        [known-pairs-file]\n"
+                     "       %s --merge shard-output...\n"
+                     "  --min-bias B  accept candidates whose approximation bias |p - 1/2| is at\n"
+                     "                least B (0 < B <= 0.5, default 0.5 = all pairs agree)\n"
+                     "  --rank K      keep the K best scoring candidates per stage and explore\n"
+                     "                them best first instead of every consistent candidate\n"
+                     "  --first-key   stop after the first confirmed key instead of reporting\n"
+                     "                every equivalent key\n"
+                     "  --no-reorder  keep the file order of the pairs instead of testing the\n"
+                     "                most discriminating pairs first\n"
+                     "  --stats       report the candidates, survivors, pairs, F calls and time\n"
+                     "                of every stage\n"
+                     "  --outer-search split|full\n"
+                     "                match per-byte tables of the outer key bytes (default) or\n"
+                     "                test every 20-bit outer candidate on its own\n"
+                     "  --convert OUT write the loaded pairs to OUT in the binary pair format\n"
+                     "                and exit, binary files are recognised when loading\n"
+                     "  --verify-checksum\n"
+                     "                check a binary pair file against its stored checksum\n"
+                     "  --stream      read pairs one by one (a pipe or - for stdin) and narrow\n"
+                     "                the surviving candidates with every pair, stops once they\n"
+                     "                are all confirmed keys\n"
+                     "  --search bfs|dfs\n"
+                     "                exhaustive search stage by stage over candidate sets\n"
+                     "                (default) or depth first below every accepted subkey\n"
+                     "  --checkpoint FILE\n"
+                     "                save the search progress to FILE while running\n"
+                     "  --resume FILE continue the search saved in FILE, further progress is\n"
+                     "                saved there too unless --checkpoint names another file\n"
+                     "  --checkpoint-interval S\n"
+                     "                seconds between checkpoints (default 60, 0 = every batch)\n"
+                     "  --shard I/N   search only shard I of N (1 <= I <= N) of the key space, the\n"
+                     "                N runs can go to different machines, save their stdout\n"
+                     "                (not --output) for --merge\n"
+                     "  --merge       combine the saved outputs of all shards of a run\n"
+                     "  --key-classes expand|representatives|off\n"
+                     "                search one key of every class of 256 equivalent keys and\n"
+                     "                print all of them (default) or only that one, or search\n"
+                     "                every equivalent key on its own\n"
+                     "  --rounds N    attack FEAL-N (3 or 4, default 4), the variants differ in the\n"
+                     "                approximations of their stages\n"
+                     "  --progress S  print a progress line with the stage ETA to stderr every\n"
+                     "                S seconds\n"
+                     "  --json FILE   write the run's counters as JSON to FILE at exit\n"
+                     "  --hardware-counters\n"
+                     "                count cycles, instructions and cache misses (perf events)\n"
+                     "                for --stats and --json\n"
+                     "  --gpu         run the breadth-first inner and outer sweeps on the first\n"
+                     "                OpenCL GPU (libOpenCL is loaded at runtime)\n"
+                     "  --affinity compact|spread\n"
+                     "                pin every worker to its own core (SMT siblings last), filling\n"
+                     "                one NUMA node after the other or alternating between them,\n"
+                     "                each node gets its own copy of the pair data\n"
+                     "  --output FILE write only the confirmed keys to FILE, stdout keeps the\n"
+                     "                run report\n"
+                     "  --output-format text|json|binary\n"
+                     "                keys as tab separated lines (default), JSON lines\n"
+                     "                ({\"key\": [...]}) or binary records after a FEALKEYS header,\n"
+                     "                binary needs --output\n",
+             program, program);
+ }
+ 
+ /*
+  * streaming entry point: pairs are read from the file or "-" (stdin) while the search runs
+  */
+ static int streamingMain(const char *inputFile, const char *jsonFile) {
+     FILE *input = strcmp(inputFile, "-") == 0 ? stdin : fopen(inputFile, "r");
+     if (!input) {
+         runError("Cannot open file %s", inputFile);
+         return 1;
+     }
+     
+     run->dataset = pairDatasetCreate();
+     TaskPool *pool = taskPoolCreate(1, sizeof(SearchTask), runSearchTask);
+     int status = 0;
+     
+     run->foundKeys = (uint32_t *)calloc((size_t)run->keyLimit * MAX_KEY_WORDS, sizeof(uint32_t));
+     run->keyReporter = writeKeyToSink;
+     
+     if (run->dataset && pool && run->foundKeys &&
+         !(keySink = keySinkCreate(keyOutputFile, keyOutputFormat, run->keyStages + 2))) {
+         status = 1;
+     } else if (run->dataset && pool && run->foundKeys) {
+         taskPoolSetContext(pool, run);
+         printf("Streaming plaintext-ciphertext pairs from %s...\n\n", inputFile);
+         fflush(stdout);
+         
+         ProgressMonitor *monitor = startInstrumentation(run->wantHardwareCounters);
+         clock_gettime(CLOCK_MONOTONIC, &run->attackStartTime);
+         runStreamingAttack(pool, input);
+         progressMonitorFree(monitor);
+         
+         // the keys are written before the summary below
+         status = keySinkClose(keySink) ? 0 : 1;
+         keySink = NULL;
+         
+         long elapsedMs = elapsedMillis();
+         if (run->validKeysDiscovered >= run->keyLimit) {
+             printf("\nAttack completed successfully!\n");
+         } else {
+             printf("\nAttack completed.\n");
+         }
+         printf("Found %d valid keys from %d pairs in %ld ms\n", run->validKeysDiscovered,
+                pairDatasetCount(run->dataset), elapsedMs);
+         
+         if (printStats) {
+             printSweepStatistics();
+         }
+         if (jsonFile && !writeJsonSummary(jsonFile, "stream", 1, elapsedMs)) {
+             status = 1;
+         }
+     } else {
+         runError("Memory allocation failed");
+         status = 1;
+     }
+     
+     if (input != stdin) {
+         fclose(input);
+     }
+     taskPoolFree(pool);
+     hardwareCountersClose(run->hardwareCounters);
+     releasePreparedPairs();
+     free(run->foundKeys);
+     pairDatasetFree(run->dataset);
+     return status;
+ }
+ 
+ /*
+  * main attack function
+  */
+ int main(int argc, char **argv) {
+     AttackRun attack;
+     const char *inputFile = "known.txt";
+     long onlineCpus = sysconf(_SC_NPROCESSORS_ONLN);
+     const char *kernelName = NULL;
+     const char *convertFile = NULL;
+     int verifyChecksum = 0;
+     int streamMode = 0;
+     int shardGiven = 0;
+     const char *jsonFile = NULL;
+     
+     initAttackRun(&attack);
+     run = &attack;
+     run->threadCount = onlineCpus > 0 ? (int)onlineCpus : 1;
+     run->verbose = 1;
+     
+     for (int argIdx = 1; argIdx < argc; argIdx++) {
+         if (strcmp(argv[argIdx], "--threads") == 0 && argIdx + 1 < argc) {
+             run->threadCount = atoi(argv[++argIdx]);
+             if (run->threadCount < 1) {
+                 fprintf(stderr, "Error: --threads expects a positive count\n");
+                 return 1;
+             }
+         } else if (strcmp(argv[argIdx], "--kernel") == 0 && argIdx + 1 < argc) {
+             kernelName = argv[++argIdx];
+         } else if (strcmp(argv[argIdx], "--min-bias") == 0 && argIdx + 1 < argc) {
+             run->minimumBias = atof(argv[++argIdx]);
+             if (run->minimumBias <= 0.0 || run->minimumBias > 0.5) {
+                 fprintf(stderr, "Error: --min-bias expects a value in (0, 0.5]\n");
+                 return 1;
+             }
+         } else if (strcmp(argv[argIdx], "--rank") == 0 && argIdx + 1 < argc) {
+             run->rankLimit = atoi(argv[++argIdx]);
+             if (run->rankLimit < 1) {
+                 fprintf(stderr, "Error: --rank expects a positive count\n");
+                 return 1;
+             }
+         } else if (strcmp(argv[argIdx], "--rounds") == 0 && argIdx + 1 < argc) {
+             if (!selectVariant(run, atoi(argv[++argIdx]))) {
+                 fprintf(stderr, "Error: No approximations for %s rounds, 3 and 4 are supported\n", argv[argIdx]);
+                 return 1;
+             }
+         } else if (strcmp(argv[argIdx], "--first-key") == 0) {
+             run->keyLimit = 1;
+         } else if (strcmp(argv[argIdx], "--no-reorder") == 0) {
+             run->reorderPairs = 0;
+         } else if (strcmp(argv[argIdx], "--stats") == 0) {
+             printStats = 1;
+         } else if (strcmp(argv[argIdx], "--convert") == 0 && argIdx + 1 < argc) {
+             convertFile = argv[++argIdx];
+         } else if (strcmp(argv[argIdx], "--search") == 0 && argIdx + 1 < argc) {
+             const char *order = argv[++argIdx];
+             if (strcmp(order, "bfs") == 0) {
+                 run->breadthFirst = 1;
+             } else if (strcmp(order, "dfs") == 0) {
+                 run->breadthFirst = 0;
+             } else {
+                 fprintf(stderr, "Error: --search expects bfs or dfs\n");
+                 return 1;
+             }
+         } else if (strcmp(argv[argIdx], "--stream") == 0) {
+             streamMode = 1;
+         } else if (strcmp(argv[argIdx], "--verify-checksum") == 0) {
+             verifyChecksum = 1;
+         } else if (strcmp(argv[argIdx], "--outer-search") == 0 && argIdx + 1 < argc) {
+             const char *mode = argv[++argIdx];
+             if (strcmp(mode, "split") == 0) {
+                 run->splitOuterSearch = 1;
+             } else if (strcmp(mode, "full") == 0) {
+                 run->splitOuterSearch = 0;
+             } else {
+                 fprintf(stderr, "Error: --outer-search expects split or full\n");
+                 return 1;
+             }
+         } else if (strcmp(argv[argIdx], "--shard") == 0 && argIdx + 1 < argc) {
+             char trailing;
+             if (sscanf(argv[++argIdx], "%d/%d%c", &run->shardIndex, &run->shardCount, &trailing) != 2 ||
+                 run->shardCount < 1 || run->shardIndex < 1 || run->shardIndex > run->shardCount) {
+                 fprintf(stderr, "Error: Shard must be given as I/N with 1 <= I <= N\n");
+                 return 1;
+             }
+             run->shardIndex--;
+             shardGiven = 1;
+         } else if (strcmp(argv[argIdx], "--merge") == 0) {
+             if (argIdx + 1 >= argc) {
+                 printUsage(argv[0]);
+                 return 1;
+             }
+             return mergeShardOutputs(argc - argIdx - 1, &argv[argIdx + 1]) ? 0 : 1;
+         } else if (strcmp(argv[argIdx], "--key-classes") == 0 && argIdx + 1 < argc) {
+             const char *mode = argv[++argIdx];
+             if (strcmp(mode, "expand") == 0) {
+                 run->keyClassMode = KEY_CLASSES_EXPAND;
+             } else if (strcmp(mode, "representatives") == 0) {
+                 run->keyClassMode = KEY_CLASSES_REPRESENTATIVES;
+             } else if (strcmp(mode, "off") == 0) {
+                 run->keyClassMode = KEY_CLASSES_OFF;
+             } else {
+                 printUsage(argv[0]);
+                 return 1;
+             }
+             run->outerByteLimit = run->keyClassMode == KEY_CLASSES_OFF ? OUTER_BYTE_VALUES : OUTER_BYTE_VALUES / 2;
+         } else if (strcmp(argv[argIdx], "--checkpoint") == 0 && argIdx + 1 < argc) {
+             run->checkpointFile = argv[++argIdx];
+         } else if (strcmp(argv[argIdx], "--resume") == 0 && argIdx + 1 < argc) {
+             run->resumeFile = argv[++argIdx];
+         } else if (strcmp(argv[argIdx], "--checkpoint-interval") == 0 && argIdx + 1 < argc) {
+             double seconds = atof(argv[++argIdx]);
+             if (seconds < 0) {
+                 fprintf(stderr, "Error: Checkpoint interval must not be negative\n");
+                 return 1;
+             }
+             run->checkpointIntervalMs = (long)(seconds * 1000);
+         } else if (strcmp(argv[argIdx], "--progress") == 0 && argIdx + 1 < argc) {
+             double seconds = atof(argv[++argIdx]);
+             if (seconds <= 0) {
+                 fprintf(stderr, "Error: --progress expects a positive interval in seconds\n");
+                 return 1;
+             }
+             run->progressIntervalMs = seconds * 1000 >= 1 ? (long)(seconds * 1000) : 1;
+         } else if (strcmp(argv[argIdx], "--json") == 0 && argIdx + 1 < argc) {
+             jsonFile = argv[++argIdx];
+         } else if (strcmp(argv[argIdx], "--hardware-counters") == 0) {
+             run->wantHardwareCounters = 1;
+         } else if (strcmp(argv[argIdx], "--gpu") == 0) {
+             run->useGpu = 1;
+         } else if (strcmp(argv[argIdx], "--output") == 0 && argIdx + 1 < argc) {
+             keyOutputFile = argv[++argIdx];
+         } else if (strcmp(argv[argIdx], "--output-format") == 0 && argIdx + 1 < argc) {
+             keyOutputFormat = keySinkParseFormat(argv[++argIdx]);
+             if (keyOutputFormat < 0) {
+                 fprintf(stderr, "Error: --output-format expects text, json or binary\n");
+                 return 1;
+             }
+         } else if (strcmp(argv[argIdx], "--affinity") == 0 && argIdx + 1 < argc) {
+             const char *placement = argv[++argIdx];
+             if (strcmp(placement, "compact") == 0) {
+                 run->affinity = 0;
+             } else if (strcmp(placement, "spread") == 0) {
+                 run->affinity = 1;
+             } else {
+                 fprintf(stderr, "Error: --affinity expects compact or spread\n");
+                 return 1;
+             }
+         } else if (argv[argIdx][0] == '-' && argv[argIdx][1] != '\0') {
+             printUsage(argv[0]);
+             return 1;
+         } else {
+             inputFile = argv[argIdx];
+         }
+     }
+ 
+     if (!kernelName) {
+         run->blockPairs = fealBatchLanes();
+     } else if (strcmp(kernelName, "scalar") != 0) {
+         if (!fealSelectBatchKernel(kernelName)) {
+             fprintf(stderr, "Error: Kernel %s is not available on this CPU\n", kernelName);
+             return 1;
+         }
+         run->blockPairs = fealBatchLanes();
+     }
+ 
+     if (streamMode && (run->rankLimit > 0 || run->minimumBias < 0.5 || convertFile || run->shardCount > 1 ||
+                        run->affinity >= 0)) {
+         fprintf(stderr, "Error: --stream runs the exact search and cannot be combined with\n"
+                         "       --rank, --min-bias, --convert, --shard or --affinity\n");
+         return 1;
+     }
+     
+     if ((run->checkpointFile || run->resumeFile) && (streamMode || run->rankLimit > 0 || !run->breadthFirst || convertFile)) {
+         fprintf(stderr, "Error: --checkpoint and --resume need the breadth-first exhaustive search\n"
+                         "       and cannot be combined with --stream, --rank, --search dfs or --convert\n");
+         return 1;
+     }
+     
+     if (run->useGpu && (streamMode || run->rankLimit > 0 || !run->breadthFirst)) {
+         fprintf(stderr, "Error: --gpu runs the breadth-first sweeps and cannot be combined with\n"
+                         "       --stream, --rank or --search dfs\n");
+         return 1;
+     }
+     
+     // --merge reads the keys, the shard line and the summary from one saved stdout
+     if (keyOutputFile && shardGiven) {
+         fprintf(stderr, "Error: --shard prints its keys with the shard report for --merge and\n"
+                         "       cannot be combined with --output\n");
+         return 1;
+     }
+     
+     if (!keyOutputFile && keyOutputFormat == keySinkParseFormat("binary")) {
+         fprintf(stderr, "Error: --output-format binary needs --output FILE\n");
+         return 1;
+     }
+     
+     run->instrumented = printStats || run->progressIntervalMs > 0 || jsonFile;
+     
+     printf("FEAL-%d Linear Cryptanalysis Attack\n", run->keyStages);
+     printf("===================================\n");
+     
+     if (streamMode) {
+         return streamingMain(inputFile, jsonFile);
+     }
+     
+     printf("Loading plaintext-ciphertext pairs from %s...\n", inputFile);
+     
+     run->dataset = pairDatasetCreate();
+     if (!run->dataset) {
+         fprintf(stderr, "Error: Memory allocation failed\n");
+         return 1;
+     }
+     
+     int pairsLoaded = pairDatasetLoadThreaded(run->dataset, inputFile, run->threadCount);
+     
+     if (pairsLoaded == 0) {
+         fprintf(stderr, "Error: No pairs loaded. Check file format.\n");
+         pairDatasetFree(run->dataset);
+         return 1;
+     }
+ 
+     printf("Successfully loaded %d plaintext-ciphertext pairs\n", pairsLoaded);
+     
+     if (verifyChecksum && !pairDatasetVerifyChecksum(run->dataset)) {
+         fprintf(stderr, "Error: Checksum mismatch in %s\n", inputFile);
+         pairDatasetFree(run->dataset);
+         return 1;
+     }
+     
+     if (convertFile) {
+         int converted = pairDatasetSaveBinary(run->dataset, convertFile);
+         if (converted) {
+             printf("Wrote %d pairs to %s\n", pairsLoaded, convertFile);
+         }
+         pairDatasetFree(run->dataset);
+         return converted ? 0 : 1;
+     }
+     
+     if (shardGiven) {
+         printf("Shard %d/%d\n", run->shardIndex + 1, run->shardCount);
+     }
+     
+     run->keyReporter = writeKeyToSink;
+     keySink = keySinkCreate(keyOutputFile, keyOutputFormat, run->keyStages + 2);
+     if (!keySink) {
+         pairDatasetFree(run->dataset);
+         return 1;
+     }
+     
+     int searched = executeAttack();
+     
+     // the keys are written before the summary below
+     int keysWritten = keySinkClose(keySink);
+     keySink = NULL;
+     
+     if (!searched) {
+         hardwareCountersClose(run->hardwareCounters);
+         pairDatasetFree(run->dataset);
+         return 1;
+     }
+     
+     long elapsedMs = elapsedMillis();
+     if (run->validKeysDiscovered >= run->keyLimit) {
+         printf("\nAttack completed successfully!\n");
+     } else {
+         // fewer keys than requested exist for this data, or ranking pruned them
+         printf("\nAttack completed.\n");
+     }
+     printf("Found %d valid keys in %ld ms\n", run->validKeysDiscovered, elapsedMs);
+     
+     if (printStats) {
+         printSweepStatistics();
+     }
+     
+     const char *search = run->rankLimit > 0 ? "ranked" : run->breadthFirst ? "bfs" : "dfs";
+     int status = !keysWritten || (jsonFile && !writeJsonSummary(jsonFile, search, run->threadCount, elapsedMs)) ? 1 : 0;
+     
+     hardwareCountersClose(run->hardwareCounters);
+     free(run->foundKeys);
+     pairDatasetFree(run->dataset);
+     
+     return status;
+ }
+ 
+ #endif
@@ -0,0 +1,642 @@
+/*
+ * benchmark suite of the cipher and attack kernels: the f-function implementations,
+ * block decryption (scalar, batch and bitsliced), the approximation sweeps as the
+ * attack evaluates them, the pair loader, and end-to-end runs of the attack binary
+ * over known.txt and synthetic datasets, every benchmark is warmed up and repeated
+ * and reports the median and p99 of its repetitions
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+#include "cipher.h"
+
+typedef struct PairDataset PairDataset;
+extern PairDataset *pairDatasetCreate(void);
+extern void pairDatasetFree(PairDataset *dataset);
+extern int pairDatasetLoadThreaded(PairDataset *dataset, const char *filename, int threadCount);
+extern int pairDatasetSaveBinary(const PairDataset *dataset, const char *filename);
+
+extern char **environ;
+
+#define BENCH_INPUTS 4096       // inputs per repetition, fits the l1 cache with the outputs
+#define BENCH_PASSES 200        // passes over the inputs per repetition
+#define BENCH_WARMUP 2          // unmeasured repetitions before the measured ones
+#define BENCH_DEFAULT_REPETITIONS 15
+#define BENCH_PARITY_BLOCK 64   // pairs per parity batch call, as in the attack
+#define BENCH_SWEEP_PAIRS 200   // pairs per candidate in the sweeps, as in known.txt
+#define BENCH_SWEEP_CANDIDATES 1024
+#define BENCH_LOADER_PAIRS 100000
+#define BENCH_MAX_DATASETS 8
+#define BENCH_PATH_LENGTH 256
+
+// the approximation output masks (see attack.c)
+#define MASK_S15 0x00010000u
+#define MASK_S7_15_23_31 0x01010101u
+
+static const char *kernelNames[] = {"avx512", "avx2", "sse2", "vec128"};
+
+// subkeys of the synthetic datasets, any six words give a valid FEAL-4 key
+static const uint32_t benchSubkeys[6] = {
+    0x63cab942, 0x00a0c541, 0x4674095a, 0x64204c03, 0x4b37d10a, 0xd0a24877
+};
+
+typedef uint32_t (*BenchBody)(void *context, uint32_t repetition);
+
+static int repetitions = BENCH_DEFAULT_REPETITIONS;
+
+// results of every body are folded in here so the compiler keeps the measured work
+static volatile uint32_t benchSink;
+
+static double secondsSince(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double left = *(const double *)a;
+    double right = *(const double *)b;
+    return left < right ? -1 : left > right;
+}
+
+// nearest-rank percentile of sorted samples
+static double percentile(const double *sorted, int count, int percent) {
+    int rank = (percent * count + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// nanoseconds in the largest unit that keeps the value above 1
+static void formatDuration(double nanoseconds, char *text, size_t length) {
+    if (nanoseconds >= 1e6) {
+        snprintf(text, length, "%.2f ms", nanoseconds * 1e-6);
+    } else if (nanoseconds >= 1e3) {
+        snprintf(text, length, "%.2f us", nanoseconds * 1e-3);
+    } else {
+        snprintf(text, length, "%.2f ns", nanoseconds);
+    }
+}
+
+/*
+ * timing body after BENCH_WARMUP unmeasured runs, operations is the work of one run,
+ * prints the median and p99 time per operation and the median rate in units per second
+ */
+static void measure(const char *name, BenchBody body, void *context, long long operations, const char *unit) {
+    double *samples = (double *)malloc(repetitions * sizeof(double));
+    if (!samples) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return;
+    }
+
+    for (int run = 0; run < BENCH_WARMUP; run++) {
+        benchSink ^= body(context, (uint32_t)run);
+    }
+
+    for (int run = 0; run < repetitions; run++) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        benchSink ^= body(context, (uint32_t)(BENCH_WARMUP + run));
+        samples[run] = secondsSince(&start) * 1e9 / operations;
+    }
+
+    qsort(samples, repetitions, sizeof(double), compareDoubles);
+    double median = percentile(samples, repetitions, 50);
+    char medianText[32];
+    char p99Text[32];
+    formatDuration(median, medianText, sizeof(medianText));
+    formatDuration(percentile(samples, repetitions, 99), p99Text, sizeof(p99Text));
+    printf("  %-34s %11s/op  p99 %11s   %14.0f %s/s\n", name, medianText, p99Text, 1e9 / median, unit);
+    fflush(stdout);
+    free(samples);
+}
+
+typedef struct {
+    uint32_t (*function)(uint32_t);
+    const uint32_t *inputs;
+    uint32_t outputMask;
+} ScalarContext;
+
+static uint32_t throughputBody(void *context, uint32_t repetition) {
+    const ScalarContext *scalar = (const ScalarContext *)context;
+    uint32_t checksum = 0;
+
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        uint32_t tweak = repetition * BENCH_PASSES + (uint32_t)pass;
+        for (int i = 0; i < BENCH_INPUTS; i++) {
+            checksum += scalar->function(scalar->inputs[i] ^ tweak);
+        }
+    }
+    return checksum;
+}
+
+// every input depends on the previous output, the time per call is the latency
+static uint32_t latencyBody(void *context, uint32_t repetition) {
+    const ScalarContext *scalar = (const ScalarContext *)context;
+    uint32_t value = 0x12345678 ^ repetition;
+
+    for (int i = 0; i < BENCH_PASSES * BENCH_INPUTS; i++) {
+        value = scalar->function(value ^ (uint32_t)i);
+    }
+    return value;
+}
+
+static uint32_t parityBody(void *context, uint32_t repetition) {
+    const ScalarContext *scalar = (const ScalarContext *)context;
+    uint32_t checksum = 0;
+
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        uint32_t tweak = repetition * BENCH_PASSES + (uint32_t)pass;
+        for (int i = 0; i < BENCH_INPUTS; i++) {
+            checksum = (checksum << 1 | checksum >> 31) ^
+                       (uint32_t)fealFParity(scalar->inputs[i] ^ tweak, scalar->outputMask);
+        }
+    }
+    return checksum;
+}
+
+typedef struct {
+    const uint32_t *inputs;
+    uint32_t *outputs;
+} BatchContext;
+
+static uint32_t batchFBody(void *context, uint32_t repetition) {
+    const BatchContext *batch = (const BatchContext *)context;
+    uint32_t checksum = 0;
+
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        fealFFunctionBatch(batch->inputs, repetition * BENCH_PASSES + (uint32_t)pass, batch->outputs, BENCH_INPUTS);
+        checksum += batch->outputs[pass % BENCH_INPUTS];
+    }
+    return checksum;
+}
+
+static void benchFFunction(const uint32_t *inputs, uint32_t *outputs) {
+    ScalarContext arithmetic = {fealFFunctionArithmetic, inputs, 0};
+    ScalarContext table = {fealFFunctionTable, inputs, 0};
+    long long operations = (long long)BENCH_PASSES * BENCH_INPUTS;
+
+    printf("f-function:\n");
+    measure("arithmetic F", throughputBody, &arithmetic, operations, "F");
+    measure("table F", throughputBody, &table, operations, "F");
+    measure("arithmetic F latency", latencyBody, &arithmetic, operations, "F");
+    measure("table F latency", latencyBody, &table, operations, "F");
+
+    ScalarContext parityS15 = {NULL, inputs, MASK_S15};
+    ScalarContext parityS7 = {NULL, inputs, MASK_S7_15_23_31};
+    measure("parity S15", parityBody, &parityS15, operations, "F");
+    measure("parity S7,15,23,31", parityBody, &parityS7, operations, "F");
+
+    for (size_t k = 0; k < sizeof(kernelNames) / sizeof(kernelNames[0]); k++) {
+        if (!fealSelectBatchKernel(kernelNames[k])) {
+            continue;
+        }
+
+        char name[64];
+        BatchContext batch = {inputs, outputs};
+        snprintf(name, sizeof(name), "batch F (%s)", fealBatchKernelName());
+        measure(name, batchFBody, &batch, operations, "F");
+    }
+}
+
+typedef struct {
+    const uint32_t *left;
+    const uint32_t *right;
+    uint32_t *outLeft;
+    uint32_t *outRight;
+    const uint64_t *plainSlices;
+    const uint64_t *cipherSlices;
+} BlockContext;
+
+static uint32_t decryptBlockBody(void *context, uint32_t repetition) {
+    const BlockContext *blocks = (const BlockContext *)context;
+    uint32_t checksum = repetition;
+
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        for (int i = 0; i < BENCH_INPUTS; i++) {
+            uint8_t block[8];
+            for (int byteIdx = 0; byteIdx < 4; byteIdx++) {
+                block[byteIdx] = (uint8_t)(blocks->left[i] >> (24 - 8 * byteIdx));
+                block[4 + byteIdx] = (uint8_t)(blocks->right[i] >> (24 - 8 * byteIdx));
+            }
+            fealDecryptBlock(block, benchSubkeys);
+            checksum += block[pass & 7];
+        }
+    }
+    return checksum;
+}
+
+static uint32_t decryptBatchBody(void *context, uint32_t repetition) {
+    const BlockContext *blocks = (const BlockContext *)context;
+    uint32_t checksum = repetition;
+
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        fealDecryptBatch(blocks->left, blocks->right, blocks->outLeft, blocks->outRight, benchSubkeys, BENCH_INPUTS);
+        checksum += blocks->outLeft[pass % BENCH_INPUTS];
+    }
+    return checksum;
+}
+
+// the key validation of the attack: every block is decrypted and compared
+static uint32_t decryptBitslicedBody(void *context, uint32_t repetition) {
+    const BlockContext *blocks = (const BlockContext *)context;
+    uint32_t checksum = repetition;
+
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        checksum += (uint32_t)fealBitslicedDecryptMismatches(blocks->cipherSlices, blocks->plainSlices,
+                                                             benchSubkeys, BENCH_INPUTS, BENCH_INPUTS);
+    }
+    return checksum;
+}
+
+static int benchBlocks(const uint32_t *inputs) {
+    uint32_t *buffers = (uint32_t *)malloc(4 * BENCH_INPUTS * sizeof(uint32_t));
+    uint64_t *slices = (uint64_t *)malloc(2 * fealBitslicedWords(BENCH_INPUTS) * sizeof(uint64_t));
+
+    if (!buffers || !slices) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        free(buffers);
+        free(slices);
+        return 0;
+    }
+
+    uint32_t *cipherLeft = buffers;
+    uint32_t *cipherRight = buffers + BENCH_INPUTS;
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        uint32_t halves[2] = {inputs[i], inputs[(i + 1) % BENCH_INPUTS] ^ 0x9e3779b9u};
+        fealEncryptWords(halves, benchSubkeys);
+        cipherLeft[i] = halves[0];
+        cipherRight[i] = halves[1];
+    }
+
+    // the plaintext slices only have to exist, the mismatch count is not checked
+    uint64_t *plainSlices = slices;
+    uint64_t *cipherSlices = slices + fealBitslicedWords(BENCH_INPUTS);
+    fealBitsliceBlocks(inputs, inputs, BENCH_INPUTS, plainSlices);
+    fealBitsliceBlocks(cipherLeft, cipherRight, BENCH_INPUTS, cipherSlices);
+
+    BlockContext blocks = {cipherLeft, cipherRight, buffers + 2 * BENCH_INPUTS, buffers + 3 * BENCH_INPUTS,
+                           plainSlices, cipherSlices};
+    long long operations = (long long)BENCH_PASSES * BENCH_INPUTS;
+
+    printf("block decryption:\n");
+    measure("scalar block", decryptBlockBody, &blocks, operations, "blocks");
+
+    for (size_t k = 0; k < sizeof(kernelNames) / sizeof(kernelNames[0]); k++) {
+        if (!fealSelectBatchKernel(kernelNames[k])) {
+            continue;
+        }
+
+        char name[64];
+        snprintf(name, sizeof(name), "batch blocks (%s)", fealBatchKernelName());
+        measure(name, decryptBatchBody, &blocks, operations, "blocks");
+        snprintf(name, sizeof(name), "bitsliced validation (%s)", fealBatchKernelName());
+        measure(name, decryptBitslicedBody, &blocks, operations, "blocks");
+    }
+
+    free(buffers);
+    free(slices);
+    return 1;
+}
+
+/*
+ * one stage sweep: BENCH_SWEEP_CANDIDATES keys, each scored over all BENCH_SWEEP_PAIRS
+ * pairs without early rejection, the inner approximations of every stage use the
+ * S15 output mask and the outer ones S7,15,23,31, so two masks cover all eight
+ */
+typedef struct {
+    const uint32_t *roundInputs;
+    uint32_t outputMask;
+    int batch;
+} SweepContext;
+
+static uint32_t sweepBody(void *context, uint32_t repetition) {
+    const SweepContext *sweep = (const SweepContext *)context;
+    uint32_t checksum = 0;
+
+    for (int candidate = 0; candidate < BENCH_SWEEP_CANDIDATES; candidate++) {
+        uint32_t key = (repetition * BENCH_SWEEP_CANDIDATES + (uint32_t)candidate) * 0x9e3779b9u;
+        int ones = 0;
+
+        if (sweep->batch) {
+            for (int firstPair = 0; firstPair < BENCH_SWEEP_PAIRS; firstPair += BENCH_PARITY_BLOCK) {
+                int count = BENCH_SWEEP_PAIRS - firstPair < BENCH_PARITY_BLOCK ? BENCH_SWEEP_PAIRS - firstPair
+                                                                               : BENCH_PARITY_BLOCK;
+                ones += __builtin_popcountll(fealFParityBatch(sweep->roundInputs + firstPair, key,
+                                                              sweep->outputMask, count));
+            }
+        } else {
+            for (int pairIdx = 0; pairIdx < BENCH_SWEEP_PAIRS; pairIdx++) {
+                ones += fealFParity(sweep->roundInputs[pairIdx] ^ key, sweep->outputMask);
+            }
+        }
+        checksum += (uint32_t)ones;
+    }
+    return checksum;
+}
+
+static void benchSweeps(const uint32_t *inputs) {
+    static const struct {
+        const char *name;
+        uint32_t outputMask;
+    } halves[] = {{"inner", MASK_S15}, {"outer", MASK_S7_15_23_31}};
+
+    printf("approximation sweeps (%d pairs per candidate, pairs/s = %d x candidates/s):\n",
+           BENCH_SWEEP_PAIRS, BENCH_SWEEP_PAIRS);
+
+    for (size_t half = 0; half < sizeof(halves) / sizeof(halves[0]); half++) {
+        char name[64];
+        SweepContext sweep = {inputs, halves[half].outputMask, 0};
+
+        snprintf(name, sizeof(name), "%s sweep (scalar)", halves[half].name);
+        measure(name, sweepBody, &sweep, BENCH_SWEEP_CANDIDATES, "candidates");
+
+        sweep.batch = 1;
+        for (size_t k = 0; k < sizeof(kernelNames) / sizeof(kernelNames[0]); k++) {
+            if (!fealSelectBatchKernel(kernelNames[k])) {
+                continue;
+            }
+            snprintf(name, sizeof(name), "%s sweep (%s)", halves[half].name, fealBatchKernelName());
+            measure(name, sweepBody, &sweep, BENCH_SWEEP_CANDIDATES, "candidates");
+        }
+    }
+}
+
+// a temporary file path in $TMPDIR (or /tmp), the file is created empty
+static int temporaryPath(char *path, const char *tag) {
+    const char *directory = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    snprintf(path, BENCH_PATH_LENGTH, "%s/feal_bench_%s_XXXXXX", directory, tag);
+
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot create a temporary file in %s\n", directory);
+        return 0;
+    }
+    close(fd);
+    return 1;
+}
+
+/*
+ * writing pairCount random pairs under benchSubkeys in the known.txt format,
+ * the plaintexts come from a fixed seed so every run measures the same dataset
+ */
+static int writeSyntheticPairs(const char *path, int pairCount, uint32_t seed) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Error: Cannot open file %s\n", path);
+        return 0;
+    }
+
+    uint64_t state = 0x853c49e6748fea9bULL ^ seed;
+    for (int pairIdx = 0; pairIdx < pairCount; pairIdx++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        uint32_t halves[2] = {(uint32_t)(state >> 32), (uint32_t)state};
+        uint32_t plainLeft = halves[0];
+        uint32_t plainRight = halves[1];
+
+        fealEncryptWords(halves, benchSubkeys);
+        fprintf(file, "Plaintext=  %08x%08x\nCiphertext= %08x%08x\n\n", plainLeft, plainRight, halves[0], halves[1]);
+    }
+
+    int written = !ferror(file);
+    written &= fclose(file) == 0;
+    if (!written) {
+        fprintf(stderr, "Error: Cannot write file %s\n", path);
+    }
+    return written;
+}
+
+typedef struct {
+    const char *path;
+    int threads;
+} LoaderContext;
+
+static uint32_t loaderBody(void *context, uint32_t repetition) {
+    const LoaderContext *loader = (const LoaderContext *)context;
+    PairDataset *dataset = pairDatasetCreate();
+    uint32_t count = 0;
+
+    if (dataset) {
+        count = (uint32_t)pairDatasetLoadThreaded(dataset, loader->path, loader->threads);
+        pairDatasetFree(dataset);
+    }
+    return count ^ repetition;
+}
+
+static int benchLoader(void) {
+    char textPath[BENCH_PATH_LENGTH];
+    char binaryPath[BENCH_PATH_LENGTH];
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int done = 0;
+
+    if (!temporaryPath(textPath, "text")) {
+        return 0;
+    }
+    if (!temporaryPath(binaryPath, "binary")) {
+        remove(textPath);
+        return 0;
+    }
+
+    PairDataset *dataset = pairDatasetCreate();
+    if (dataset && writeSyntheticPairs(textPath, BENCH_LOADER_PAIRS, 1) &&
+        pairDatasetLoadThreaded(dataset, textPath, 1) == BENCH_LOADER_PAIRS &&
+        pairDatasetSaveBinary(dataset, binaryPath)) {
+        LoaderContext text = {textPath, 1};
+        LoaderContext textThreaded = {textPath, threads};
+        LoaderContext binary = {binaryPath, 1};
+
+        printf("loader (%d pairs):\n", BENCH_LOADER_PAIRS);
+        measure("text", loaderBody, &text, BENCH_LOADER_PAIRS, "pairs");
+        if (threads > 1) {
+            char name[64];
+            snprintf(name, sizeof(name), "text (%d threads)", threads);
+            measure(name, loaderBody, &textThreaded, BENCH_LOADER_PAIRS, "pairs");
+        }
+        measure("binary (mapped)", loaderBody, &binary, BENCH_LOADER_PAIRS, "pairs");
+        done = 1;
+    } else {
+        fprintf(stderr, "Error: Cannot prepare the loader datasets\n");
+    }
+
+    pairDatasetFree(dataset);
+    remove(textPath);
+    remove(binaryPath);
+    return done;
+}
+
+typedef struct {
+    const char *attack;
+    const char *path;
+    int failed;
+} AttackContext;
+
+// one run of the attack binary with its output discarded, a failing run is remembered
+static uint32_t attackBody(void *context, uint32_t repetition) {
+    AttackContext *run = (AttackContext *)context;
+    posix_spawn_file_actions_t actions;
+    char *argv[] = {(char *)run->attack, (char *)run->path, NULL};
+    pid_t pid;
+    int status = 0;
+
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    if (posix_spawn(&pid, run->attack, &actions, NULL, argv, environ) != 0 ||
+        waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        run->failed = 1;
+    }
+    posix_spawn_file_actions_destroy(&actions);
+    return repetition;
+}
+
+/*
+ * wall-clock time of complete attacks (process start, loading, search, validation),
+ * on known.txt if present and on synthetic datasets of the given sizes
+ */
+static int benchAttack(const char *attack, const int *pairCounts, int datasetCount) {
+    char paths[BENCH_MAX_DATASETS][BENCH_PATH_LENGTH];
+    int created = 0;
+    int passed = 1;
+
+    if (access(attack, X_OK) != 0) {
+        fprintf(stderr, "Error: Attack binary %s not found (run make first)\n", attack);
+        return 0;
+    }
+
+    printf("attack (%s, wall clock per run):\n", attack);
+
+    if (access("known.txt", R_OK) == 0) {
+        AttackContext run = {attack, "known.txt", 0};
+        measure("known.txt", attackBody, &run, 1, "runs");
+        passed &= !run.failed;
+    }
+
+    for (; created < datasetCount && passed; created++) {
+        char name[64];
+
+        if (!temporaryPath(paths[created], "pairs")) {
+            passed = 0;
+            break;
+        }
+        if (!writeSyntheticPairs(paths[created], pairCounts[created], (uint32_t)created + 2)) {
+            remove(paths[created]);
+            passed = 0;
+            break;
+        }
+
+        AttackContext run = {attack, paths[created], 0};
+        snprintf(name, sizeof(name), "synthetic %d pairs", pairCounts[created]);
+        measure(name, attackBody, &run, 1, "runs");
+        passed &= !run.failed;
+    }
+
+    for (int datasetIdx = 0; datasetIdx < created; datasetIdx++) {
+        remove(paths[datasetIdx]);
+    }
+
+    if (!passed) {
+        fprintf(stderr, "Error: The attack failed on a benchmark dataset\n");
+    }
+    return passed;
+}
+
+// parsing a comma separated list of pair counts, returns how many were read or 0
+static int parsePairCounts(const char *text, int *pairCounts) {
+    int count = 0;
+
+    while (*text && count < BENCH_MAX_DATASETS) {
+        char *end;
+        long pairs = strtol(text, &end, 10);
+        if (end == text || pairs < 1 || pairs > 100000000 || (*end && *end != ',')) {
+            return 0;
+        }
+        pairCounts[count++] = (int)pairs;
+        text = *end ? end + 1 : end;
+    }
+    return *text ? 0 : count;
+}
+
+static void printUsage(const char *program) {
+    fprintf(stderr, "Usage: %s [--repetitions N] [--attack PATH] [--pairs N,N,...] [--no-attack]\n", program);
+    fprintf(stderr, "  --repetitions N  measured runs per benchmark (default %d)\n", BENCH_DEFAULT_REPETITIONS);
+    fprintf(stderr, "  --attack PATH    attack binary of the end-to-end runs (default ./feal_ready)\n");
+    fprintf(stderr, "  --pairs N,...    sizes of the synthetic attack datasets (default 1000,10000)\n");
+    fprintf(stderr, "  --no-attack      only run the kernel and loader benchmarks\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *attack = "./feal_ready";
+    int pairCounts[BENCH_MAX_DATASETS] = {1000, 10000};
+    int datasetCount = 2;
+    int runAttack = 1;
+
+    for (int argIdx = 1; argIdx < argc; argIdx++) {
+        if (strcmp(argv[argIdx], "--repetitions") == 0 && argIdx + 1 < argc) {
+            repetitions = atoi(argv[++argIdx]);
+            if (repetitions < 1) {
+                fprintf(stderr, "Error: Invalid repetition count %s\n", argv[argIdx]);
+                return 1;
+            }
+        } else if (strcmp(argv[argIdx], "--attack") == 0 && argIdx + 1 < argc) {
+            attack = argv[++argIdx];
+        } else if (strcmp(argv[argIdx], "--pairs") == 0 && argIdx + 1 < argc) {
+            datasetCount = parsePairCounts(argv[++argIdx], pairCounts);
+            if (datasetCount == 0) {
+                fprintf(stderr, "Error: Invalid pair counts %s\n", argv[argIdx]);
+                return 1;
+            }
+        } else if (strcmp(argv[argIdx], "--no-attack") == 0) {
+            runAttack = 0;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    uint32_t *inputs = (uint32_t *)malloc(BENCH_INPUTS * sizeof(uint32_t));
+    uint32_t *outputs = (uint32_t *)malloc(BENCH_INPUTS * sizeof(uint32_t));
+
+    if (!inputs || !outputs) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        free(inputs);
+        free(outputs);
+        return 1;
+    }
+
+    srand(1);
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        inputs[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+    }
+    fealFTablesInit();
+
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        if (fealFFunctionArithmetic(inputs[i]) != fealFFunctionTable(inputs[i])) {
+            fprintf(stderr, "Error: Table F differs from arithmetic F for %08x\n", inputs[i]);
+            free(inputs);
+            free(outputs);
+            return 1;
+        }
+    }
+
+#ifdef FEAL_TABLE_F
+    printf("Benchmarks (%d warmup + %d measured runs, table build)\n", BENCH_WARMUP, repetitions);
+#else
+    printf("Benchmarks (%d warmup + %d measured runs, arithmetic build)\n", BENCH_WARMUP, repetitions);
+#endif
+    benchFFunction(inputs, outputs);
+
+    int passed = benchBlocks(inputs);
+    benchSweeps(inputs);
+    passed &= benchLoader();
+    if (runAttack) {
+        passed &= benchAttack(attack, pairCounts, datasetCount);
+    }
+
+    free(inputs);
+    free(outputs);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+/*
+ * surviving candidate sets passed between search stages,
+ * a growable array of keys that workers append to concurrently and that is
+ * sorted and deduplicated once a sweep is complete, with bitmap and file forms
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+typedef unsigned int uint32_t;
+typedef unsigned long long uint64_t;
+
+#define INITIAL_SET_CAPACITY 16
+#define CANDIDATE_SET_MAGIC 0x53444e43u  // "CNDS" in little endian
+
+typedef struct CandidateSet {
+    pthread_mutex_t lock;
+    uint32_t *keys;
+    int count;
+    int capacity;
+    int sorted;      // keys are ascending and unique
+} CandidateSet;
+
+CandidateSet *candidateSetCreate(void) {
+    CandidateSet *set = (CandidateSet *)calloc(1, sizeof(CandidateSet));
+    if (!set) {
+        return NULL;
+    }
+
+    pthread_mutex_init(&set->lock, NULL);
+    set->sorted = 1;
+    return set;
+}
+
+void candidateSetFree(CandidateSet *set) {
+    if (!set) {
+        return;
+    }
+
+    pthread_mutex_destroy(&set->lock);
+    free(set->keys);
+    free(set);
+}
+
+// making room for extra keys, caller holds the lock
+static int reserveKeys(CandidateSet *set, int extra) {
+    if (set->count + extra <= set->capacity) {
+        return 1;
+    }
+
+    int newCapacity = set->capacity ? set->capacity : INITIAL_SET_CAPACITY;
+    while (newCapacity < set->count + extra) {
+        newCapacity *= 2;
+    }
+
+    uint32_t *grown = (uint32_t *)realloc(set->keys, (size_t)newCapacity * sizeof(uint32_t));
+    if (!grown) {
+        return 0;
+    }
+
+    set->keys = grown;
+    set->capacity = newCapacity;
+    return 1;
+}
+
+// adding a key from any thread, returns 0 if memory ran out
+int candidateSetAdd(CandidateSet *set, uint32_t key) {
+    pthread_mutex_lock(&set->lock);
+
+    int added = reserveKeys(set, 1);
+    if (added) {
+        if (set->count > 0 && set->keys[set->count - 1] >= key) {
+            set->sorted = 0;
+        }
+        set->keys[set->count++] = key;
+    }
+
+    pthread_mutex_unlock(&set->lock);
+    return added;
+}
+
+static int compareKeys(const void *a, const void *b) {
+    uint32_t left = *(const uint32_t *)a;
+    uint32_t right = *(const uint32_t *)b;
+    return left < right ? -1 : left > right;
+}
+
+/*
+ * sorting the keys and dropping duplicates, called once no worker adds any more,
+ * returns the number of distinct keys
+ */
+int candidateSetSortUnique(CandidateSet *set) {
+    if (!set->sorted && set->count > 1) {
+        qsort(set->keys, set->count, sizeof(uint32_t), compareKeys);
+
+        int unique = 1;
+        for (int i = 1; i < set->count; i++) {
+            if (set->keys[i] != set->keys[unique - 1]) {
+                set->keys[unique++] = set->keys[i];
+            }
+        }
+        set->count = unique;
+    }
+
+    set->sorted = 1;
+    return set->count;
+}
+
+int candidateSetCount(const CandidateSet *set) {
+    return set->count;
+}
+
+// the keys in insertion order, or ascending after candidateSetSortUnique
+const uint32_t *candidateSetKeys(const CandidateSet *set) {
+    return set->keys;
+}
+
+void candidateSetClear(CandidateSet *set) {
+    set->count = 0;
+    set->sorted = 1;
+}
+
+// membership test on a sorted set
+int candidateSetContains(const CandidateSet *set, uint32_t key) {
+    return set->sorted && bsearch(&key, set->keys, set->count, sizeof(uint32_t), compareKeys) != NULL;
+}
+
+/*
+ * marking the set in a bitmap of 2^spaceBits bits (words of 64), keys are candidate
+ * indices or have to be mapped to them by the caller, bits outside the space are ignored
+ */
+void candidateSetToBitmap(const CandidateSet *set, uint64_t *bitmap, int spaceBits) {
+    uint64_t space = 1ULL << spaceBits;
+
+    memset(bitmap, 0, (size_t)((space + 63) / 64) * sizeof(uint64_t));
+    for (int i = 0; i < set->count; i++) {
+        if (set->keys[i] < space) {
+            bitmap[set->keys[i] / 64] |= 1ULL << (set->keys[i] % 64);
+        }
+    }
+}
+
+/*
+ * writing the set as magic, count and keys in native byte order,
+ * returns 1 on success
+ */
+int candidateSetWrite(const CandidateSet *set, FILE *file) {
+    uint32_t header[2] = {CANDIDATE_SET_MAGIC, (uint32_t)set->count};
+
+    return fwrite(header, sizeof(uint32_t), 2, file) == 2 &&
+           fwrite(set->keys, sizeof(uint32_t), set->count, file) == (size_t)set->count;
+}
+
+// reading a set written by candidateSetWrite, NULL on format or memory errors
+CandidateSet *candidateSetRead(FILE *file) {
+    uint32_t header[2];
+
+    if (fread(header, sizeof(uint32_t), 2, file) != 2 || header[0] != CANDIDATE_SET_MAGIC ||
+        header[1] > 0x7FFFFFFFu) {
+        return NULL;
+    }
+
+    CandidateSet *set = candidateSetCreate();
+    if (!set) {
+        return NULL;
+    }
+
+    int count = (int)header[1];
+    if (!reserveKeys(set, count) || fread(set->keys, sizeof(uint32_t), count, file) != (size_t)count) {
+        candidateSetFree(set);
+        return NULL;
+    }
+
+    set->count = count;
+    set->sorted = 0;
+    candidateSetSortUnique(set);
+    return set;
+}
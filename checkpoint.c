@@ -0,0 +1,177 @@
+/*
+ * background checkpoint writer for long searches,
+ * the search thread hands over a snapshot (copied, the newest replaces any
+ * snapshot not yet written) and a writer thread stores it to a temporary file
+ * that is renamed over the checkpoint, so a crash leaves the previous one intact
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+typedef struct CheckpointWriter {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    char *path;
+    char *temporaryPath;
+    unsigned char *pending;    // snapshot waiting to be written, NULL if none
+    size_t pendingSize;
+    int stopRequested;
+    int failed;                // a write failed, reported once
+} CheckpointWriter;
+
+// writing one snapshot to the temporary file, then renaming it over the checkpoint
+static int storeSnapshot(CheckpointWriter *writer, const unsigned char *data, size_t size) {
+    FILE *file = fopen(writer->temporaryPath, "wb");
+    if (!file) {
+        return 0;
+    }
+
+    int written = fwrite(data, 1, size, file) == size;
+    if (fclose(file) != 0 || !written) {
+        remove(writer->temporaryPath);
+        return 0;
+    }
+    return rename(writer->temporaryPath, writer->path) == 0;
+}
+
+static void *writerMain(void *arg) {
+    CheckpointWriter *writer = (CheckpointWriter *)arg;
+
+    pthread_mutex_lock(&writer->lock);
+    for (;;) {
+        while (!writer->pending && !writer->stopRequested) {
+            pthread_cond_wait(&writer->wakeup, &writer->lock);
+        }
+        if (!writer->pending) {
+            break;
+        }
+
+        unsigned char *data = writer->pending;
+        size_t size = writer->pendingSize;
+        writer->pending = NULL;
+
+        // the search keeps running while the snapshot is written
+        pthread_mutex_unlock(&writer->lock);
+        int stored = storeSnapshot(writer, data, size);
+        free(data);
+        pthread_mutex_lock(&writer->lock);
+
+        if (!stored && !writer->failed) {
+            fprintf(stderr, "Error: Cannot write checkpoint %s\n", writer->path);
+            writer->failed = 1;
+        }
+    }
+    pthread_mutex_unlock(&writer->lock);
+    return NULL;
+}
+
+CheckpointWriter *checkpointWriterCreate(const char *path) {
+    CheckpointWriter *writer = (CheckpointWriter *)calloc(1, sizeof(CheckpointWriter));
+    if (!writer) {
+        return NULL;
+    }
+
+    size_t length = strlen(path);
+    writer->path = (char *)malloc(length + 1);
+    writer->temporaryPath = (char *)malloc(length + 5);
+    if (!writer->path || !writer->temporaryPath) {
+        free(writer->path);
+        free(writer->temporaryPath);
+        free(writer);
+        return NULL;
+    }
+    memcpy(writer->path, path, length + 1);
+    memcpy(writer->temporaryPath, path, length);
+    memcpy(writer->temporaryPath + length, ".tmp", 5);
+
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->wakeup, NULL);
+    if (pthread_create(&writer->thread, NULL, writerMain, writer) != 0) {
+        pthread_mutex_destroy(&writer->lock);
+        pthread_cond_destroy(&writer->wakeup);
+        free(writer->path);
+        free(writer->temporaryPath);
+        free(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+/*
+ * queueing a snapshot for writing (the data is copied), a snapshot still waiting is
+ * dropped in favour of the newer one, returns 0 if memory ran out
+ */
+int checkpointWriterSubmit(CheckpointWriter *writer, const void *data, size_t size) {
+    unsigned char *copy = (unsigned char *)malloc(size);
+    if (!copy) {
+        return 0;
+    }
+    memcpy(copy, data, size);
+
+    pthread_mutex_lock(&writer->lock);
+    free(writer->pending);
+    writer->pending = copy;
+    writer->pendingSize = size;
+    pthread_cond_signal(&writer->wakeup);
+    pthread_mutex_unlock(&writer->lock);
+    return 1;
+}
+
+// writing any pending snapshot, then stopping the writer thread
+void checkpointWriterFree(CheckpointWriter *writer) {
+    if (!writer) {
+        return;
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    writer->stopRequested = 1;
+    pthread_cond_signal(&writer->wakeup);
+    pthread_mutex_unlock(&writer->lock);
+    pthread_join(writer->thread, NULL);
+
+    pthread_mutex_destroy(&writer->lock);
+    pthread_cond_destroy(&writer->wakeup);
+    free(writer->pending);
+    free(writer->path);
+    free(writer->temporaryPath);
+    free(writer);
+}
+
+// reading a whole checkpoint file into memory, NULL if it cannot be read
+void *checkpointRead(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+
+    size_t capacity = 1 << 16;
+    size_t used = 0;
+    unsigned char *data = (unsigned char *)malloc(capacity);
+
+    while (data) {
+        used += fread(data + used, 1, capacity - used, file);
+        if (used < capacity) {
+            break;
+        }
+        unsigned char *grown = (unsigned char *)realloc(data, capacity * 2);
+        if (!grown) {
+            free(data);
+            data = NULL;
+            break;
+        }
+        data = grown;
+        capacity *= 2;
+    }
+
+    if (data && ferror(file)) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+
+    *size = used;
+    return data;
+}
@@ -3,11 +3,9 @@
  * provides encryption/decryption functions for cryptanalysis
 */
 
-typedef unsigned int uint32_t;
-typedef unsigned char uint8_t;
+#include <string.h>
 
-// feal-4 constants
-#define FEAL_ROUNDS 4
+#include "cipher.h"
 
 // rotate left by 2 bits (circular shift)
 #define ROTATE_LEFT_2(x) (((x) << 2) | ((x) >> 6))
@@ -32,8 +30,8 @@ void word32ToBytes(uint32_t word, uint8_t *bytes) {
     bytes[3] = (uint8_t)word;
 }
 
-// feal f-function: core nonlinear transformation
-uint32_t fealFFunction(uint32_t input) {
+// feal f-function: core nonlinear transformation, byte arithmetic version
+uint32_t fealFFunctionArithmetic(uint32_t input) {
     uint8_t inputBytes[4];
     uint8_t outputBytes[4];
     
@@ -49,20 +47,624 @@ uint32_t fealFFunction(uint32_t input) {
     return bytesToWord32(outputBytes);
 }
 
-// feal-4 decryption function
-void fealDecryptBlock(uint8_t ciphertext[8], const uint32_t subkeys[6]) {
-    uint32_t leftHalf, rightHalf, temp;
-    
-    rightHalf = bytesToWord32(&ciphertext[0]) ^ subkeys[4];
-    leftHalf = rightHalf ^ bytesToWord32(&ciphertext[4]) ^ subkeys[5];
-    
+/*
+ * table-driven f-function: G0 and G1 as 256x256 byte tables indexed by (a << 8) | b,
+ * every output byte is one lookup, the chain y1 -> y0, y2 -> y3 stays sequential,
+ * the tables (128 KiB) are filled by fealFTablesInit, which FEAL_TABLE_F builds run
+ * before main and which must precede any other use of the table functions
+ */
+static uint8_t g0Table[256 * 256];
+static uint8_t g1Table[256 * 256];
+
+// bit (a << 8) | b is the low bit of G1(a, b), i.e. S15 of F for a = x0^x1, b = x2^x3
+static uint64_t g1LowBits[256 * 256 / 64];
+
+void fealFTablesInit(void) {
+    for (int a = 0; a < 256; a++) {
+        for (int b = 0; b < 256; b++) {
+            int index = (a << 8) | b;
+            g0Table[index] = SBOX_0(a, b);
+            g1Table[index] = SBOX_1(a, b);
+            if (g1Table[index] & 1) {
+                g1LowBits[index / 64] |= 1ULL << (index % 64);
+            }
+        }
+    }
+}
+
+uint32_t fealFFunctionTable(uint32_t input) {
+    uint32_t x0 = input >> 24;
+    uint32_t x1 = (input >> 16) & 0xFF;
+    uint32_t mixed23 = ((input >> 8) ^ input) & 0xFF;
+    uint32_t y1 = g1Table[((x0 ^ x1) << 8) | mixed23];
+    uint32_t y0 = g0Table[(x0 << 8) | y1];
+    uint32_t y2 = g0Table[(y1 << 8) | mixed23];
+    uint32_t y3 = g1Table[(y2 << 8) | (input & 0xFF)];
+
+    return (y0 << 24) | (y1 << 16) | (y2 << 8) | y3;
+}
+
+#ifdef FEAL_TABLE_F
+__attribute__((constructor)) static void fealFTablesAtStartup(void) {
+    fealFTablesInit();
+}
+#endif
+
+// feal f-function, the implementation is picked at build time (FEAL_TABLE_F)
+uint32_t fealFFunction(uint32_t input) {
+#ifdef FEAL_TABLE_F
+    return fealFFunctionTable(input);
+#else
+    return fealFFunctionArithmetic(input);
+#endif
+}
+
+/*
+ * parity of F(input) & outputMask, the single-bit S15 mask (0x00010000) of the inner
+ * approximations needs only the first s-box and is one bit lookup in table builds
+ */
+int fealFParity(uint32_t input, uint32_t outputMask) {
+#ifdef FEAL_TABLE_F
+    if (outputMask == 0x00010000u) {
+        uint32_t index = (((input >> 24) ^ (input >> 16)) & 0xFF) << 8 | (((input >> 8) ^ input) & 0xFF);
+        return (int)(g1LowBits[index / 64] >> (index % 64)) & 1;
+    }
+#endif
+    return __builtin_parity(fealFFunction(input) & outputMask);
+}
+
+/*
+ * feal-N encryption of one block given as its two 32-bit halves (bytes 0-3 and 4-7),
+ * in place, subkeys holds the rounds round keys and the two output whitening words
+ */
+void fealEncryptRounds(uint32_t halves[2], const uint32_t *subkeys, int rounds) {
+    uint32_t leftHalf = halves[0];
+    uint32_t rightHalf = halves[0] ^ halves[1];
+    uint32_t temp;
+
+    for (int round = 0; round < rounds; round++) {
+        temp = rightHalf;
+        rightHalf = leftHalf ^ fealFFunction(rightHalf ^ subkeys[round]);
+        leftHalf = temp;
+    }
+
+    halves[0] = rightHalf ^ subkeys[rounds];
+    halves[1] = leftHalf ^ rightHalf ^ subkeys[rounds + 1];
+}
+
+// feal-4 encryption of one block given as its two halves, in place
+void fealEncryptWords(uint32_t halves[2], const uint32_t subkeys[6]) {
+    fealEncryptRounds(halves, subkeys, FEAL_ROUNDS);
+}
+
+// feal-4 decryption of one block given as its two halves, in place
+void fealDecryptWords(uint32_t halves[2], const uint32_t subkeys[6]) {
+    uint32_t rightHalf = halves[0] ^ subkeys[4];
+    uint32_t leftHalf = rightHalf ^ halves[1] ^ subkeys[5];
+    uint32_t temp;
+
     for (int round = 0; round < FEAL_ROUNDS; round++) {
         temp = leftHalf;
         leftHalf = rightHalf ^ fealFFunction(leftHalf ^ subkeys[FEAL_ROUNDS - 1 - round]);
         rightHalf = temp;
     }
-    
-    rightHalf ^= leftHalf;
-    word32ToBytes(leftHalf, &ciphertext[0]);
-    word32ToBytes(rightHalf, &ciphertext[4]);
+
+    halves[0] = leftHalf;
+    halves[1] = rightHalf ^ leftHalf;
+}
+
+// the byte forms of the above, 8-byte blocks in place
+void fealEncryptBlock(uint8_t block[8], const uint32_t subkeys[6]) {
+    uint32_t halves[2] = {bytesToWord32(&block[0]), bytesToWord32(&block[4])};
+
+    fealEncryptWords(halves, subkeys);
+    word32ToBytes(halves[0], &block[0]);
+    word32ToBytes(halves[1], &block[4]);
+}
+
+void fealDecryptBlock(uint8_t ciphertext[8], const uint32_t subkeys[6]) {
+    uint32_t halves[2] = {bytesToWord32(&ciphertext[0]), bytesToWord32(&ciphertext[4])};
+
+    fealDecryptWords(halves, subkeys);
+    word32ToBytes(halves[0], &ciphertext[0]);
+    word32ToBytes(halves[1], &ciphertext[4]);
+}
+
+/*
+ * batch f-function kernels: one key against many pairs,
+ * every vector lane holds one 32-bit input word, the byte arithmetic is done on
+ * lane values with explicit byte masks so each kernel is plain vector add/xor/shift,
+ * the widest kernel the cpu supports is picked at runtime
+*/
+
+typedef uint32_t fealVec4 __attribute__((vector_size(16)));   // sse2 / neon
+#if defined(__x86_64__) || defined(__i386__)
+#define FEAL_X86_KERNELS 1
+typedef uint32_t fealVec8 __attribute__((vector_size(32)));   // avx2
+typedef uint32_t fealVec16 __attribute__((vector_size(64)));  // avx-512
+#endif
+
+// truncating every lane to a byte, then rotating it left by 2 bits
+#define VEC_ROTATE_LEFT_2(v) (((((v) & 0xFF) << 2) | (((v) & 0xFF) >> 6)) & 0xFF)
+
+// f-function on every lane of x, same byte dataflow as fealFFunction
+#define VEC_F_FUNCTION(x, out) do {                                     \
+        __typeof__(x) in0 = (x) >> 24;                                  \
+        __typeof__(x) in1 = ((x) >> 16) & 0xFF;                         \
+        __typeof__(x) in2 = ((x) >> 8) & 0xFF;                          \
+        __typeof__(x) in3 = (x) & 0xFF;                                 \
+        __typeof__(x) mixed23 = in2 ^ in3;                              \
+        __typeof__(x) out1 = VEC_ROTATE_LEFT_2((in1 ^ in0) + mixed23 + 1); \
+        __typeof__(x) out0 = VEC_ROTATE_LEFT_2(in0 + out1);             \
+        __typeof__(x) out2 = VEC_ROTATE_LEFT_2(out1 + mixed23);         \
+        __typeof__(x) out3 = VEC_ROTATE_LEFT_2(out2 + in3 + 1);         \
+        (out) = (out0 << 24) | (out1 << 16) | (out2 << 8) | out3;       \
+    } while (0)
+
+// xor-folding every lane down to the parity of its bits in the low bit
+#define VEC_PARITY(v) do {                                              \
+        (v) ^= (v) >> 16;                                               \
+        (v) ^= (v) >> 8;                                                \
+        (v) ^= (v) >> 4;                                                \
+        (v) ^= (v) >> 2;                                                \
+        (v) ^= (v) >> 1;                                                \
+        (v) &= 1;                                                       \
+    } while (0)
+
+/*
+ * defining one batch kernel pair for a vector type:
+ * name##F writes F(inputs[i] ^ key), name##Parity returns bit i = parity(F(inputs[i] ^ key) & mask),
+ * full vectors are loaded in place, only a trailing partial vector goes through a lane buffer
+ */
+#define DEFINE_BATCH_KERNELS(name, VecType, lanes, targetAttr)                          \
+    targetAttr static void name##F(const uint32_t *inputs, uint32_t key,                \
+                                   uint32_t *outputs, int count) {                      \
+        int base = 0;                                                                   \
+        VecType x, y;                                                                   \
+        for (; base + (lanes) <= count; base += (lanes)) {                              \
+            memcpy(&x, inputs + base, sizeof(x));                                       \
+            x ^= key;                                                                   \
+            VEC_F_FUNCTION(x, y);                                                       \
+            memcpy(outputs + base, &y, sizeof(y));                                      \
+        }                                                                               \
+        if (base < count) {                                                             \
+            uint32_t laneBuffer[lanes] = {0};                                           \
+            memcpy(laneBuffer, inputs + base, (count - base) * sizeof(uint32_t));       \
+            memcpy(&x, laneBuffer, sizeof(x));                                          \
+            x ^= key;                                                                   \
+            VEC_F_FUNCTION(x, y);                                                       \
+            memcpy(laneBuffer, &y, sizeof(y));                                          \
+            memcpy(outputs + base, laneBuffer, (count - base) * sizeof(uint32_t));      \
+        }                                                                               \
+    }                                                                                   \
+    targetAttr static uint64_t name##Parity(const uint32_t *inputs, uint32_t key,       \
+                                            uint32_t outputMask, int count) {           \
+        uint64_t parityBits = 0;                                                        \
+        for (int base = 0; base < count; base += (lanes)) {                             \
+            VecType x, y;                                                               \
+            if (base + (lanes) <= count) {                                              \
+                memcpy(&x, inputs + base, sizeof(x));                                   \
+            } else {                                                                    \
+                uint32_t laneBuffer[lanes] = {0};                                       \
+                memcpy(laneBuffer, inputs + base, (count - base) * sizeof(uint32_t));   \
+                memcpy(&x, laneBuffer, sizeof(x));                                      \
+            }                                                                           \
+            x ^= key;                                                                   \
+            VEC_F_FUNCTION(x, y);                                                       \
+            y &= outputMask;                                                            \
+            VEC_PARITY(y);                                                              \
+            uint64_t laneBits = 0;                                                      \
+            for (int lane = 0; lane < (lanes); lane++) {                                \
+                laneBits |= (uint64_t)y[lane] << lane;                                  \
+            }                                                                           \
+            parityBits |= laneBits << base;                                             \
+        }                                                                               \
+        if (count < 64) {                                                               \
+            parityBits &= (1ULL << count) - 1;                                          \
+        }                                                                               \
+        return parityBits;                                                              \
+    }
+
+/*
+ * defining the block kernels for a vector type: name##Encrypt and name##Decrypt run
+ * the full cipher on structure-of-arrays halves with one block per lane, the same
+ * word dataflow as fealDecryptBlock without the byte conversions, outputs may
+ * alias the inputs
+ */
+#define DEFINE_BLOCK_KERNELS(name, VecType, lanes, targetAttr)                          \
+    targetAttr static void name##Blocks(const uint32_t *inLeft, const uint32_t *inRight, \
+                                        uint32_t *outLeft, uint32_t *outRight,          \
+                                        const uint32_t subkeys[6], int decrypt,         \
+                                        int count) {                                    \
+        for (int base = 0; base < count; base += (lanes)) {                             \
+            int blocks = count - base < (lanes) ? count - base : (lanes);               \
+            uint32_t laneLeft[lanes] = {0};                                             \
+            uint32_t laneRight[lanes] = {0};                                            \
+            VecType left, right, temp, mixed;                                           \
+            if (blocks == (lanes)) {                                                    \
+                memcpy(&left, inLeft + base, sizeof(left));                             \
+                memcpy(&right, inRight + base, sizeof(right));                          \
+            } else {                                                                    \
+                memcpy(laneLeft, inLeft + base, blocks * sizeof(uint32_t));             \
+                memcpy(laneRight, inRight + base, blocks * sizeof(uint32_t));           \
+                memcpy(&left, laneLeft, sizeof(left));                                  \
+                memcpy(&right, laneRight, sizeof(right));                               \
+            }                                                                           \
+            if (decrypt) {                                                              \
+                temp = left ^ subkeys[4];                                               \
+                left = temp ^ right ^ subkeys[5];                                       \
+                right = temp;                                                           \
+                for (int round = 0; round < FEAL_ROUNDS; round++) {                     \
+                    temp = left;                                                        \
+                    mixed = left ^ subkeys[FEAL_ROUNDS - 1 - round];                    \
+                    VEC_F_FUNCTION(mixed, left);                                        \
+                    left ^= right;                                                      \
+                    right = temp;                                                       \
+                }                                                                       \
+                right ^= left;                                                          \
+            } else {                                                                    \
+                right ^= left;                                                          \
+                for (int round = 0; round < FEAL_ROUNDS; round++) {                     \
+                    temp = right;                                                       \
+                    mixed = right ^ subkeys[round];                                     \
+                    VEC_F_FUNCTION(mixed, right);                                       \
+                    right ^= left;                                                      \
+                    left = temp;                                                        \
+                }                                                                       \
+                temp = left;                                                            \
+                left = right ^ subkeys[4];                                              \
+                right = temp ^ right ^ subkeys[5];                                      \
+            }                                                                           \
+            if (blocks == (lanes)) {                                                    \
+                memcpy(outLeft + base, &left, sizeof(left));                            \
+                memcpy(outRight + base, &right, sizeof(right));                         \
+            } else {                                                                    \
+                memcpy(laneLeft, &left, sizeof(left));                                  \
+                memcpy(laneRight, &right, sizeof(right));                               \
+                memcpy(outLeft + base, laneLeft, blocks * sizeof(uint32_t));            \
+                memcpy(outRight + base, laneRight, blocks * sizeof(uint32_t));          \
+            }                                                                           \
+        }                                                                               \
+    }
+
+DEFINE_BATCH_KERNELS(batchVec4, fealVec4, 4, )
+DEFINE_BLOCK_KERNELS(batchVec4, fealVec4, 4, )
+#ifdef FEAL_X86_KERNELS
+DEFINE_BATCH_KERNELS(batchVec8, fealVec8, 8, __attribute__((target("avx2"))))
+DEFINE_BLOCK_KERNELS(batchVec8, fealVec8, 8, __attribute__((target("avx2"))))
+DEFINE_BATCH_KERNELS(batchVec16, fealVec16, 16, __attribute__((target("avx512f"))))
+DEFINE_BLOCK_KERNELS(batchVec16, fealVec16, 16, __attribute__((target("avx512f"))))
+#endif
+
+/*
+ * bitsliced cipher: the blocks are stored transposed, slice w holds bit w of the left
+ * half (w < 32) or bit w - 32 of the right half of 64 blocks, one block per bit, so
+ * the byte additions become ripple-carry adders on whole slices, the rotations are
+ * free renames and every instruction works on 64 (uint64_t), 128 or 256 blocks,
+ * slices are grouped in units of FEAL_SLICE_BLOCKS blocks, 64 slices of 4 words each
+ */
+
+#define FEAL_SLICE_WORDS 64                          // slices per group of 64 blocks
+#define FEAL_SLICE_LANES 4                           // groups interleaved per unit
+#define FEAL_SLICE_BLOCKS (64 * FEAL_SLICE_LANES)    // blocks per unit
+
+typedef uint64_t fealSlice2 __attribute__((vector_size(16)));  // sse2 / neon, 128 blocks
+#ifdef FEAL_X86_KERNELS
+typedef uint64_t fealSlice4 __attribute__((vector_size(32)));  // avx2, 256 blocks
+#endif
+
+/*
+ * transposing a 64x64 bit matrix in place (Hacker's Delight, 7-3),
+ * bit 63 - j of row i swaps with bit 63 - i of row j
+ */
+static void transpose64(uint64_t rows[64]) {
+    uint64_t mask = 0x00000000FFFFFFFFULL;
+    for (int width = 32; width != 0; width >>= 1, mask ^= mask << width) {
+        for (int row = 0; row < 64; row = ((row | width) + 1) & ~width) {
+            uint64_t swapped = (rows[row] ^ (rows[row | width] >> width)) & mask;
+            rows[row] ^= swapped;
+            rows[row | width] ^= swapped << width;
+        }
+    }
+}
+
+// words of slice storage for count blocks, whole units
+int fealBitslicedWords(int count) {
+    return (count + FEAL_SLICE_BLOCKS - 1) / FEAL_SLICE_BLOCKS * FEAL_SLICE_WORDS * FEAL_SLICE_LANES;
+}
+
+// word of slice w for the 64-block group of a unit
+#define SLICE_INDEX(unit, slice, lane) \
+    (((size_t)(unit) * FEAL_SLICE_WORDS + (slice)) * FEAL_SLICE_LANES + (lane))
+
+/*
+ * transposing count blocks into slice storage of fealBitslicedWords(count) words,
+ * the blocks beyond count are zero, block j of a group sits at bit 63 - j
+ */
+void fealBitsliceBlocks(const uint32_t *left, const uint32_t *right, int count, uint64_t *slices) {
+    uint64_t rows[64];
+    int groups = (count + 63) / 64;
+
+    memset(slices, 0, fealBitslicedWords(count) * sizeof(uint64_t));
+    for (int group = 0; group < groups; group++) {
+        for (int row = 0; row < 64; row++) {
+            int block = group * 64 + row;
+            rows[row] = block < count ? ((uint64_t)left[block] << 32) | right[block] : 0;
+        }
+        transpose64(rows);
+
+        // row i now holds bit 63 - i of every block, the left half is the upper word
+        for (int bit = 0; bit < 32; bit++) {
+            slices[SLICE_INDEX(group / FEAL_SLICE_LANES, bit, group % FEAL_SLICE_LANES)] = rows[31 - bit];
+            slices[SLICE_INDEX(group / FEAL_SLICE_LANES, 32 + bit, group % FEAL_SLICE_LANES)] = rows[63 - bit];
+        }
+    }
+}
+
+// the inverse of fealBitsliceBlocks for the first count blocks
+void fealUnbitsliceBlocks(const uint64_t *slices, int count, uint32_t *left, uint32_t *right) {
+    uint64_t rows[64];
+    int groups = (count + 63) / 64;
+
+    for (int group = 0; group < groups; group++) {
+        for (int bit = 0; bit < 32; bit++) {
+            rows[31 - bit] = slices[SLICE_INDEX(group / FEAL_SLICE_LANES, bit, group % FEAL_SLICE_LANES)];
+            rows[63 - bit] = slices[SLICE_INDEX(group / FEAL_SLICE_LANES, 32 + bit, group % FEAL_SLICE_LANES)];
+        }
+        transpose64(rows);
+
+        for (int row = 0; row < 64 && group * 64 + row < count; row++) {
+            left[group * 64 + row] = (uint32_t)(rows[row] >> 32);
+            right[group * 64 + row] = (uint32_t)rows[row];
+        }
+    }
+}
+
+/*
+ * defining the bitsliced cipher for a slice type of sliceLanes words: name##Crypt
+ * encrypts or decrypts units of slice storage, the F-function adds bytes with a
+ * ripple-carry adder (byte i of a word is slices 24 - 8i to 31 - 8i)
+ */
+#define DEFINE_SLICED_KERNELS(name, SliceType, sliceLanes, targetAttr)                  \
+    /* out = ROTATE_LEFT_2(a + b + carry) on one bitsliced byte */                      \
+    targetAttr static void name##SboxByte(const SliceType *a, const SliceType *b,       \
+                                           SliceType carry, SliceType *out) {           \
+        SliceType sum[8];                                                               \
+        for (int bit = 0; bit < 8; bit++) {                                             \
+            SliceType half = a[bit] ^ b[bit];                                           \
+            sum[bit] = half ^ carry;                                                    \
+            carry = (a[bit] & b[bit]) | (half & carry);                                 \
+        }                                                                               \
+        for (int bit = 0; bit < 8; bit++) {                                             \
+            out[bit] = sum[(bit + 6) & 7];                                              \
+        }                                                                               \
+    }                                                                                   \
+    /* y = F(x ^ key), same byte dataflow as fealFFunction */                           \
+    targetAttr static void name##F(const SliceType *x, uint32_t key, SliceType *y) {    \
+        SliceType zero = (SliceType){0};                                                \
+        SliceType ones = ~zero;                                                         \
+        SliceType in[32], mixed01[8], mixed23[8];                                       \
+        for (int bit = 0; bit < 32; bit++) {                                            \
+            in[bit] = (key >> bit) & 1 ? ~x[bit] : x[bit];                              \
+        }                                                                               \
+        for (int bit = 0; bit < 8; bit++) {                                             \
+            mixed01[bit] = in[24 + bit] ^ in[16 + bit];                                 \
+            mixed23[bit] = in[8 + bit] ^ in[bit];                                       \
+        }                                                                               \
+        name##SboxByte(mixed01, mixed23, ones, y + 16);                                 \
+        name##SboxByte(in + 24, y + 16, zero, y + 24);                                  \
+        name##SboxByte(y + 16, mixed23, zero, y + 8);                                   \
+        name##SboxByte(y + 8, in, ones, y);                                             \
+    }                                                                                   \
+    targetAttr static void name##Crypt(const uint64_t *in, uint64_t *out,               \
+                                       const uint32_t subkeys[6], int decrypt,          \
+                                       int units) {                                     \
+        for (int unit = 0; unit < units; unit++) {                                      \
+            for (int lane = 0; lane < FEAL_SLICE_LANES; lane += (sliceLanes)) {         \
+                SliceType left[32], right[32], round[32];                               \
+                for (int bit = 0; bit < 32; bit++) {                                    \
+                    memcpy(&left[bit], &in[SLICE_INDEX(unit, bit, lane)], sizeof(SliceType)); \
+                    memcpy(&right[bit], &in[SLICE_INDEX(unit, 32 + bit, lane)], sizeof(SliceType)); \
+                }                                                                       \
+                if (decrypt) {                                                          \
+                    for (int bit = 0; bit < 32; bit++) {                                \
+                        SliceType temp = (subkeys[4] >> bit) & 1 ? ~left[bit] : left[bit]; \
+                        left[bit] = (subkeys[5] >> bit) & 1 ? ~(temp ^ right[bit])      \
+                                                             : temp ^ right[bit];       \
+                        right[bit] = temp;                                              \
+                    }                                                                   \
+                    for (int step = 0; step < FEAL_ROUNDS; step++) {                    \
+                        name##F(left, subkeys[FEAL_ROUNDS - 1 - step], round);          \
+                        for (int bit = 0; bit < 32; bit++) {                            \
+                            SliceType temp = left[bit];                                 \
+                            left[bit] = right[bit] ^ round[bit];                        \
+                            right[bit] = temp;                                          \
+                        }                                                               \
+                    }                                                                   \
+                    for (int bit = 0; bit < 32; bit++) {                                \
+                        right[bit] ^= left[bit];                                        \
+                    }                                                                   \
+                } else {                                                                \
+                    for (int bit = 0; bit < 32; bit++) {                                \
+                        right[bit] ^= left[bit];                                        \
+                    }                                                                   \
+                    for (int step = 0; step < FEAL_ROUNDS; step++) {                    \
+                        name##F(right, subkeys[step], round);                           \
+                        for (int bit = 0; bit < 32; bit++) {                            \
+                            SliceType temp = right[bit];                                \
+                            right[bit] = left[bit] ^ round[bit];                        \
+                            left[bit] = temp;                                           \
+                        }                                                               \
+                    }                                                                   \
+                    for (int bit = 0; bit < 32; bit++) {                                \
+                        SliceType temp = left[bit];                                     \
+                        left[bit] = (subkeys[4] >> bit) & 1 ? ~right[bit] : right[bit]; \
+                        right[bit] = (subkeys[5] >> bit) & 1 ? ~(temp ^ right[bit])     \
+                                                              : temp ^ right[bit];      \
+                    }                                                                   \
+                }                                                                       \
+                for (int bit = 0; bit < 32; bit++) {                                    \
+                    memcpy(&out[SLICE_INDEX(unit, bit, lane)], &left[bit], sizeof(SliceType)); \
+                    memcpy(&out[SLICE_INDEX(unit, 32 + bit, lane)], &right[bit], sizeof(SliceType)); \
+                }                                                                       \
+            }                                                                           \
+        }                                                                               \
+    }
+
+DEFINE_SLICED_KERNELS(sliced2, fealSlice2, 2, )
+#ifdef FEAL_X86_KERNELS
+DEFINE_SLICED_KERNELS(sliced4, fealSlice4, 4, __attribute__((target("avx2"))))
+#endif
+
+typedef struct {
+    const char *name;
+    int lanes;
+    void (*fBatch)(const uint32_t *inputs, uint32_t key, uint32_t *outputs, int count);
+    uint64_t (*parityBatch)(const uint32_t *inputs, uint32_t key, uint32_t outputMask, int count);
+    void (*blocks)(const uint32_t *inLeft, const uint32_t *inRight, uint32_t *outLeft, uint32_t *outRight,
+                   const uint32_t subkeys[6], int decrypt, int count);
+    void (*slicedCrypt)(const uint64_t *in, uint64_t *out, const uint32_t subkeys[6], int decrypt, int units);
+} FealBatchKernel;
+
+static const FealBatchKernel batchKernels[] = {
+#ifdef FEAL_X86_KERNELS
+    {"avx512", 16, batchVec16F, batchVec16Parity, batchVec16Blocks, sliced4Crypt},
+    {"avx2", 8, batchVec8F, batchVec8Parity, batchVec8Blocks, sliced4Crypt},
+    {"sse2", 4, batchVec4F, batchVec4Parity, batchVec4Blocks, sliced2Crypt},
+#else
+    {"vec128", 4, batchVec4F, batchVec4Parity, batchVec4Blocks, sliced2Crypt},
+#endif
+};
+
+static const FealBatchKernel *activeBatchKernel = NULL;
+
+static int batchKernelSupported(const FealBatchKernel *kernel) {
+#ifdef FEAL_X86_KERNELS
+    __builtin_cpu_init();
+    if (kernel->lanes == 16) return __builtin_cpu_supports("avx512f");
+    if (kernel->lanes == 8) return __builtin_cpu_supports("avx2");
+#endif
+    (void)kernel;
+    return 1;
+}
+
+// picking the widest supported kernel on first use
+static const FealBatchKernel *batchKernel(void) {
+    const FealBatchKernel *kernel = __atomic_load_n(&activeBatchKernel, __ATOMIC_ACQUIRE);
+    if (kernel) {
+        return kernel;
+    }
+
+    int kernelCount = (int)(sizeof(batchKernels) / sizeof(batchKernels[0]));
+    kernel = &batchKernels[kernelCount - 1];
+    for (int i = 0; i < kernelCount; i++) {
+        if (batchKernelSupported(&batchKernels[i])) {
+            kernel = &batchKernels[i];
+            break;
+        }
+    }
+
+    __atomic_store_n(&activeBatchKernel, kernel, __ATOMIC_RELEASE);
+    return kernel;
+}
+
+/*
+ * forcing a specific kernel by name ("avx512", "avx2", "sse2", ...),
+ * returns 0 if it is unknown or not supported by this cpu
+ */
+int fealSelectBatchKernel(const char *name) {
+    int kernelCount = (int)(sizeof(batchKernels) / sizeof(batchKernels[0]));
+    for (int i = 0; i < kernelCount; i++) {
+        if (strcmp(batchKernels[i].name, name) == 0 && batchKernelSupported(&batchKernels[i])) {
+            __atomic_store_n(&activeBatchKernel, &batchKernels[i], __ATOMIC_RELEASE);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// name and lane count of the dispatched kernel, for reporting and block sizing
+const char *fealBatchKernelName(void) {
+    return batchKernel()->name;
+}
+
+int fealBatchLanes(void) {
+    return batchKernel()->lanes;
+}
+
+// outputs[i] = F(inputs[i] ^ key) for count pairs
+void fealFFunctionBatch(const uint32_t *inputs, uint32_t key, uint32_t *outputs, int count) {
+    batchKernel()->fBatch(inputs, key, outputs, count);
+}
+
+/*
+ * bit i of the result = parity of (F(inputs[i] ^ key) & outputMask),
+ * count must not exceed FEAL_MAX_BATCH
+ */
+uint64_t fealFParityBatch(const uint32_t *inputs, uint32_t key, uint32_t outputMask, int count) {
+    if (count > FEAL_MAX_BATCH) {
+        count = FEAL_MAX_BATCH;
+    }
+    return batchKernel()->parityBatch(inputs, key, outputMask, count);
+}
+
+/*
+ * encrypting or decrypting count blocks given as separate left and right halves
+ * (bytes 0-3 and 4-7 of each block as big-endian words), in place if the output
+ * arrays are the input arrays
+ */
+void fealEncryptBatch(const uint32_t *inLeft, const uint32_t *inRight, uint32_t *outLeft, uint32_t *outRight,
+                      const uint32_t subkeys[6], int count) {
+    batchKernel()->blocks(inLeft, inRight, outLeft, outRight, subkeys, 0, count);
+}
+
+void fealDecryptBatch(const uint32_t *inLeft, const uint32_t *inRight, uint32_t *outLeft, uint32_t *outRight,
+                      const uint32_t subkeys[6], int count) {
+    batchKernel()->blocks(inLeft, inRight, outLeft, outRight, subkeys, 1, count);
+}
+
+/*
+ * encrypting or decrypting count bitsliced blocks from fealBitsliceBlocks,
+ * whole units are processed so padding blocks are transformed as well
+ */
+void fealEncryptBitsliced(const uint64_t *in, uint64_t *out, const uint32_t subkeys[6], int count) {
+    batchKernel()->slicedCrypt(in, out, subkeys, 0, (count + FEAL_SLICE_BLOCKS - 1) / FEAL_SLICE_BLOCKS);
+}
+
+void fealDecryptBitsliced(const uint64_t *in, uint64_t *out, const uint32_t subkeys[6], int count) {
+    batchKernel()->slicedCrypt(in, out, subkeys, 1, (count + FEAL_SLICE_BLOCKS - 1) / FEAL_SLICE_BLOCKS);
+}
+
+/*
+ * number of the count bitsliced blocks whose decryption under subkeys differs from
+ * the matching plaintext block, counting stops once it exceeds limit
+ */
+int fealBitslicedDecryptMismatches(const uint64_t *cipherSlices, const uint64_t *plainSlices,
+                                   const uint32_t subkeys[6], int count, int limit) {
+    const FealBatchKernel *kernel = batchKernel();
+    int units = (count + FEAL_SLICE_BLOCKS - 1) / FEAL_SLICE_BLOCKS;
+    uint64_t decrypted[FEAL_SLICE_WORDS * FEAL_SLICE_LANES];
+    int mismatches = 0;
+
+    for (int unit = 0; unit < units && mismatches <= limit; unit++) {
+        kernel->slicedCrypt(&cipherSlices[SLICE_INDEX(unit, 0, 0)], decrypted, subkeys, 1, 1);
+
+        for (int lane = 0; lane < FEAL_SLICE_LANES; lane++) {
+            uint64_t differing = 0;
+            for (int slice = 0; slice < FEAL_SLICE_WORDS; slice++) {
+                differing |= decrypted[SLICE_INDEX(0, slice, lane)] ^ plainSlices[SLICE_INDEX(unit, slice, lane)];
+            }
+
+            // block j of a group is bit 63 - j, the padding blocks are masked off
+            int blocks = count - (unit * FEAL_SLICE_LANES + lane) * 64;
+            if (blocks <= 0) {
+                break;
+            }
+            if (blocks < 64) {
+                differing &= ~0ULL << (64 - blocks);
+            }
+            mismatches += __builtin_popcountll(differing);
+        }
+    }
+    return mismatches;
 }
@@ -0,0 +1,54 @@
+/*
+ * feal-4 cipher library (libfealcipher.a, built from cipher.c) shared by the
+ * attack, the feal demo and pair generator and the benchmarks: scalar, batch
+ * (vectorized, dispatched at runtime) and bitsliced encryption, decryption and
+ * f-function entry points, blocks are two big-endian 32-bit halves (bytes 0-3, 4-7)
+*/
+
+#ifndef FEAL_CIPHER_H
+#define FEAL_CIPHER_H
+
+#include <stdint.h>
+
+#define FEAL_ROUNDS 4
+#define FEAL_MAX_BATCH 64  // parity batches are returned as one 64-bit mask
+
+uint32_t bytesToWord32(const uint8_t *bytes);
+void word32ToBytes(uint32_t word, uint8_t *bytes);
+
+// f-function: the build-time choice (FEAL_TABLE_F) and both implementations
+uint32_t fealFFunction(uint32_t input);
+uint32_t fealFFunctionArithmetic(uint32_t input);
+uint32_t fealFFunctionTable(uint32_t input);
+void fealFTablesInit(void);
+int fealFParity(uint32_t input, uint32_t outputMask);
+
+// scalar blocks, in place
+void fealEncryptBlock(uint8_t block[8], const uint32_t subkeys[6]);
+void fealDecryptBlock(uint8_t ciphertext[8], const uint32_t subkeys[6]);
+void fealEncryptWords(uint32_t halves[2], const uint32_t subkeys[6]);
+void fealDecryptWords(uint32_t halves[2], const uint32_t subkeys[6]);
+// reduced or extended round variants, subkeys has rounds + 2 words
+void fealEncryptRounds(uint32_t halves[2], const uint32_t *subkeys, int rounds);
+
+// batch kernels, the widest the cpu supports unless one is selected by name
+int fealSelectBatchKernel(const char *name);
+const char *fealBatchKernelName(void);
+int fealBatchLanes(void);
+void fealFFunctionBatch(const uint32_t *inputs, uint32_t key, uint32_t *outputs, int count);
+uint64_t fealFParityBatch(const uint32_t *inputs, uint32_t key, uint32_t outputMask, int count);
+void fealEncryptBatch(const uint32_t *inLeft, const uint32_t *inRight, uint32_t *outLeft, uint32_t *outRight,
+                      const uint32_t subkeys[6], int count);
+void fealDecryptBatch(const uint32_t *inLeft, const uint32_t *inRight, uint32_t *outLeft, uint32_t *outRight,
+                      const uint32_t subkeys[6], int count);
+
+// bitsliced blocks, stored transposed in units of 256 blocks
+int fealBitslicedWords(int count);
+void fealBitsliceBlocks(const uint32_t *left, const uint32_t *right, int count, uint64_t *slices);
+void fealUnbitsliceBlocks(const uint64_t *slices, int count, uint32_t *left, uint32_t *right);
+void fealEncryptBitsliced(const uint64_t *in, uint64_t *out, const uint32_t subkeys[6], int count);
+void fealDecryptBitsliced(const uint64_t *in, uint64_t *out, const uint32_t subkeys[6], int count);
+int fealBitslicedDecryptMismatches(const uint64_t *cipherSlices, const uint64_t *plainSlices,
+                                   const uint32_t subkeys[6], int count, int limit);
+
+#endif
@@ -1,204 +1,640 @@
 /*
  * plaintext-ciphertext data management,
  * handles loading and storage of known pairs for cryptanalysis,
- * uses dynamic memory allocation 
+ * every dataset is an independent handle so several can be attacked at once
 */
 
  #include <stdio.h>
+ #include <stdarg.h>
  #include <stdlib.h>
  #include <string.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <pthread.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
  
  typedef unsigned int uint32_t;
+ typedef unsigned char uint8_t;
  
- #define INITIAL_CAPACITY 50
+ #define INITIAL_CAPACITY 64
  #define GROWTH_FACTOR 2
  
- // interleaved storage format for better cache locality
+ // arrays start on cache line boundaries and are padded to the widest vector (16 words)
+ #define DATASET_ALIGNMENT 64
+ #define DATASET_PAD_WORDS (DATASET_ALIGNMENT / sizeof(uint32_t))
+ #define DATASET_ARRAYS 4
+ 
+ #define DATASET_ERROR_LENGTH 256
+ 
+ // mapped files below this size are parsed by a single thread
+ #define PARALLEL_PARSE_MIN_BYTES (4 << 20)
+ 
+ // binary pair files: header, then the four arrays padded to DATASET_PAD_WORDS words each
+ #define BINARY_MAGIC "FEALPAIR"
+ #define BINARY_VERSION 1
+ #define BINARY_BYTE_ORDER_MARK 0x01020304u   // read back as 0x04030201 on the other endianness
+ #define BINARY_FLAG_CHECKSUM 1u
+ 
  typedef struct {
+     char magic[8];
+     uint32_t version;
+     uint32_t byteOrder;      // BINARY_BYTE_ORDER_MARK in the producer's byte order
+     uint32_t pairCount;
+     uint32_t flags;
+     uint32_t checksum;       // over the pairCount words of every array, see checksumWords
+     uint32_t arrayStride;    // words per array, pairCount padded
+     uint8_t reserved[32];    // zero, keeps the arrays on cache line boundaries
+ } BinaryPairHeader;
+ 
+ typedef char binaryHeaderSizeCheck[sizeof(BinaryPairHeader) == DATASET_ALIGNMENT ? 1 : -1];
+ 
+ /*
+  * structure-of-arrays storage carved from one aligned arena, or pointing straight
+  * into a mapped binary file, words between count and the padded array end are zero
+  * so kernels may read whole vectors
+  */
+ typedef struct PairDataset {
+     uint32_t *arena;                // DATASET_ARRAYS * capacity words, NULL while mapped
+     void *mapping;                  // binary file the arrays live in, copied out on growth
+     size_t mappingLength;
      uint32_t *plaintextLeftArray;   // all left halves of plaintexts
      uint32_t *plaintextRightArray;  // all right halves of plaintexts
      uint32_t *ciphertextLeftArray;  // all left halves of ciphertexts
      uint32_t *ciphertextRightArray; // all right halves of ciphertexts
-     int capacity;                   // current allocated capacity
+     int capacity;                   // pairs per array (the file's array stride while mapped),
+                                     // a multiple of DATASET_PAD_WORDS
      int count;                      // number of pairs actually loaded
- } PairDataStorage;
- 
- // global storage - dynamically allocated
- static PairDataStorage storage = {NULL, NULL, NULL, NULL, 0, 0};
- 
- // initializing storage with initial capacity
- static int initializeStorage(int initialCapacity) {
-     storage.plaintextLeftArray = (uint32_t *)malloc(initialCapacity * sizeof(uint32_t));
-     storage.plaintextRightArray = (uint32_t *)malloc(initialCapacity * sizeof(uint32_t));
-     storage.ciphertextLeftArray = (uint32_t *)malloc(initialCapacity * sizeof(uint32_t));
-     storage.ciphertextRightArray = (uint32_t *)malloc(initialCapacity * sizeof(uint32_t));
-     
-         if (!storage.plaintextLeftArray || !storage.plaintextRightArray ||
-         !storage.ciphertextLeftArray || !storage.ciphertextRightArray) {
-         free(storage.plaintextLeftArray);
-         free(storage.plaintextRightArray);
-         free(storage.ciphertextLeftArray);
-         free(storage.ciphertextRightArray);
-         storage.plaintextLeftArray = NULL;
+     int hasChecksum;                // checksum was read from a binary file
+     uint32_t checksum;
+     int quiet;                      // errors are only kept in error, not printed
+     char error[DATASET_ERROR_LENGTH]; // last loading error, empty if none
+ } PairDataset;
+ 
+ static int paddedCapacity(int pairs) {
+     return (int)((pairs + DATASET_PAD_WORDS - 1) / DATASET_PAD_WORDS * DATASET_PAD_WORDS);
+ }
+ 
+ // moving the arrays into a new arena of the given capacity, existing pairs are kept
+ static int resizeArena(PairDataset *dataset, int newCapacity) {
+     void *block = NULL;
+     size_t arenaBytes = (size_t)DATASET_ARRAYS * newCapacity * sizeof(uint32_t);
+     
+     if (posix_memalign(&block, DATASET_ALIGNMENT, arenaBytes) != 0) {
          return 0;
      }
      
-     storage.capacity = initialCapacity;
-     storage.count = 0;
+     uint32_t *arena = (uint32_t *)block;
+     memset(arena, 0, arenaBytes);
+     
+     if (dataset->count > 0) {
+         size_t usedBytes = (size_t)dataset->count * sizeof(uint32_t);
+         memcpy(arena, dataset->plaintextLeftArray, usedBytes);
+         memcpy(arena + newCapacity, dataset->plaintextRightArray, usedBytes);
+         memcpy(arena + 2 * (size_t)newCapacity, dataset->ciphertextLeftArray, usedBytes);
+         memcpy(arena + 3 * (size_t)newCapacity, dataset->ciphertextRightArray, usedBytes);
+     }
+     
+     free(dataset->arena);
+     if (dataset->mapping) {
+         munmap(dataset->mapping, dataset->mappingLength);
+         dataset->mapping = NULL;
+     }
+     
+     dataset->arena = arena;
+     dataset->plaintextLeftArray = arena;
+     dataset->plaintextRightArray = arena + newCapacity;
+     dataset->ciphertextLeftArray = arena + 2 * (size_t)newCapacity;
+     dataset->ciphertextRightArray = arena + 3 * (size_t)newCapacity;
+     dataset->capacity = newCapacity;
      return 1;
  }
  
- static int expandStorage(void) {
-     int newCapacity = storage.capacity * GROWTH_FACTOR;
-     
-     uint32_t *newLeftP = (uint32_t *)realloc(storage.plaintextLeftArray, newCapacity * sizeof(uint32_t));
-     uint32_t *newRightP = (uint32_t *)realloc(storage.plaintextRightArray, newCapacity * sizeof(uint32_t));
-     uint32_t *newLeftC = (uint32_t *)realloc(storage.ciphertextLeftArray, newCapacity * sizeof(uint32_t));
-     uint32_t *newRightC = (uint32_t *)realloc(storage.ciphertextRightArray, newCapacity * sizeof(uint32_t));
+ // creating an empty dataset, returns NULL if memory ran out
+ PairDataset *pairDatasetCreate(void) {
+     PairDataset *dataset = (PairDataset *)calloc(1, sizeof(PairDataset));
+     if (!dataset) {
+         return NULL;
+     }
      
-     if (!newLeftP || !newRightP || !newLeftC || !newRightC) {
-         return 0;
+     if (!resizeArena(dataset, paddedCapacity(INITIAL_CAPACITY))) {
+         free(dataset);
+         return NULL;
      }
+     return dataset;
+ }
+ 
+ // keeping a loading error for pairDatasetError, printed to stderr unless the dataset is quiet
+ static void datasetError(PairDataset *dataset, const char *format, ...) {
+     va_list arguments;
      
-     storage.plaintextLeftArray = newLeftP;
-     storage.plaintextRightArray = newRightP;
-     storage.ciphertextLeftArray = newLeftC;
-     storage.ciphertextRightArray = newRightC;
-     storage.capacity = newCapacity;
-     return 1;
+     va_start(arguments, format);
+     vsnprintf(dataset->error, sizeof(dataset->error), format, arguments);
+     va_end(arguments);
+     if (!dataset->quiet) {
+         fprintf(stderr, "Error: %s\n", dataset->error);
+     }
  }
  
- // storage cleanup
- void cleanupPairData(void) {
-     free(storage.plaintextLeftArray);
-     free(storage.plaintextRightArray);
-     free(storage.ciphertextLeftArray);
-     free(storage.ciphertextRightArray);
-     storage.plaintextLeftArray = NULL;
-     storage.plaintextRightArray = NULL;
-     storage.ciphertextLeftArray = NULL;
-     storage.ciphertextRightArray = NULL;
-     storage.capacity = 0;
-     storage.count = 0;
+ // embedding programs read the errors through pairDatasetError instead of stderr
+ void pairDatasetSetQuiet(PairDataset *dataset, int quiet) {
+     dataset->quiet = quiet;
  }
  
- int getPairCount(void) {
-     return storage.count;
+ // the last loading error, NULL if there was none
+ const char *pairDatasetError(const PairDataset *dataset) {
+     return dataset->error[0] ? dataset->error : NULL;
  }
  
- uint32_t getPlaintextLeft(int index) {
-     if (index < 0 || index >= storage.count || !storage.plaintextLeftArray) {
-         return 0;
+ // dataset cleanup
+ void pairDatasetFree(PairDataset *dataset) {
+     if (!dataset) {
+         return;
      }
-     return storage.plaintextLeftArray[index];
+     free(dataset->arena);
+     if (dataset->mapping) {
+         munmap(dataset->mapping, dataset->mappingLength);
+     }
+     free(dataset);
  }
  
- uint32_t getPlaintextRight(int index) {
-     if (index < 0 || index >= storage.count || !storage.plaintextRightArray) {
-         return 0;
+ // growing the arena until it holds at least the given number of pairs, a read-only
+ // mapping is copied out before the first append even if its stride has room
+ static int reserveCapacity(PairDataset *dataset, int pairs) {
+     if (pairs <= dataset->capacity && !dataset->mapping) {
+         return 1;
      }
-     return storage.plaintextRightArray[index];
+     
+     int newCapacity = dataset->capacity * GROWTH_FACTOR;
+     if (newCapacity < pairs) {
+         newCapacity = pairs;
+     }
+     return resizeArena(dataset, paddedCapacity(newCapacity));
  }
  
- uint32_t getCiphertextLeft(int index) {
-     if (index < 0 || index >= storage.count || !storage.ciphertextLeftArray) {
+ // appending one pair, returns 0 if the arena could not grow
+ int pairDatasetAppend(PairDataset *dataset, uint32_t plaintextLeft, uint32_t plaintextRight,
+                       uint32_t ciphertextLeft, uint32_t ciphertextRight) {
+     if (!reserveCapacity(dataset, dataset->count + 1)) {
          return 0;
      }
-     return storage.ciphertextLeftArray[index];
+     
+     dataset->plaintextLeftArray[dataset->count] = plaintextLeft;
+     dataset->plaintextRightArray[dataset->count] = plaintextRight;
+     dataset->ciphertextLeftArray[dataset->count] = ciphertextLeft;
+     dataset->ciphertextRightArray[dataset->count] = ciphertextRight;
+     dataset->count++;
+     return 1;
  }
  
- uint32_t getCiphertextRight(int index) {
-     if (index < 0 || index >= storage.count || !storage.ciphertextRightArray) {
-         return 0;
-     }
-     return storage.ciphertextRightArray[index];
+ int pairDatasetCount(const PairDataset *dataset) {
+     return dataset->count;
+ }
+ 
+ // aligned, zero padded arrays, valid until the dataset grows or is freed
+ const uint32_t *pairDatasetPlaintextLeft(const PairDataset *dataset) {
+     return dataset->plaintextLeftArray;
+ }
+ 
+ const uint32_t *pairDatasetPlaintextRight(const PairDataset *dataset) {
+     return dataset->plaintextRightArray;
  }
  
- // parsing hexadecimal string to 32-bit word
- static uint32_t parseHexWord(const char *hexStr, int length) {
-     char temp[9] = {0};
-     if (length > 8) length = 8;
-     strncpy(temp, hexStr, length);
-     temp[length] = '\0';
-     return (uint32_t)strtoul(temp, NULL, 16);
+ const uint32_t *pairDatasetCiphertextLeft(const PairDataset *dataset) {
+     return dataset->ciphertextLeftArray;
  }
  
- // extracting hex value from line (handling both Plaintext= and Ciphertext=)
- static int extractHexFromLine(const char *line, char *output, int maxLen) {
-     const char *hexStart = NULL;
-     if (strncmp(line, "Plaintext=", 10) == 0) {
-         hexStart = line + 10;
-     } else if (strncmp(line, "Ciphertext=", 11) == 0) {
-         hexStart = line + 11;
+ const uint32_t *pairDatasetCiphertextRight(const PairDataset *dataset) {
+     return dataset->ciphertextRightArray;
+ }
+ 
+ // value + 1 of every hex digit character, 0 for anything else
+ static const uint8_t hexDigitTable[256] = {
+     ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+     ['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+     ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+     ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16
+ };
+ 
+ /*
+  * decoding one Plaintext= or Ciphertext= line straight from the text,
+  * the first 8 hex digits form the left half and the next 8 the right half,
+  * returns 0 for lines without a recognised prefix or without digits
+  */
+ static int decodeHexLine(const char *line, const char *lineEnd, uint32_t halves[2]) {
+     size_t length = (size_t)(lineEnd - line);
+     
+     if (length >= 10 && memcmp(line, "Plaintext=", 10) == 0) {
+         line += 10;
+     } else if (length >= 11 && memcmp(line, "Ciphertext=", 11) == 0) {
+         line += 11;
      } else {
          return 0;
      }
      
-     while (*hexStart == ' ') hexStart++;
+     while (line < lineEnd && *line == ' ') line++;
      
-     int len = 0;
-     while (*hexStart && len < maxLen - 1 && 
-            ((*hexStart >= '0' && *hexStart <= '9') ||
-             (*hexStart >= 'a' && *hexStart <= 'f') ||
-             (*hexStart >= 'A' && *hexStart <= 'F'))) {
-         output[len++] = *hexStart++;
+     int digits = 0;
+     halves[0] = halves[1] = 0;
+     while (line < lineEnd && digits < 16) {
+         int value = hexDigitTable[(uint8_t)*line] - 1;
+         if (value < 0) {
+             break;
+         }
+         halves[digits / 8] = (halves[digits / 8] << 4) | (uint32_t)value;
+         digits++;
+         line++;
      }
-     output[len] = '\0';
-     return len > 0;
+     return digits > 0;
  }
  
- // loading plaintext ciphertext pairs from known.txtfile
- int loadKnownPairs(const char *filename) {
-     FILE *file = fopen(filename, "r");
-     if (!file) {
-         fprintf(stderr, "Error: Cannot open file %s\n", filename);
-         return 0;
+ // line parser state: a Plaintext= line is completed by the next line carrying a hex value
+ typedef struct {
+     uint32_t plaintext[2];
+     int expectingPlaintext;
+ } PairLineParser;
+ 
+ // feeding one line to the parser, returns 0 if memory ran out
+ static int parsePairLine(PairDataset *dataset, PairLineParser *parser,
+                          const char *line, const char *lineEnd) {
+     uint32_t ciphertext[2];
+     
+     if (parser->expectingPlaintext) {
+         parser->expectingPlaintext = !decodeHexLine(line, lineEnd, parser->plaintext);
+     } else if (decodeHexLine(line, lineEnd, ciphertext)) {
+         parser->expectingPlaintext = 1;
+         return pairDatasetAppend(dataset, parser->plaintext[0], parser->plaintext[1],
+                                  ciphertext[0], ciphertext[1]);
      }
+     return 1;
+ }
  
-     if (!storage.plaintextLeftArray) {
-         if (!initializeStorage(INITIAL_CAPACITY)) {
-             fclose(file);
-             fprintf(stderr, "Error: Memory allocation failed\n");
+ // parsing a block of known-pair text into the dataset, returns 0 if memory ran out
+ static int parseKnownPairsText(PairDataset *dataset, const char *text, const char *textEnd) {
+     PairLineParser parser = {{0, 0}, 1};
+     
+     while (text < textEnd) {
+         const char *lineEnd = (const char *)memchr(text, '\n', (size_t)(textEnd - text));
+         if (!lineEnd) {
+             lineEnd = textEnd;
+         }
+         if (!parsePairLine(dataset, &parser, text, lineEnd)) {
              return 0;
          }
+         text = lineEnd + 1;
      }
+     return 1;
+ }
  
+ // reading pairs line by line from a stream that cannot be mapped (pipes, stdin)
+ static int loadFromStream(PairDataset *dataset, FILE *file) {
+     PairLineParser parser = {{0, 0}, 1};
      char buffer[256];
-     char plaintextHex[32] = {0};
-     char ciphertextHex[32] = {0};
-     int expectingPlaintext = 1;
- 
+     
      while (fgets(buffer, sizeof(buffer), file)) {
-         buffer[strcspn(buffer, "\n")] = 0;
+         if (!parsePairLine(dataset, &parser, buffer, buffer + strcspn(buffer, "\n"))) {
+             return 0;
+         }
+     }
+     return 1;
+ }
+ 
+ /*
+  * appending up to maxPairs further pairs read line by line from an open stream,
+  * returns how many were appended, 0 once the stream is exhausted
+  */
+ int pairDatasetReadPairs(PairDataset *dataset, FILE *file, int maxPairs) {
+     PairLineParser parser = {{0, 0}, 1};
+     int first = dataset->count;
+     char buffer[256];
+     
+     while (dataset->count - first < maxPairs && fgets(buffer, sizeof(buffer), file)) {
+         if (!parsePairLine(dataset, &parser, buffer, buffer + strcspn(buffer, "\n"))) {
+             datasetError(dataset, "Memory reallocation failed");
+             break;
+         }
+     }
+     return dataset->count - first;
+ }
+ 
+ typedef struct {
+     const char *begin;
+     const char *end;
+     PairDataset *pairs;  // chunk local dataset, appended in file order afterwards
+     int parsed;
+ } ParseChunk;
+ 
+ static void *parseChunkMain(void *arg) {
+     ParseChunk *chunk = (ParseChunk *)arg;
+     chunk->parsed = parseKnownPairsText(chunk->pairs, chunk->begin, chunk->end);
+     return NULL;
+ }
+ 
+ // first position after a blank line at or behind from, textEnd if there is none
+ static const char *nextRecordBoundary(const char *from, const char *textEnd) {
+     while (from < textEnd) {
+         const char *newline = (const char *)memchr(from, '\n', (size_t)(textEnd - from));
+         if (!newline || newline + 1 >= textEnd) {
+             return textEnd;
+         }
+         if (newline[1] == '\n') {
+             return newline + 2;
+         }
+         if (newline[1] == '\r' && newline + 2 < textEnd && newline[2] == '\n') {
+             return newline + 3;
+         }
+         from = newline + 1;
+     }
+     return textEnd;
+ }
+ 
+ // appending count pairs given as four arrays behind the ones already loaded, 0 if the arena could not grow
+ int pairDatasetAppendArrays(PairDataset *dataset, const uint32_t *plaintextLeft, const uint32_t *plaintextRight,
+                             const uint32_t *ciphertextLeft, const uint32_t *ciphertextRight, int count) {
+     if (!reserveCapacity(dataset, dataset->count + count)) {
+         return 0;
+     }
+     
+     size_t bytes = (size_t)count * sizeof(uint32_t);
+     memcpy(dataset->plaintextLeftArray + dataset->count, plaintextLeft, bytes);
+     memcpy(dataset->plaintextRightArray + dataset->count, plaintextRight, bytes);
+     memcpy(dataset->ciphertextLeftArray + dataset->count, ciphertextLeft, bytes);
+     memcpy(dataset->ciphertextRightArray + dataset->count, ciphertextRight, bytes);
+     dataset->count += count;
+     return 1;
+ }
+ 
+ // appending a chunk's pairs behind the ones already loaded
+ static int appendDataset(PairDataset *dataset, const PairDataset *chunkPairs) {
+     return pairDatasetAppendArrays(dataset, chunkPairs->plaintextLeftArray, chunkPairs->plaintextRightArray,
+                                    chunkPairs->ciphertextLeftArray, chunkPairs->ciphertextRightArray,
+                                    chunkPairs->count);
+ }
+ 
+ /*
+  * parsing mapped text with up to threadCount threads, the text is cut at blank
+  * lines (between pair records) and every chunk fills its own dataset
+  */
+ static int parseMappedText(PairDataset *dataset, const char *text, size_t length, int threadCount) {
+     const char *textEnd = text + length;
+     
+     if (threadCount < 2 || length < PARALLEL_PARSE_MIN_BYTES) {
+         return parseKnownPairsText(dataset, text, textEnd);
+     }
+     
+     ParseChunk *chunks = (ParseChunk *)calloc(threadCount, sizeof(ParseChunk));
+     pthread_t *threads = (pthread_t *)calloc(threadCount, sizeof(pthread_t));
+     int *started = (int *)calloc(threadCount, sizeof(int));
+     int chunkCount = 0;
+     int parsed = chunks && threads && started;
+     
+     for (const char *begin = text; parsed && begin < textEnd && chunkCount < threadCount; chunkCount++) {
+         const char *end = chunkCount == threadCount - 1 ? textEnd :
+                           nextRecordBoundary(text + length / threadCount * (chunkCount + 1), textEnd);
+         if (end < begin) {
+             end = nextRecordBoundary(begin, textEnd);
+         }
          
-         if (strlen(buffer) == 0) continue;
+         chunks[chunkCount].begin = begin;
+         chunks[chunkCount].end = end;
+         chunks[chunkCount].pairs = pairDatasetCreate();
+         if (!chunks[chunkCount].pairs) {
+             parsed = 0;
+             chunkCount++;
+             break;
+         }
+         begin = end;
+     }
+     
+     for (int i = 1; parsed && i < chunkCount; i++) {
+         started[i] = pthread_create(&threads[i], NULL, parseChunkMain, &chunks[i]) == 0;
+     }
+     
+     // the calling thread parses the first chunk and any chunk whose thread did not start
+     for (int i = 0; parsed && i < chunkCount; i++) {
+         if (!started[i]) {
+             parseChunkMain(&chunks[i]);
+         }
+     }
+     
+     for (int i = 0; i < chunkCount; i++) {
+         if (started[i]) {
+             pthread_join(threads[i], NULL);
+         }
+         if (parsed && !(chunks[i].parsed && appendDataset(dataset, chunks[i].pairs))) {
+             parsed = 0;
+         }
+         pairDatasetFree(chunks[i].pairs);
+     }
+     
+     free(chunks);
+     free(threads);
+     free(started);
+     return parsed;
+ }
+ 
+ static uint32_t swapWord(uint32_t word) {
+     return (word >> 24) | ((word >> 8) & 0xFF00u) | ((word << 8) & 0xFF0000u) | (word << 24);
+ }
  
-         if (expectingPlaintext) {
-             if (extractHexFromLine(buffer, plaintextHex, sizeof(plaintextHex))) {
-                 expectingPlaintext = 0;
+ // word-wise FNV-1a, extended over consecutive arrays through the running value
+ static uint32_t checksumWords(uint32_t checksum, const uint32_t *words, int count) {
+     for (int i = 0; i < count; i++) {
+         checksum = (checksum ^ words[i]) * 16777619u;
+     }
+     return checksum;
+ }
+ 
+ // checksum of the pairs in their current order, also used to fingerprint checkpoints
+ uint32_t pairDatasetChecksum(const PairDataset *dataset) {
+     uint32_t checksum = 2166136261u;
+     checksum = checksumWords(checksum, dataset->plaintextLeftArray, dataset->count);
+     checksum = checksumWords(checksum, dataset->plaintextRightArray, dataset->count);
+     checksum = checksumWords(checksum, dataset->ciphertextLeftArray, dataset->count);
+     return checksumWords(checksum, dataset->ciphertextRightArray, dataset->count);
+ }
+ 
+ /*
+  * taking the pairs of a mapped binary file: an empty dataset adopts the mapping and
+  * uses the arrays in place, otherwise (or for the other byte order) they are copied,
+  * returns 1 if the mapping was adopted, 0 if the caller still owns it, -1 on errors
+  */
+ static int loadBinaryMapping(PairDataset *dataset, void *mapped, size_t length, const char *filename) {
+     BinaryPairHeader header;
+     
+     if (length < sizeof(header)) {
+         datasetError(dataset, "Truncated binary header in %s", filename);
+         return -1;
+     }
+     memcpy(&header, mapped, sizeof(header));
+     
+     int swapped = header.byteOrder != BINARY_BYTE_ORDER_MARK;
+     if (swapped) {
+         if (swapWord(header.byteOrder) != BINARY_BYTE_ORDER_MARK) {
+             datasetError(dataset, "Unknown byte order in %s", filename);
+             return -1;
+         }
+         header.version = swapWord(header.version);
+         header.pairCount = swapWord(header.pairCount);
+         header.flags = swapWord(header.flags);
+         header.checksum = swapWord(header.checksum);
+         header.arrayStride = swapWord(header.arrayStride);
+     }
+     
+     if (header.version != BINARY_VERSION) {
+         datasetError(dataset, "Unsupported binary version %u in %s", header.version, filename);
+         return -1;
+     }
+     
+     size_t stride = header.arrayStride;
+     if (header.pairCount > 0x7FFFFFFFu || stride > 0x7FFFFFFFu || stride < header.pairCount ||
+         stride % DATASET_PAD_WORDS != 0 ||
+         (length - sizeof(header)) / sizeof(uint32_t) / DATASET_ARRAYS < stride) {
+         datasetError(dataset, "Truncated or inconsistent binary file %s", filename);
+         return -1;
+     }
+     
+     int count = (int)header.pairCount;
+     const uint32_t *arrays = (const uint32_t *)((const uint8_t *)mapped + sizeof(header));
+     int adopted = 0;
+     
+     if (!swapped && dataset->count == 0) {
+         free(dataset->arena);
+         dataset->arena = NULL;
+         dataset->mapping = mapped;
+         dataset->mappingLength = length;
+         dataset->plaintextLeftArray = (uint32_t *)arrays;
+         dataset->plaintextRightArray = (uint32_t *)arrays + stride;
+         dataset->ciphertextLeftArray = (uint32_t *)arrays + 2 * stride;
+         dataset->ciphertextRightArray = (uint32_t *)arrays + 3 * stride;
+         dataset->capacity = (int)stride;
+         dataset->count = count;
+         adopted = 1;
+     } else {
+         int first = dataset->count;
+         if (!pairDatasetAppendArrays(dataset, arrays, arrays + stride, arrays + 2 * stride, arrays + 3 * stride, count)) {
+             datasetError(dataset, "Memory reallocation failed");
+             return -1;
+         }
+         for (int i = first; swapped && i < dataset->count; i++) {
+             dataset->plaintextLeftArray[i] = swapWord(dataset->plaintextLeftArray[i]);
+             dataset->plaintextRightArray[i] = swapWord(dataset->plaintextRightArray[i]);
+             dataset->ciphertextLeftArray[i] = swapWord(dataset->ciphertextLeftArray[i]);
+             dataset->ciphertextRightArray[i] = swapWord(dataset->ciphertextRightArray[i]);
+         }
+     }
+     
+     // the stored checksum describes this file alone, so it is only kept for a fresh dataset
+     dataset->hasChecksum = (header.flags & BINARY_FLAG_CHECKSUM) && dataset->count == count;
+     dataset->checksum = header.checksum;
+     return adopted;
+ }
+ 
+ /*
+  * comparing the pairs against the checksum of the binary file they came from,
+  * a full pass over the data, so loading itself never does it,
+  * returns 1 if they match or there is no checksum to compare against
+  */
+ int pairDatasetVerifyChecksum(const PairDataset *dataset) {
+     return !dataset->hasChecksum || pairDatasetChecksum(dataset) == dataset->checksum;
+ }
+ 
+ /*
+  * writing the dataset as a binary pair file in native byte order, returns 1 on success
+  */
+ int pairDatasetSaveBinary(const PairDataset *dataset, const char *filename) {
+     FILE *file = fopen(filename, "wb");
+     if (!file) {
+         fprintf(stderr, "Error: Cannot create file %s\n", filename);
+         return 0;
+     }
+     
+     BinaryPairHeader header;
+     memset(&header, 0, sizeof(header));
+     memcpy(header.magic, BINARY_MAGIC, sizeof(header.magic));
+     header.version = BINARY_VERSION;
+     header.byteOrder = BINARY_BYTE_ORDER_MARK;
+     header.pairCount = (uint32_t)dataset->count;
+     header.flags = BINARY_FLAG_CHECKSUM;
+     header.checksum = pairDatasetChecksum(dataset);
+     header.arrayStride = (uint32_t)paddedCapacity(dataset->count);
+     
+     const uint32_t *arrays[DATASET_ARRAYS] = {
+         dataset->plaintextLeftArray, dataset->plaintextRightArray,
+         dataset->ciphertextLeftArray, dataset->ciphertextRightArray
+     };
+     static const uint32_t padding[DATASET_PAD_WORDS];
+     size_t paddingWords = header.arrayStride - (uint32_t)dataset->count;
+     int written = fwrite(&header, sizeof(header), 1, file) == 1;
+     
+     for (int array = 0; written && array < DATASET_ARRAYS; array++) {
+         written = fwrite(arrays[array], sizeof(uint32_t), dataset->count, file) == (size_t)dataset->count &&
+                   fwrite(padding, sizeof(uint32_t), paddingWords, file) == paddingWords;
+     }
+     
+     if (fclose(file) != 0 || !written) {
+         fprintf(stderr, "Error: Cannot write file %s\n", filename);
+         return 0;
+     }
+     return 1;
+ }
+ 
+ /*
+  * loading plaintext ciphertext pairs from a known.txt style file, appended to the dataset,
+  * regular files are mapped and parsed in place (by up to threadCount threads),
+  * pipes and "-" (stdin) are read line by line, files starting with BINARY_MAGIC are
+  * binary pair files used in place without parsing, returns the number of pairs held
+  */
+ int pairDatasetLoadThreaded(PairDataset *dataset, const char *filename, int threadCount) {
+     int loaded;
+     
+     if (strcmp(filename, "-") == 0) {
+         loaded = loadFromStream(dataset, stdin);
+     } else {
+         int fd = open(filename, O_RDONLY);
+         if (fd < 0) {
+             datasetError(dataset, "Cannot open file %s", filename);
+             return 0;
+         }
+         
+         struct stat info;
+         void *mapped = MAP_FAILED;
+         if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+             mapped = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+         }
+         
+         if (mapped != MAP_FAILED) {
+             close(fd);
+             size_t length = (size_t)info.st_size;
+             if (length >= sizeof(BINARY_MAGIC) - 1 && memcmp(mapped, BINARY_MAGIC, sizeof(BINARY_MAGIC) - 1) == 0) {
+                 int adopted = loadBinaryMapping(dataset, mapped, length, filename);
+                 if (adopted != 1) {
+                     munmap(mapped, length);
+                 }
+                 return dataset->count;
              }
+             
+             posix_madvise(mapped, length, POSIX_MADV_SEQUENTIAL);
+             loaded = parseMappedText(dataset, (const char *)mapped, length, threadCount);
+             munmap(mapped, length);
          } else {
-             if (extractHexFromLine(buffer, ciphertextHex, sizeof(ciphertextHex))) {
-                 if (storage.count >= storage.capacity) {
-                     if (!expandStorage()) {
-                         fclose(file);
-                         fprintf(stderr, "Error: Memory reallocation failed\n");
-                         return storage.count;
-                     }
-                 }
-                 
-                 storage.plaintextLeftArray[storage.count] = parseHexWord(plaintextHex, 8);
-                 storage.plaintextRightArray[storage.count] = parseHexWord(plaintextHex + 8, 8);
-                 storage.ciphertextLeftArray[storage.count] = parseHexWord(ciphertextHex, 8);
-                 storage.ciphertextRightArray[storage.count] = parseHexWord(ciphertextHex + 8, 8);
-                 
-                 storage.count++;
-                 expectingPlaintext = 1;
+             FILE *file = fdopen(fd, "r");
+             if (!file) {
+                 close(fd);
+                 datasetError(dataset, "Cannot open file %s", filename);
+                 return 0;
              }
+             loaded = loadFromStream(dataset, file);
+             fclose(file);
          }
      }
+     
+     if (!loaded) {
+         datasetError(dataset, "Memory reallocation failed");
+     }
+     return dataset->count;
+ }
  
-     fclose(file);
-     return storage.count;
+ int pairDatasetLoad(PairDataset *dataset, const char *filename) {
+     return pairDatasetLoadThreaded(dataset, filename, 1);
  }
- 
\ No newline at end of file
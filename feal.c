@@ -1,100 +1,306 @@
 /*
- * The FEAL cipher
+ * The FEAL cipher: one block demo and known pair generator,
+ * both built on the cipher library (cipher.h)
  */
 
  #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <pthread.h>
+ #include <unistd.h>
 
- #define WORD32 unsigned int
- #define BYTE   unsigned char
+ #include "cipher.h"
  
- #define ROUNDS 4
+ /* pairs every generator thread encrypts and formats per block */
+ #define GENERATE_BLOCK_PAIRS 65536
+ /* "Plaintext=  " 16 hex digits, "Ciphertext= " 16 hex digits, blank line */
+ #define PAIR_TEXT_LENGTH 59
+ /* rounds the generator accepts, the attack knows approximations for 3 and 4 */
+ #define GENERATE_MAX_ROUNDS 16
  
- #define ROT2(x) (((x)<<2) | ((x)>>6))
+ /* the dataset code the binary output is written with (data.c) */
+ typedef struct PairDataset PairDataset;
+ extern PairDataset *pairDatasetCreate(void);
+ extern void pairDatasetFree(PairDataset *dataset);
+ extern int pairDatasetAppendArrays(PairDataset *dataset, const uint32_t *plaintextLeft, const uint32_t *plaintextRight,
+                                    const uint32_t *ciphertextLeft, const uint32_t *ciphertextRight, int count);
+ extern int pairDatasetSaveBinary(const PairDataset *dataset, const char *filename);
  
- #define G0(a,b) (ROT2((BYTE)((a)+(b))))
- #define G1(a,b) (ROT2((BYTE)((a)+(b)+1)))
+ typedef struct
+ { /* one block of generated pairs, filled by one thread */
+     const uint32_t *subkeys;    /* rounds round keys and two whitening words */
+     int rounds;
+     uint64_t seed;
+     long first;                 /* index of the first pair of the block */
+     int count;
+     int text;                   /* format the block as known.txt text too */
+     uint32_t *left,*right;        /* plaintext halves */
+     uint32_t *cipherLeft,*cipherRight;
+     char *output;               /* count*PAIR_TEXT_LENGTH bytes when text */
+ } GenerateBlock;
  
- static WORD32 pack32(BYTE *b)
- { /* pack 4 bytes into a 32-bit Word */
-     return (WORD32)b[3]|((WORD32)b[2]<<8)|((WORD32)b[1]<<16)|((WORD32)b[0]<<24);
+ static uint64_t splitmix64(uint64_t x)
+ { /* plaintext of pair x, the same for any thread count and block size */
+     x+=0x9e3779b97f4a7c15ULL;
+     x=(x^(x>>30))*0xbf58476d1ce4e5b9ULL;
+     x=(x^(x>>27))*0x94d049bb133111ebULL;
+     return x^(x>>31);
  }
  
- static void unpack32(WORD32 a,BYTE *b)
- { /* unpack bytes from a 32-bit word */
-     b[0]=(BYTE)(a>>24);
-     b[1]=(BYTE)(a>>16);
-     b[2]=(BYTE)(a>>8);
-     b[3]=(BYTE)a;
+ static char *hex32(char *out,uint32_t word)
+ {
+     static const char digits[]="0123456789abcdef";
+     for (int i=7;i>=0;i--,word>>=4) out[i]=digits[word&0xF];
+     return out+8;
  }
  
- WORD32 f(WORD32 input)
+ static void *generateBlockMain(void *arg)
  {
-     BYTE x[4],y[4];
-     unpack32(input,x);
-     y[1]=G1(x[1]^x[0],x[2]^x[3]);
-     y[0]=G0(x[0],y[1]);
-     y[2]=G0(y[1],x[2]^x[3]);
-     y[3]=G1(y[2],x[3]);
-     return pack32(y);
+     GenerateBlock *block=(GenerateBlock *)arg;
+ 
+     for (int i=0;i<block->count;i++)
+     {
+         uint64_t plaintext=splitmix64(block->seed+(uint64_t)(block->first+i));
+         block->left[i]=(uint32_t)(plaintext>>32);
+         block->right[i]=(uint32_t)plaintext;
+     }
+     if (block->rounds==FEAL_ROUNDS)
+         fealEncryptBatch(block->left,block->right,block->cipherLeft,block->cipherRight,block->subkeys,block->count);
+     else
+     { /* the batch kernels are FEAL-4 only */
+         for (int i=0;i<block->count;i++)
+         {
+             uint32_t halves[2]={block->left[i],block->right[i]};
+             fealEncryptRounds(halves,block->subkeys,block->rounds);
+             block->cipherLeft[i]=halves[0];
+             block->cipherRight[i]=halves[1];
+         }
+     }
+ 
+     if (block->text)
+     {
+         char *out=block->output;
+         for (int i=0;i<block->count;i++)
+         {
+             memcpy(out,"Plaintext=  ",12);
+             out=hex32(hex32(out+12,block->left[i]),block->right[i]);
+             memcpy(out,"\nCiphertext= ",13);
+             out=hex32(hex32(out+13,block->cipherLeft[i]),block->cipherRight[i]);
+             memcpy(out,"\n\n",2);
+             out+=2;
+         }
+     }
+     return NULL;
  }
  
- void encrypt(BYTE data[8],WORD32 key[6])
+ /*
+  * generating count random known FEAL-rounds pairs under the given subkeys with threadCount
+  * threads, written in the known.txt format to outputFile (stdout if NULL) or as a
+  * binary pair file, the pairs depend only on the seed, returns 0 on failure
+  */
+ static int generatePairs(const uint32_t *subkeys,int rounds,long count,uint64_t seed,int threadCount,
+                          int binary,const char *outputFile)
  {
-     WORD32 left,right,temp;
+     GenerateBlock *blocks=(GenerateBlock *)calloc(threadCount,sizeof(GenerateBlock));
+     pthread_t *threads=(pthread_t *)calloc(threadCount,sizeof(pthread_t));
+     uint32_t *words=(uint32_t *)malloc((size_t)threadCount*4*GENERATE_BLOCK_PAIRS*sizeof(uint32_t));
+     char *text=binary?NULL:(char *)malloc((size_t)threadCount*GENERATE_BLOCK_PAIRS*PAIR_TEXT_LENGTH);
+     PairDataset *dataset=binary?pairDatasetCreate():NULL;
+     FILE *file=binary?NULL:(outputFile?fopen(outputFile,"w"):stdout);
+     int generated=blocks && threads && words && (binary?dataset!=NULL:text!=NULL);
+ 
+     if (!binary && !file)
+     {
+         fprintf(stderr,"Error: Cannot create file %s\n",outputFile);
+         generated=0;
+     }
+     else if (!generated)
+         fprintf(stderr,"Error: Memory allocation failed\n");
+ 
+     for (int i=0;generated && i<threadCount;i++)
+     {
+         uint32_t *base=words+(size_t)i*4*GENERATE_BLOCK_PAIRS;
+         blocks[i].subkeys=subkeys;
+         blocks[i].rounds=rounds;
+         blocks[i].seed=seed;
+         blocks[i].text=!binary;
+         blocks[i].left=base;
+         blocks[i].right=base+GENERATE_BLOCK_PAIRS;
+         blocks[i].cipherLeft=base+2*GENERATE_BLOCK_PAIRS;
+         blocks[i].cipherRight=base+3*GENERATE_BLOCK_PAIRS;
+         blocks[i].output=text?text+(size_t)i*GENERATE_BLOCK_PAIRS*PAIR_TEXT_LENGTH:NULL;
+     }
+ 
+     /* one block per thread at a time, written out in pair order */
+     for (long first=0;generated && first<count;)
+     {
+         int used=0,started=0;
+         for (;used<threadCount && first<count;used++)
+         {
+             blocks[used].first=first;
+             blocks[used].count=count-first<GENERATE_BLOCK_PAIRS?(int)(count-first):GENERATE_BLOCK_PAIRS;
+             first+=blocks[used].count;
+         }
+         for (started=1;started<used;started++)
+             if (pthread_create(&threads[started],NULL,generateBlockMain,&blocks[started])!=0) break;
+         generateBlockMain(&blocks[0]);
+         for (int i=started;i<used;i++) generateBlockMain(&blocks[i]);
+         for (int i=1;i<started;i++) pthread_join(threads[i],NULL);
+ 
+         for (int i=0;generated && i<used;i++)
+         {
+             if (binary)
+             {
+                 generated=pairDatasetAppendArrays(dataset,blocks[i].left,blocks[i].right,
+                                                   blocks[i].cipherLeft,blocks[i].cipherRight,blocks[i].count);
+                 if (!generated) fprintf(stderr,"Error: Memory allocation failed\n");
+             }
+             else
+             {
+                 size_t length=(size_t)blocks[i].count*PAIR_TEXT_LENGTH;
+                 generated=fwrite(blocks[i].output,1,length,file)==length;
+             }
+         }
+     }
  
-     left=pack32(&data[0]);
-     right=left^pack32(&data[4]);
-     
-     for (int i=0;i<ROUNDS;i++)
+     if (binary)
+         generated=generated && pairDatasetSaveBinary(dataset,outputFile);
+     else if (file)
      {
-         temp=right;
-         right=left^f(right^key[i]);
-         left=temp;
+         int closed=file==stdout?fflush(file)==0:fclose(file)==0;
+         if (generated && !closed) generated=0;
+         if (!generated && file) fprintf(stderr,"Error: Cannot write %s\n",outputFile?outputFile:"standard output");
      }
-     
-     temp=left;
-     left=right^key[4];
-     right=temp^right^key[5];
-     
-     unpack32(left,&data[0]);
-     unpack32(right,&data[4]);
+ 
+     pairDatasetFree(dataset);
+     free(text);
+     free(words);
+     free(threads);
+     free(blocks);
+     return generated;
  }
  
- void decrypt(BYTE data[8],WORD32 key[6])
+ static void generateUsage(void)
  {
-     WORD32 left,right,temp;
-     
-     right=pack32(&data[0])^key[4];
-     left=right^pack32(&data[4])^key[5];
-     
-     for (int i=0;i<ROUNDS;i++)
+     printf("feal --generate COUNT [--rounds N] [--key K0,K1,...] [--seed N] [--threads N]\n");
+     printf("     [--binary] [--output FILE]\n");
+     printf("  writes COUNT random FEAL-N (default 4) plaintext/ciphertext pairs in the\n");
+     printf("  known.txt format (stdout unless --output), --binary writes a binary pair\n");
+     printf("  file (needs --output), the key is N + 2 hex subkeys, all zero by default\n");
+ }
+ 
+ /* parsing comma separated hex subkeys, returns how many were given or -1 */
+ static int parseSubkeys(const char *text,uint32_t *subkeys,int maxWords)
+ {
+     int words=0;
+     char *end;
+ 
+     for (;;)
      {
-         temp=left;
-         left=right^f(left^key[ROUNDS-1-i]);
-         right=temp;
+         if (words==maxWords) return -1;
+         subkeys[words++]=(uint32_t)strtoul(text,&end,16);
+         if (end==text) return -1;
+         if (*end=='\0') return words;
+         if (*end!=',') return -1;
+         text=end+1;
      }
-     
-     right^=left;
-     
-     unpack32(left,&data[0]);
-     unpack32(right,&data[4]);
  }
  
+ static int generateMain(int argc,char **argv)
+ {
+     uint32_t subkeys[GENERATE_MAX_ROUNDS+2]={0};
+     const char *keyText=NULL;
+     int rounds=FEAL_ROUNDS;
+     long count=0;
+     uint64_t seed=1;
+     long onlineCpus=sysconf(_SC_NPROCESSORS_ONLN);
+     int threadCount=onlineCpus>0?(int)onlineCpus:1;
+     int binary=0;
+     const char *outputFile=NULL;
+     char *end;
+ 
+     for (int i=0;i<argc;i++)
+     {
+         if (strcmp(argv[i],"--generate")==0 && i+1<argc)
+         {
+             count=strtol(argv[++i],&end,10);
+             if (*end || count<1 || count>0x7fffffffL)
+             {
+                 fprintf(stderr,"Error: Invalid pair count %s\n",argv[i]);
+                 return 1;
+             }
+         }
+         else if (strcmp(argv[i],"--key")==0 && i+1<argc) keyText=argv[++i];
+         else if (strcmp(argv[i],"--rounds")==0 && i+1<argc)
+         {
+             rounds=(int)strtol(argv[++i],&end,10);
+             if (*end || rounds<1 || rounds>GENERATE_MAX_ROUNDS)
+             {
+                 fprintf(stderr,"Error: Invalid round count %s (1 to %d)\n",argv[i],GENERATE_MAX_ROUNDS);
+                 return 1;
+             }
+         }
+         else if (strcmp(argv[i],"--seed")==0 && i+1<argc)
+         {
+             seed=strtoull(argv[++i],&end,0);
+             if (*end)
+             {
+                 fprintf(stderr,"Error: Invalid seed %s\n",argv[i]);
+                 return 1;
+             }
+         }
+         else if (strcmp(argv[i],"--threads")==0 && i+1<argc)
+         {
+             threadCount=(int)strtol(argv[++i],&end,10);
+             if (*end || threadCount<1)
+             {
+                 fprintf(stderr,"Error: Invalid thread count %s\n",argv[i]);
+                 return 1;
+             }
+         }
+         else if (strcmp(argv[i],"--binary")==0) binary=1;
+         else if (strcmp(argv[i],"--output")==0 && i+1<argc) outputFile=argv[++i];
+         else
+         {
+             generateUsage();
+             return 1;
+         }
+     }
+ 
+     if (count<1 || (binary && !outputFile))
+     {
+         generateUsage();
+         return 1;
+     }
+ 
+     if (keyText && parseSubkeys(keyText,subkeys,GENERATE_MAX_ROUNDS+2)!=rounds+2)
+     {
+         fprintf(stderr,"Error: Invalid key %s (%d comma separated hex subkeys)\n",keyText,rounds+2);
+         return 1;
+     }
+ 
+     return generatePairs(subkeys,rounds,count,seed,threadCount,binary,outputFile)?0:1;
+ }
  
  /* Not the key you are looking for!!! */
- WORD32 key[6]={0x0,0x0,0x0,0x0,0x0,0x0};
+ uint32_t key[6]={0x0,0x0,0x0,0x0,0x0,0x0};
  
  int main(int argc,char **argv)
  {
-     BYTE data[8];
+     uint8_t data[8];
    
      argc--; argv++;
    
+     if (argc>0 && strncmp(argv[0],"--",2)==0)
+         return generateMain(argc,argv);
+ 
      if (argc!=8)
      {
          printf("command line error - input 8 bytes of plaintext in hex\n");
          printf("For example:-\n");
          printf("feal 01 23 45 67 89 ab cd ef\n");
+         printf("or generate known pairs:-\n");
+         generateUsage();
          return 0;
      }
      for (int i=0;i<8;i++)
@@ -104,13 +310,13 @@
      for (int i=0;i<8;i++) printf("%02x",data[i]);
      printf("\n");
  
-     encrypt(data,key);
+     fealEncryptBlock(data,key);
      printf("Ciphertext= ");
      for (int i=0;i<8;i++) printf("%02x",data[i]);
  
      printf("\n");
  
-     decrypt(data,key);
+     fealDecryptBlock(data,key);
      printf("Plaintext=  ");
      for (int i=0;i<8;i++) printf("%02x",data[i]);
      printf("\n");
@@ -0,0 +1,93 @@
+/*
+ * feal attack library (libfealattack.a, attack.c built without main) for running
+ * attacks inside another program: an attack owns its pairs, parameters and results,
+ * any number of them may run at once, each synchronously on the calling thread
+ * (as worker 0) or on a thread of its own with a completion callback, and can be
+ * cancelled from any thread, link with -pthread -ldl, only the fealAttack symbols
+ * are exported
+*/
+
+#ifndef FEAL_ATTACK_H
+#define FEAL_ATTACK_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FEAL_ATTACK_MAX_KEY_WORDS 6   // K0..K5 of FEAL-4, FEAL-3 keys have five words
+
+typedef struct FealAttack FealAttack;
+
+// exhaustive search order (ignored by ranked searches)
+enum { FEAL_SEARCH_BREADTH_FIRST, FEAL_SEARCH_DEPTH_FIRST };
+
+// reporting every key of a class of equivalent keys, only its representative, or
+// searching every equivalent key on its own, as --key-classes
+enum { FEAL_KEY_CLASSES_EXPAND, FEAL_KEY_CLASSES_REPRESENTATIVES, FEAL_KEY_CLASSES_OFF };
+
+// results of fealAttackRun and fealAttackWait
+enum { FEAL_ATTACK_COMPLETED, FEAL_ATTACK_CANCELLED, FEAL_ATTACK_FAILED };
+
+/*
+ * parameters of an attack, fealAttackDefaults sets the command line tool's defaults,
+ * keyFound is called from the worker that confirmed a key (keys of different workers
+ * may arrive at once), the found keys can also be read once the attack has finished
+ */
+typedef struct {
+    int threads;            // workers, 0 for one per online cpu
+    int rounds;             // FEAL-4 (default) or FEAL-3
+    double minimumBias;     // 0 < bias <= 0.5, below 0.5 tolerates noisy pairs (--min-bias)
+    int rankLimit;          // 0 for the exhaustive search, else the best candidates per stage (--rank)
+    int maxKeys;            // stop after this many keys, 0 for every equivalent key (1 = --first-key)
+    int search;             // FEAL_SEARCH_BREADTH_FIRST or FEAL_SEARCH_DEPTH_FIRST
+    int keyClasses;         // FEAL_KEY_CLASSES_*
+    int splitOuterSearch;   // per-byte outer tables (1, default) or the full outer sweep
+    int reorderPairs;       // most discriminating pairs first (1, default)
+    int shardIndex;         // search shard shardIndex (from 0) of shardCount
+    int shardCount;
+    void (*keyFound)(void *context, const uint32_t *key, int words);
+    void *context;
+} FealAttackConfig;
+
+void fealAttackDefaults(FealAttackConfig *config);
+// what is wrong with a configuration, NULL if fealAttackCreate accepts it
+const char *fealAttackConfigError(const FealAttackConfig *config);
+
+// a new attack without pairs, NULL if the configuration is invalid or memory ran out
+FealAttack *fealAttackCreate(const FealAttackConfig *config);
+// cancelling and waiting for a started attack, then releasing everything
+void fealAttackFree(FealAttack *attack);
+
+// adding pairs from a known.txt style or binary pair file, or from memory, before the
+// attack runs, return the number of pairs held (0 on failure, see fealAttackError)
+int fealAttackLoadFile(FealAttack *attack, const char *path);
+int fealAttackAddPairs(FealAttack *attack, const uint32_t *plaintextLeft, const uint32_t *plaintextRight,
+                       const uint32_t *ciphertextLeft, const uint32_t *ciphertextRight, int count);
+
+// running the attack on the calling thread, once per attack, returns a FEAL_ATTACK_* result
+int fealAttackRun(FealAttack *attack);
+// running it on a new thread, done (if not NULL) is called from there when it ends,
+// returns 0 if the thread cannot be started or the attack already ran
+int fealAttackStart(FealAttack *attack, void (*done)(FealAttack *attack, int result, void *context),
+                    void *context);
+// waiting for a started attack, returns its result
+int fealAttackWait(FealAttack *attack);
+// stopping a running (or not yet started) attack from any thread, the keys found so far remain
+void fealAttackCancel(FealAttack *attack);
+// the first error of the attack, NULL if there was none, the library never prints to
+// stderr, read it once the failing call (or the started attack) has returned
+const char *fealAttackError(const FealAttack *attack);
+
+// results of a finished attack, keys have fealAttackKeyWords words (K0..K(rounds+1))
+int fealAttackKeyCount(const FealAttack *attack);
+int fealAttackKeyWords(const FealAttack *attack);
+const uint32_t *fealAttackKey(const FealAttack *attack, int index);
+long fealAttackElapsedMs(const FealAttack *attack);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,519 @@
+/*
+ * optional OpenCL backend for the breadth-first stage sweeps: the fixed pair terms
+ * are uploaded once, then every batch of prefixes uploads its round inputs and runs
+ * the inner sweep over all (prefix, inner candidate) combinations and the outer sweep
+ * over all (prefix, inner key, outer candidate) rows as one kernel each, both return a
+ * compact list of (row, key) survivors, libOpenCL is loaded at runtime so neither the
+ * build nor machines without a GPU need the OpenCL sdk
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+
+typedef unsigned int uint32_t;
+typedef unsigned char uint8_t;
+typedef unsigned long long uint64_t;
+
+#define GPU_INNER_CANDIDATES (1 << 12)  // INNER_KEY_SPACE of attack.c
+#define GPU_OUTER_CANDIDATES (1 << 20)  // OUTER_KEY_SPACE of attack.c
+#define GPU_MIN_SURVIVORS 4096          // initial capacity of the survivor list
+
+// the subset of the OpenCL 1.2 api the backend uses, declared here instead of CL/cl.h
+typedef int cl_int;
+typedef unsigned int cl_uint;
+typedef unsigned long long cl_ulong;
+typedef struct OpaquePlatform *cl_platform_id;
+typedef struct OpaqueDevice *cl_device_id;
+typedef struct OpaqueContext *cl_context;
+typedef struct OpaqueQueue *cl_command_queue;
+typedef struct OpaqueProgram *cl_program;
+typedef struct OpaqueKernel *cl_kernel;
+typedef struct OpaqueMem *cl_mem;
+
+#define CL_SUCCESS 0
+#define CL_TRUE 1
+#define CL_DEVICE_TYPE_GPU (1ULL << 2)
+#define CL_DEVICE_TYPE_ALL 0xFFFFFFFFULL
+#define CL_DEVICE_NAME 0x102B
+#define CL_PROGRAM_BUILD_LOG 0x1183
+#define CL_MEM_READ_WRITE (1ULL << 0)
+#define CL_MEM_READ_ONLY (1ULL << 2)
+
+typedef struct {
+    cl_int (*getPlatformIDs)(cl_uint, cl_platform_id *, cl_uint *);
+    cl_int (*getDeviceIDs)(cl_platform_id, cl_ulong, cl_uint, cl_device_id *, cl_uint *);
+    cl_int (*getDeviceInfo)(cl_device_id, cl_uint, size_t, void *, size_t *);
+    cl_context (*createContext)(const void *, cl_uint, const cl_device_id *, void *, void *, cl_int *);
+    cl_command_queue (*createCommandQueue)(cl_context, cl_device_id, cl_ulong, cl_int *);
+    cl_program (*createProgramWithSource)(cl_context, cl_uint, const char **, const size_t *, cl_int *);
+    cl_int (*buildProgram)(cl_program, cl_uint, const cl_device_id *, const char *, void *, void *);
+    cl_int (*getProgramBuildInfo)(cl_program, cl_device_id, cl_uint, size_t, void *, size_t *);
+    cl_kernel (*createKernel)(cl_program, const char *, cl_int *);
+    cl_mem (*createBuffer)(cl_context, cl_ulong, size_t, void *, cl_int *);
+    cl_int (*setKernelArg)(cl_kernel, cl_uint, size_t, const void *);
+    cl_int (*enqueueWriteBuffer)(cl_command_queue, cl_mem, cl_uint, size_t, size_t, const void *,
+                                 cl_uint, const void *, void *);
+    cl_int (*enqueueReadBuffer)(cl_command_queue, cl_mem, cl_uint, size_t, size_t, void *,
+                                cl_uint, const void *, void *);
+    cl_int (*enqueueNDRangeKernel)(cl_command_queue, cl_kernel, cl_uint, const size_t *, const size_t *,
+                                   const size_t *, cl_uint, const void *, void *);
+    cl_int (*finish)(cl_command_queue);
+    cl_int (*releaseMemObject)(cl_mem);
+    cl_int (*releaseKernel)(cl_kernel);
+    cl_int (*releaseProgram)(cl_program);
+    cl_int (*releaseCommandQueue)(cl_command_queue);
+    cl_int (*releaseContext)(cl_context);
+} OpenClApi;
+
+/*
+ * the sweep kernels: the F-function and the candidate constructions follow cipher.c and
+ * attack.c, a candidate survives while at most maxDisagreements pairs disagree with the
+ * majority, tested pair by pair so most wrong candidates stop after a few pairs
+ */
+static const char *sweepKernelSource =
+    "uchar rotateLeft2(uchar x) {\n"
+    "    return (uchar)((x << 2) | (x >> 6));\n"
+    "}\n"
+    "\n"
+    "uint fealF(uint x) {\n"
+    "    uchar x0 = (uchar)(x >> 24), x1 = (uchar)(x >> 16), x2 = (uchar)(x >> 8), x3 = (uchar)x;\n"
+    "    uchar y1 = rotateLeft2((uchar)((x0 ^ x1) + (x2 ^ x3) + 1));\n"
+    "    uchar y0 = rotateLeft2((uchar)(x0 + y1));\n"
+    "    uchar y2 = rotateLeft2((uchar)(y1 + (x2 ^ x3)));\n"
+    "    uchar y3 = rotateLeft2((uchar)(y2 + x3 + 1));\n"
+    "    return ((uint)y0 << 24) | ((uint)y1 << 16) | ((uint)y2 << 8) | (uint)y3;\n"
+    "}\n"
+    "\n"
+    "int candidateConsistent(__global const uint *inputs, __global const uchar *fixedTerms, int pairCount,\n"
+    "                        int approximation, uint outputMask, int maxDisagreements, uint key) {\n"
+    "    int ones = 0;\n"
+    "    for (int pairIdx = 0; pairIdx < pairCount; pairIdx++) {\n"
+    "        ones += ((fixedTerms[pairIdx] >> approximation) ^ popcount(fealF(inputs[pairIdx] ^ key) & outputMask)) & 1;\n"
+    "        int zeros = pairIdx + 1 - ones;\n"
+    "        if ((ones < zeros ? ones : zeros) > maxDisagreements) {\n"
+    "            return 0;\n"
+    "        }\n"
+    "    }\n"
+    "    return 1;\n"
+    "}\n"
+    "\n"
+    "void keepSurvivor(__global uint *survivors, __global uint *survivorCount, uint capacity,\n"
+    "                  uint row, uint key) {\n"
+    "    uint slot = atomic_inc(survivorCount);\n"
+    "    if (slot < capacity) {\n"
+    "        survivors[2 * slot] = row;\n"
+    "        survivors[2 * slot + 1] = key;\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "// dimension 0 the 12-bit inner candidate, dimension 1 the prefix\n"
+    "__kernel void innerSweep(__global const uint *inputs, __global const uchar *fixedTerms, int pairCount,\n"
+    "                         int approximation, uint outputMask, int maxDisagreements,\n"
+    "                         __global uint *survivors, __global uint *survivorCount, uint capacity) {\n"
+    "    uint candidate = (uint)get_global_id(0);\n"
+    "    uint prefix = (uint)get_global_id(1);\n"
+    "    uint key = (((candidate >> 6) & 0x3F) << 16) | ((candidate & 0x3F) << 8);\n"
+    "    if (candidateConsistent(inputs + (size_t)prefix * pairCount, fixedTerms, pairCount,\n"
+    "                            approximation, outputMask, maxDisagreements, key)) {\n"
+    "        keepSurvivor(survivors, survivorCount, capacity, prefix, key);\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "// dimension 0 the 20-bit outer candidate, dimension 1 the (prefix, inner key) row\n"
+    "__kernel void outerSweep(__global const uint *inputs, __global const uchar *fixedTerms, int pairCount,\n"
+    "                         int approximation, uint outputMask, int maxDisagreements,\n"
+    "                         __global uint *survivors, __global uint *survivorCount, uint capacity,\n"
+    "                         __global const uint *rows, uint skippedIndexBits) {\n"
+    "    uint candidate = (uint)get_global_id(0);\n"
+    "    uint row = (uint)get_global_id(1);\n"
+    "    if (candidate & skippedIndexBits) {\n"
+    "        return;\n"
+    "    }\n"
+    "    uint prefix = rows[2 * row];\n"
+    "    uint innerKey = rows[2 * row + 1];\n"
+    "    uint a0 = ((((candidate & 0xF) >> 2) << 6) + ((innerKey >> 16) & 0xFF)) & 0xFF;\n"
+    "    uint a1 = (((candidate & 0x3) << 6) + ((innerKey >> 8) & 0xFF)) & 0xFF;\n"
+    "    uint b0 = (candidate >> 12) & 0xFF;\n"
+    "    uint b3 = (candidate >> 4) & 0xFF;\n"
+    "    uint key = (b0 << 24) | ((b0 ^ a0) << 16) | ((b3 ^ a1) << 8) | b3;\n"
+    "    if (candidateConsistent(inputs + (size_t)prefix * pairCount, fixedTerms, pairCount,\n"
+    "                            approximation, outputMask, maxDisagreements, key)) {\n"
+    "        keepSurvivor(survivors, survivorCount, capacity, prefix, key);\n"
+    "    }\n"
+    "}\n";
+
+typedef struct GpuSweeper {
+    void *library;
+    OpenClApi cl;
+    cl_context context;
+    cl_command_queue queue;
+    cl_program program;
+    cl_kernel innerKernel;
+    cl_kernel outerKernel;
+    cl_mem fixedTerms;
+    cl_mem inputs;
+    cl_mem rows;
+    cl_mem survivors;
+    cl_mem survivorCount;
+    size_t inputsBytes;         // allocated sizes of the growing buffers
+    size_t rowsBytes;
+    uint32_t survivorCapacity;  // (row, key) entries
+    uint32_t *hostSurvivors;
+    int pairCount;
+    int prefixCount;            // prefixes of the uploaded inputs
+    char deviceName[128];
+} GpuSweeper;
+
+static int loadSymbol(void *library, const char *name, void *function) {
+    void *symbol = dlsym(library, name);
+    if (!symbol) {
+        fprintf(stderr, "Error: %s is missing from the OpenCL library\n", name);
+        return 0;
+    }
+    // function pointers cannot be assigned from void * in iso c, copying is well defined on posix
+    memcpy(function, &symbol, sizeof(symbol));
+    return 1;
+}
+
+static int loadOpenCl(GpuSweeper *gpu) {
+    OpenClApi *cl = &gpu->cl;
+
+    gpu->library = dlopen("libOpenCL.so.1", RTLD_NOW | RTLD_LOCAL);
+    if (!gpu->library) {
+        gpu->library = dlopen("libOpenCL.so", RTLD_NOW | RTLD_LOCAL);
+    }
+    if (!gpu->library) {
+        fprintf(stderr, "Error: No OpenCL library (libOpenCL.so.1) found\n");
+        return 0;
+    }
+
+    return loadSymbol(gpu->library, "clGetPlatformIDs", &cl->getPlatformIDs) &&
+           loadSymbol(gpu->library, "clGetDeviceIDs", &cl->getDeviceIDs) &&
+           loadSymbol(gpu->library, "clGetDeviceInfo", &cl->getDeviceInfo) &&
+           loadSymbol(gpu->library, "clCreateContext", &cl->createContext) &&
+           loadSymbol(gpu->library, "clCreateCommandQueue", &cl->createCommandQueue) &&
+           loadSymbol(gpu->library, "clCreateProgramWithSource", &cl->createProgramWithSource) &&
+           loadSymbol(gpu->library, "clBuildProgram", &cl->buildProgram) &&
+           loadSymbol(gpu->library, "clGetProgramBuildInfo", &cl->getProgramBuildInfo) &&
+           loadSymbol(gpu->library, "clCreateKernel", &cl->createKernel) &&
+           loadSymbol(gpu->library, "clCreateBuffer", &cl->createBuffer) &&
+           loadSymbol(gpu->library, "clSetKernelArg", &cl->setKernelArg) &&
+           loadSymbol(gpu->library, "clEnqueueWriteBuffer", &cl->enqueueWriteBuffer) &&
+           loadSymbol(gpu->library, "clEnqueueReadBuffer", &cl->enqueueReadBuffer) &&
+           loadSymbol(gpu->library, "clEnqueueNDRangeKernel", &cl->enqueueNDRangeKernel) &&
+           loadSymbol(gpu->library, "clFinish", &cl->finish) &&
+           loadSymbol(gpu->library, "clReleaseMemObject", &cl->releaseMemObject) &&
+           loadSymbol(gpu->library, "clReleaseKernel", &cl->releaseKernel) &&
+           loadSymbol(gpu->library, "clReleaseProgram", &cl->releaseProgram) &&
+           loadSymbol(gpu->library, "clReleaseCommandQueue", &cl->releaseCommandQueue) &&
+           loadSymbol(gpu->library, "clReleaseContext", &cl->releaseContext);
+}
+
+// the first GPU of any platform, or the first device of any type if there is none
+static int selectDevice(GpuSweeper *gpu, cl_device_id *device) {
+    cl_platform_id platforms[16];
+    cl_uint platformCount = 0;
+
+    if (gpu->cl.getPlatformIDs(16, platforms, &platformCount) != CL_SUCCESS || platformCount == 0) {
+        fprintf(stderr, "Error: No OpenCL platform is installed\n");
+        return 0;
+    }
+    platformCount = platformCount < 16 ? platformCount : 16;
+
+    static const cl_ulong deviceTypes[2] = {CL_DEVICE_TYPE_GPU, CL_DEVICE_TYPE_ALL};
+    for (int typeIdx = 0; typeIdx < 2; typeIdx++) {
+        for (cl_uint platformIdx = 0; platformIdx < platformCount; platformIdx++) {
+            cl_uint deviceCount = 0;
+            if (gpu->cl.getDeviceIDs(platforms[platformIdx], deviceTypes[typeIdx], 1, device,
+                                     &deviceCount) == CL_SUCCESS && deviceCount > 0) {
+                return 1;
+            }
+        }
+    }
+
+    fprintf(stderr, "Error: No OpenCL device found\n");
+    return 0;
+}
+
+static int buildKernels(GpuSweeper *gpu, cl_device_id device) {
+    cl_int status;
+
+    gpu->program = gpu->cl.createProgramWithSource(gpu->context, 1, &sweepKernelSource, NULL, &status);
+    if (!gpu->program) {
+        fprintf(stderr, "Error: Cannot create the OpenCL program (%d)\n", status);
+        return 0;
+    }
+
+    status = gpu->cl.buildProgram(gpu->program, 1, &device, "", NULL, NULL);
+    if (status != CL_SUCCESS) {
+        char log[4096] = "";
+        gpu->cl.getProgramBuildInfo(gpu->program, device, CL_PROGRAM_BUILD_LOG, sizeof(log) - 1, log, NULL);
+        fprintf(stderr, "Error: Cannot build the sweep kernels (%d)\n%s\n", status, log);
+        return 0;
+    }
+
+    gpu->innerKernel = gpu->cl.createKernel(gpu->program, "innerSweep", &status);
+    gpu->outerKernel = gpu->innerKernel ? gpu->cl.createKernel(gpu->program, "outerSweep", &status) : NULL;
+    if (!gpu->outerKernel) {
+        fprintf(stderr, "Error: Cannot create the sweep kernels (%d)\n", status);
+        return 0;
+    }
+    return 1;
+}
+
+void gpuSweeperFree(GpuSweeper *gpu);
+
+/*
+ * opening the first OpenCL GPU (or other device) and building the sweep kernels,
+ * NULL with the reason on stderr if there is no usable OpenCL installation
+ */
+GpuSweeper *gpuSweeperCreate(void) {
+    GpuSweeper *gpu = (GpuSweeper *)calloc(1, sizeof(GpuSweeper));
+    if (!gpu) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return NULL;
+    }
+
+    cl_device_id device;
+    cl_int status = CL_SUCCESS;
+    if (!loadOpenCl(gpu) || !selectDevice(gpu, &device)) {
+        gpuSweeperFree(gpu);
+        return NULL;
+    }
+
+    gpu->cl.getDeviceInfo(device, CL_DEVICE_NAME, sizeof(gpu->deviceName) - 1, gpu->deviceName, NULL);
+    gpu->context = gpu->cl.createContext(NULL, 1, &device, NULL, NULL, &status);
+    gpu->queue = gpu->context ? gpu->cl.createCommandQueue(gpu->context, device, 0, &status) : NULL;
+    if (!gpu->queue) {
+        fprintf(stderr, "Error: Cannot open OpenCL device %s (%d)\n", gpu->deviceName, status);
+        gpuSweeperFree(gpu);
+        return NULL;
+    }
+
+    gpu->survivorCount = gpu->cl.createBuffer(gpu->context, CL_MEM_READ_WRITE, sizeof(uint32_t), NULL, &status);
+    if (!gpu->survivorCount || !buildKernels(gpu, device)) {
+        gpuSweeperFree(gpu);
+        return NULL;
+    }
+    return gpu;
+}
+
+void gpuSweeperFree(GpuSweeper *gpu) {
+    if (!gpu) {
+        return;
+    }
+
+    cl_mem buffers[5] = {gpu->fixedTerms, gpu->inputs, gpu->rows, gpu->survivors, gpu->survivorCount};
+    for (int bufferIdx = 0; bufferIdx < 5; bufferIdx++) {
+        if (buffers[bufferIdx]) {
+            gpu->cl.releaseMemObject(buffers[bufferIdx]);
+        }
+    }
+    if (gpu->innerKernel) {
+        gpu->cl.releaseKernel(gpu->innerKernel);
+    }
+    if (gpu->outerKernel) {
+        gpu->cl.releaseKernel(gpu->outerKernel);
+    }
+    if (gpu->program) {
+        gpu->cl.releaseProgram(gpu->program);
+    }
+    if (gpu->queue) {
+        gpu->cl.releaseCommandQueue(gpu->queue);
+    }
+    if (gpu->context) {
+        gpu->cl.releaseContext(gpu->context);
+    }
+    if (gpu->library) {
+        dlclose(gpu->library);
+    }
+    free(gpu->hostSurvivors);
+    free(gpu);
+}
+
+const char *gpuSweeperDeviceName(const GpuSweeper *gpu) {
+    return gpu->deviceName;
+}
+
+// a device buffer of at least bytes, reallocated (without its contents) when too small
+static int reserveBuffer(GpuSweeper *gpu, cl_mem *buffer, size_t *allocated, size_t bytes, cl_ulong flags) {
+    if (*buffer && *allocated >= bytes) {
+        return 1;
+    }
+    if (*buffer) {
+        gpu->cl.releaseMemObject(*buffer);
+    }
+
+    cl_int status;
+    *allocated = bytes > *allocated * 2 ? bytes : *allocated * 2;
+    *buffer = gpu->cl.createBuffer(gpu->context, flags, *allocated, NULL, &status);
+    if (!*buffer) {
+        *allocated = 0;
+        fprintf(stderr, "Error: Cannot allocate %zu bytes on the OpenCL device (%d)\n", bytes, status);
+        return 0;
+    }
+    return 1;
+}
+
+static int writeBuffer(GpuSweeper *gpu, cl_mem buffer, size_t offset, size_t bytes, const void *data) {
+    cl_int status = gpu->cl.enqueueWriteBuffer(gpu->queue, buffer, CL_TRUE, offset, bytes, data, 0, NULL, NULL);
+    if (status != CL_SUCCESS) {
+        fprintf(stderr, "Error: OpenCL upload failed (%d)\n", status);
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * uploading the key-independent approximation bits of every pair (bit n of a byte for
+ * approximation n, as in attack.c), once per attack after the pair order is final
+ */
+int gpuSweeperLoadPairs(GpuSweeper *gpu, const uint8_t *fixedTerms, int pairCount) {
+    size_t allocated = 0;
+
+    if (gpu->fixedTerms) {
+        gpu->cl.releaseMemObject(gpu->fixedTerms);
+        gpu->fixedTerms = NULL;
+    }
+    gpu->pairCount = pairCount;
+    return reserveBuffer(gpu, &gpu->fixedTerms, &allocated, (size_t)pairCount, CL_MEM_READ_ONLY) &&
+           writeBuffer(gpu, gpu->fixedTerms, 0, (size_t)pairCount, fixedTerms);
+}
+
+/*
+ * uploading the round inputs of a batch of prefixes, inputs[p] holds the F input of the
+ * searched round for every pair below prefix p, the rows of the sweeps refer to p
+ */
+int gpuSweeperLoadInputs(GpuSweeper *gpu, const uint32_t *const *inputs, int prefixCount) {
+    size_t prefixBytes = (size_t)gpu->pairCount * sizeof(uint32_t);
+
+    if (!reserveBuffer(gpu, &gpu->inputs, &gpu->inputsBytes, prefixBytes * prefixCount, CL_MEM_READ_ONLY)) {
+        return 0;
+    }
+    for (int prefixIdx = 0; prefixIdx < prefixCount; prefixIdx++) {
+        if (!writeBuffer(gpu, gpu->inputs, prefixIdx * prefixBytes, prefixBytes, inputs[prefixIdx])) {
+            return 0;
+        }
+    }
+    gpu->prefixCount = prefixCount;
+    return 1;
+}
+
+static int setArgument(GpuSweeper *gpu, cl_kernel kernel, cl_uint index, size_t size, const void *value) {
+    cl_int status = gpu->cl.setKernelArg(kernel, index, size, value);
+    if (status != CL_SUCCESS) {
+        fprintf(stderr, "Error: Cannot set argument %u of a sweep kernel (%d)\n", index, status);
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * running one sweep kernel over candidates x rows work items until its survivors fit
+ * the list, which grows and reruns the kernel when they overflow, returns the number
+ * of survivors in gpu->hostSurvivors or -1 on a device error
+ */
+static int runSweep(GpuSweeper *gpu, cl_kernel kernel, size_t candidates, size_t rows,
+                    int approximation, uint32_t outputMask, int maxDisagreements) {
+    for (;;) {
+        if (!gpu->survivors) {
+            size_t bytes = 0;
+            uint32_t capacity = gpu->survivorCapacity > GPU_MIN_SURVIVORS ? gpu->survivorCapacity : GPU_MIN_SURVIVORS;
+            uint32_t *host = (uint32_t *)realloc(gpu->hostSurvivors, 2 * (size_t)capacity * sizeof(uint32_t));
+            if (!host) {
+                fprintf(stderr, "Error: Memory allocation failed\n");
+                return -1;
+            }
+            gpu->hostSurvivors = host;
+            if (!reserveBuffer(gpu, &gpu->survivors, &bytes, 2 * (size_t)capacity * sizeof(uint32_t),
+                               CL_MEM_READ_WRITE)) {
+                return -1;
+            }
+            gpu->survivorCapacity = capacity;
+        }
+
+        uint32_t zero = 0;
+        if (!writeBuffer(gpu, gpu->survivorCount, 0, sizeof(zero), &zero) ||
+            !setArgument(gpu, kernel, 0, sizeof(cl_mem), &gpu->inputs) ||
+            !setArgument(gpu, kernel, 1, sizeof(cl_mem), &gpu->fixedTerms) ||
+            !setArgument(gpu, kernel, 2, sizeof(int), &gpu->pairCount) ||
+            !setArgument(gpu, kernel, 3, sizeof(int), &approximation) ||
+            !setArgument(gpu, kernel, 4, sizeof(uint32_t), &outputMask) ||
+            !setArgument(gpu, kernel, 5, sizeof(int), &maxDisagreements) ||
+            !setArgument(gpu, kernel, 6, sizeof(cl_mem), &gpu->survivors) ||
+            !setArgument(gpu, kernel, 7, sizeof(cl_mem), &gpu->survivorCount) ||
+            !setArgument(gpu, kernel, 8, sizeof(uint32_t), &gpu->survivorCapacity)) {
+            return -1;
+        }
+
+        size_t globalSize[2] = {candidates, rows};
+        uint32_t found = 0;
+        cl_int status = gpu->cl.enqueueNDRangeKernel(gpu->queue, kernel, 2, NULL, globalSize, NULL, 0, NULL, NULL);
+        if (status == CL_SUCCESS) {
+            status = gpu->cl.enqueueReadBuffer(gpu->queue, gpu->survivorCount, CL_TRUE, 0, sizeof(found), &found,
+                                               0, NULL, NULL);
+        }
+        if (status != CL_SUCCESS) {
+            fprintf(stderr, "Error: OpenCL sweep failed (%d)\n", status);
+            return -1;
+        }
+
+        if (found <= gpu->survivorCapacity) {
+            if (found > 0) {
+                status = gpu->cl.enqueueReadBuffer(gpu->queue, gpu->survivors, CL_TRUE, 0,
+                                                   2 * (size_t)found * sizeof(uint32_t), gpu->hostSurvivors,
+                                                   0, NULL, NULL);
+                if (status != CL_SUCCESS) {
+                    fprintf(stderr, "Error: OpenCL download failed (%d)\n", status);
+                    return -1;
+                }
+            }
+            return (int)found;
+        }
+
+        // too many survivors for the list, rerunning with room for all of them
+        gpu->cl.releaseMemObject(gpu->survivors);
+        gpu->survivors = NULL;
+        gpu->survivorCapacity = found;
+    }
+}
+
+/*
+ * the inner sweep of every uploaded prefix, *survivors points to (prefix, inner key)
+ * entries valid until the next sweep, returns their number or -1 on a device error
+ */
+int gpuSweeperInner(GpuSweeper *gpu, int approximation, uint32_t outputMask, int maxDisagreements,
+                    const uint32_t **survivors) {
+    int found = runSweep(gpu, gpu->innerKernel, GPU_INNER_CANDIDATES, gpu->prefixCount,
+                         approximation, outputMask, maxDisagreements);
+    *survivors = gpu->hostSurvivors;
+    return found;
+}
+
+/*
+ * the outer sweep of rowCount (prefix, inner key) rows, outer indices with any of
+ * skippedIndexBits set are not tried, *survivors points to (prefix, stage key)
+ * entries valid until the next sweep, returns their number or -1 on a device error
+ */
+int gpuSweeperOuter(GpuSweeper *gpu, int approximation, uint32_t outputMask, int maxDisagreements,
+                    const uint32_t *rows, int rowCount, uint32_t skippedIndexBits, const uint32_t **survivors) {
+    size_t rowBytes = 2 * (size_t)rowCount * sizeof(uint32_t);
+
+    *survivors = gpu->hostSurvivors;
+    if (rowCount == 0) {
+        return 0;
+    }
+    if (!reserveBuffer(gpu, &gpu->rows, &gpu->rowsBytes, rowBytes, CL_MEM_READ_ONLY) ||
+        !writeBuffer(gpu, gpu->rows, 0, rowBytes, rows) ||
+        !setArgument(gpu, gpu->outerKernel, 9, sizeof(cl_mem), &gpu->rows) ||
+        !setArgument(gpu, gpu->outerKernel, 10, sizeof(uint32_t), &skippedIndexBits)) {
+        return -1;
+    }
+
+    int found = runSweep(gpu, gpu->outerKernel, GPU_OUTER_CANDIDATES, rowCount,
+                         approximation, outputMask, maxDisagreements);
+    *survivors = gpu->hostSurvivors;
+    return found;
+}
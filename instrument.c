@@ -0,0 +1,193 @@
+/*
+ * instrumentation helpers of the attack: a progress thread that calls a report
+ * function at a fixed interval until stopped, and process-wide hardware counters
+ * (cycles, instructions, cache misses) through perf events, which count the
+ * opening thread and every thread it creates afterwards
+*/
+
+// syscall() is not part of posix
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+typedef unsigned long long uint64_t;
+
+#define HARDWARE_COUNTER_COUNT 3
+
+typedef void (*ProgressReport)(void *context);
+
+typedef struct ProgressMonitor {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    long intervalMs;
+    ProgressReport report;
+    void *context;
+    int stopRequested;
+} ProgressMonitor;
+
+typedef struct HardwareCounters {
+    int fds[HARDWARE_COUNTER_COUNT];
+} HardwareCounters;
+
+// the monotonic clock the condition variable waits on, intervalMs from now
+static void deadlineAfter(long intervalMs, struct timespec *deadline) {
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += intervalMs / 1000;
+    deadline->tv_nsec += (intervalMs % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+static void *monitorMain(void *arg) {
+    ProgressMonitor *monitor = (ProgressMonitor *)arg;
+    struct timespec deadline;
+
+    pthread_mutex_lock(&monitor->lock);
+    deadlineAfter(monitor->intervalMs, &deadline);
+    while (!monitor->stopRequested) {
+        if (pthread_cond_timedwait(&monitor->wakeup, &monitor->lock, &deadline) != ETIMEDOUT) {
+            continue;
+        }
+
+        // the search is not held up while the report is formatted
+        pthread_mutex_unlock(&monitor->lock);
+        monitor->report(monitor->context);
+        pthread_mutex_lock(&monitor->lock);
+        deadlineAfter(monitor->intervalMs, &deadline);
+    }
+    pthread_mutex_unlock(&monitor->lock);
+    return NULL;
+}
+
+/*
+ * starting a thread that calls report(context) every intervalMs milliseconds,
+ * report reads shared counters only and must not block, NULL on failure
+ */
+ProgressMonitor *progressMonitorCreate(long intervalMs, ProgressReport report, void *context) {
+    if (intervalMs < 1 || !report) {
+        return NULL;
+    }
+
+    ProgressMonitor *monitor = (ProgressMonitor *)calloc(1, sizeof(ProgressMonitor));
+    if (!monitor) {
+        return NULL;
+    }
+
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&monitor->wakeup, &attributes);
+    pthread_condattr_destroy(&attributes);
+    pthread_mutex_init(&monitor->lock, NULL);
+
+    monitor->intervalMs = intervalMs;
+    monitor->report = report;
+    monitor->context = context;
+    if (pthread_create(&monitor->thread, NULL, monitorMain, monitor) != 0) {
+        pthread_mutex_destroy(&monitor->lock);
+        pthread_cond_destroy(&monitor->wakeup);
+        free(monitor);
+        return NULL;
+    }
+    return monitor;
+}
+
+// stopping the progress thread, a report in progress is finished first
+void progressMonitorFree(ProgressMonitor *monitor) {
+    if (!monitor) {
+        return;
+    }
+
+    pthread_mutex_lock(&monitor->lock);
+    monitor->stopRequested = 1;
+    pthread_cond_signal(&monitor->wakeup);
+    pthread_mutex_unlock(&monitor->lock);
+    pthread_join(monitor->thread, NULL);
+
+    pthread_mutex_destroy(&monitor->lock);
+    pthread_cond_destroy(&monitor->wakeup);
+    free(monitor);
+}
+
+#ifdef __linux__
+static int openCounter(uint64_t config) {
+    struct perf_event_attr attributes;
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.config = config;
+    attributes.inherit = 1;         // threads created later are counted too
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+}
+#endif
+
+/*
+ * opening the hardware counters for this process, must be called before the
+ * worker threads are created, NULL if perf events are unavailable (not linux,
+ * no hardware counters, or forbidden by perf_event_paranoid)
+ */
+HardwareCounters *hardwareCountersOpen(void) {
+#ifdef __linux__
+    static const uint64_t configs[HARDWARE_COUNTER_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES
+    };
+    HardwareCounters *counters = (HardwareCounters *)malloc(sizeof(HardwareCounters));
+    if (!counters) {
+        return NULL;
+    }
+
+    for (int counterIdx = 0; counterIdx < HARDWARE_COUNTER_COUNT; counterIdx++) {
+        counters->fds[counterIdx] = openCounter(configs[counterIdx]);
+        if (counters->fds[counterIdx] < 0) {
+            while (--counterIdx >= 0) {
+                close(counters->fds[counterIdx]);
+            }
+            free(counters);
+            return NULL;
+        }
+    }
+    return counters;
+#else
+    return NULL;
+#endif
+}
+
+/*
+ * reading cycles, instructions and cache misses counted so far (values needs
+ * HARDWARE_COUNTER_COUNT entries), returns 0 if a counter cannot be read
+ */
+int hardwareCountersRead(const HardwareCounters *counters, uint64_t *values) {
+    for (int counterIdx = 0; counterIdx < HARDWARE_COUNTER_COUNT; counterIdx++) {
+        if (read(counters->fds[counterIdx], &values[counterIdx], sizeof(uint64_t)) != sizeof(uint64_t)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void hardwareCountersClose(HardwareCounters *counters) {
+    if (!counters) {
+        return;
+    }
+
+    for (int counterIdx = 0; counterIdx < HARDWARE_COUNTER_COUNT; counterIdx++) {
+        close(counters->fds[counterIdx]);
+    }
+    free(counters);
+}
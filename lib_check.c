@@ -0,0 +1,40 @@
+/*
+ * client check of the attack library (make lib): built once as C and once as C++
+ * against fealattack.h after the standard headers, it attacks a pair file and
+ * fails unless every equivalent key is found without errors
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "fealattack.h"
+
+int main(int argc, char **argv) {
+    FealAttackConfig config;
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s known-pairs-file\n", argv[0]);
+        return 1;
+    }
+
+    fealAttackDefaults(&config);
+    FealAttack *attack = fealAttackCreate(&config);
+    if (!attack) {
+        fprintf(stderr, "Error: Cannot create the attack\n");
+        return 1;
+    }
+
+    int completed = fealAttackLoadFile(attack, argv[1]) > 0 && fealAttackRun(attack) == FEAL_ATTACK_COMPLETED;
+    int keys = fealAttackKeyCount(attack);
+    if (!completed || keys != 1 << (2 * config.rounds) || fealAttackError(attack)) {
+        fprintf(stderr, "Error: Library attack found %d keys (%s)\n", keys,
+                fealAttackError(attack) ? fealAttackError(attack) : "no error");
+        fealAttackFree(attack);
+        return 1;
+    }
+
+    printf("Library attack found %d keys of %d words in %ld ms\n", keys, fealAttackKeyWords(attack),
+           fealAttackElapsedMs(attack));
+    fealAttackFree(attack);
+    return 0;
+}
@@ -0,0 +1,292 @@
+/*
+ * work-stealing task pool for the parallel key search,
+ * every worker owns a deque: it pushes and pops at the tail (depth first),
+ * idle workers steal from the head of other deques (oldest, largest subtrees)
+*/
+
+// the thread affinity calls are gnu extensions
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define INITIAL_DEQUE_CAPACITY 64
+
+typedef struct TaskPool TaskPool;
+typedef void (*TaskRunner)(TaskPool *pool, int workerId, void *task);
+
+typedef struct {
+    pthread_mutex_t lock;
+    unsigned char *tasks;  // taskSize bytes per slot
+    int head;              // next slot to steal from
+    int tail;              // next free slot (owner end)
+    int capacity;
+} TaskDeque;
+
+struct TaskPool {
+    TaskDeque *deques;
+    int workerCount;
+    size_t taskSize;
+    TaskRunner runTask;
+    long pendingTasks;     // pushed but not yet finished
+    int stopRequested;
+    int *workerCpus;       // cpu every worker is pinned to, NULL to leave placement to the os
+    void *context;         // the runner's shared state, see taskPoolContext
+};
+
+typedef struct {
+    TaskPool *pool;
+    int workerId;
+} WorkerArgs;
+
+TaskPool *taskPoolCreate(int workerCount, size_t taskSize, TaskRunner runTask) {
+    if (workerCount < 1 || taskSize == 0 || !runTask) {
+        return NULL;
+    }
+
+    TaskPool *pool = (TaskPool *)calloc(1, sizeof(TaskPool));
+    if (!pool) {
+        return NULL;
+    }
+
+    pool->deques = (TaskDeque *)calloc(workerCount, sizeof(TaskDeque));
+    if (!pool->deques) {
+        free(pool);
+        return NULL;
+    }
+
+    for (int i = 0; i < workerCount; i++) {
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+    }
+
+    pool->workerCount = workerCount;
+    pool->taskSize = taskSize;
+    pool->runTask = runTask;
+    return pool;
+}
+
+void taskPoolFree(TaskPool *pool) {
+    if (!pool) {
+        return;
+    }
+
+    for (int i = 0; i < pool->workerCount; i++) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].tasks);
+    }
+    free(pool->deques);
+    free(pool->workerCpus);
+    free(pool);
+}
+
+/*
+ * pinning worker i to cpus[i] from the next run on, the calling thread (worker 0) is
+ * pinned right away, returns 0 if memory ran out or the calling thread cannot be pinned
+ */
+int taskPoolSetAffinity(TaskPool *pool, const int *cpus) {
+    int *workerCpus = (int *)malloc(pool->workerCount * sizeof(int));
+    if (!workerCpus) {
+        return 0;
+    }
+    memcpy(workerCpus, cpus, pool->workerCount * sizeof(int));
+
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(workerCpus[0], &cpuSet);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0) {
+        free(workerCpus);
+        return 0;
+    }
+
+    free(pool->workerCpus);
+    pool->workerCpus = workerCpus;
+    return 1;
+}
+
+// state the runner reaches from every worker through taskPoolContext, set before running
+void taskPoolSetContext(TaskPool *pool, void *context) {
+    pool->context = context;
+}
+
+void *taskPoolContext(TaskPool *pool) {
+    return pool->context;
+}
+
+// making room for one more task at the tail, caller holds the deque lock
+static int reserveSlot(TaskDeque *deque, size_t taskSize) {
+    if (deque->head > 0 && deque->head == deque->tail) {
+        deque->head = deque->tail = 0;
+    }
+
+    if (deque->tail < deque->capacity) {
+        return 1;
+    }
+
+    if (deque->head > 0) {
+        memmove(deque->tasks, deque->tasks + (size_t)deque->head * taskSize,
+                (size_t)(deque->tail - deque->head) * taskSize);
+        deque->tail -= deque->head;
+        deque->head = 0;
+        return 1;
+    }
+
+    int newCapacity = deque->capacity ? deque->capacity * 2 : INITIAL_DEQUE_CAPACITY;
+    unsigned char *grown = (unsigned char *)realloc(deque->tasks, (size_t)newCapacity * taskSize);
+    if (!grown) {
+        return 0;
+    }
+
+    deque->tasks = grown;
+    deque->capacity = newCapacity;
+    return 1;
+}
+
+/*
+ * queueing a task on the given worker's deque (task is copied),
+ * returns 0 if the pool has been stopped or memory ran out
+ */
+int taskPoolPush(TaskPool *pool, int workerId, const void *task) {
+    if (__atomic_load_n(&pool->stopRequested, __ATOMIC_RELAXED)) {
+        return 0;
+    }
+
+    TaskDeque *deque = &pool->deques[workerId % pool->workerCount];
+    pthread_mutex_lock(&deque->lock);
+
+    if (!reserveSlot(deque, pool->taskSize)) {
+        pthread_mutex_unlock(&deque->lock);
+        return 0;
+    }
+
+    memcpy(deque->tasks + (size_t)deque->tail * pool->taskSize, task, pool->taskSize);
+    deque->tail++;
+    __atomic_add_fetch(&pool->pendingTasks, 1, __ATOMIC_ACQ_REL);
+
+    pthread_mutex_unlock(&deque->lock);
+    return 1;
+}
+
+// taking the newest task from our own deque
+static int popOwn(TaskPool *pool, int workerId, void *task) {
+    TaskDeque *deque = &pool->deques[workerId];
+    int found = 0;
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->tail > deque->head) {
+        deque->tail--;
+        memcpy(task, deque->tasks + (size_t)deque->tail * pool->taskSize, pool->taskSize);
+        found = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+
+    return found;
+}
+
+// taking the oldest task from some other worker's deque
+static int stealTask(TaskPool *pool, int workerId, void *task) {
+    for (int offset = 1; offset < pool->workerCount; offset++) {
+        TaskDeque *victim = &pool->deques[(workerId + offset) % pool->workerCount];
+        int found = 0;
+
+        pthread_mutex_lock(&victim->lock);
+        if (victim->tail > victim->head) {
+            memcpy(task, victim->tasks + (size_t)victim->head * pool->taskSize, pool->taskSize);
+            victim->head++;
+            found = 1;
+        }
+        pthread_mutex_unlock(&victim->lock);
+
+        if (found) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static void *workerMain(void *arg) {
+    WorkerArgs *args = (WorkerArgs *)arg;
+    TaskPool *pool = args->pool;
+    int workerId = args->workerId;
+    void *task = malloc(pool->taskSize);
+
+    if (!task) {
+        return NULL;
+    }
+
+    while (__atomic_load_n(&pool->pendingTasks, __ATOMIC_ACQUIRE) > 0) {
+        if (!popOwn(pool, workerId, task) && !stealTask(pool, workerId, task)) {
+            sched_yield();
+            continue;
+        }
+
+        // tasks are still handed to the runner after a stop so it can release
+        // what they hold, runners check taskPoolStopped() and return early
+        pool->runTask(pool, workerId, task);
+
+        __atomic_sub_fetch(&pool->pendingTasks, 1, __ATOMIC_ACQ_REL);
+    }
+
+    free(task);
+    return NULL;
+}
+
+/*
+ * running all queued tasks (and the tasks they spawn) to completion,
+ * the calling thread acts as worker 0
+ */
+void taskPoolRun(TaskPool *pool) {
+    pthread_t *threads = (pthread_t *)calloc(pool->workerCount, sizeof(pthread_t));
+    WorkerArgs *args = (WorkerArgs *)calloc(pool->workerCount, sizeof(WorkerArgs));
+    int started = 1;
+
+    if (!threads || !args) {
+        free(threads);
+        free(args);
+        WorkerArgs single = {pool, 0};
+        workerMain(&single);
+        return;
+    }
+
+    for (int i = 0; i < pool->workerCount; i++) {
+        args[i].pool = pool;
+        args[i].workerId = i;
+    }
+
+    for (int i = 1; i < pool->workerCount; i++) {
+        pthread_attr_t attributes;
+        pthread_attr_init(&attributes);
+        if (pool->workerCpus) {
+            cpu_set_t cpuSet;
+            CPU_ZERO(&cpuSet);
+            CPU_SET(pool->workerCpus[i], &cpuSet);
+            pthread_attr_setaffinity_np(&attributes, sizeof(cpuSet), &cpuSet);
+        }
+        int created = pthread_create(&threads[i], &attributes, workerMain, &args[i]) == 0;
+        pthread_attr_destroy(&attributes);
+        if (!created) {
+            break;
+        }
+        started++;
+    }
+
+    workerMain(&args[0]);
+
+    for (int i = 1; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    free(threads);
+    free(args);
+}
+
+// asking all workers to stop, no new tasks are accepted and queued ones are drained
+void taskPoolStop(TaskPool *pool) {
+    __atomic_store_n(&pool->stopRequested, 1, __ATOMIC_RELAXED);
+}
+
+int taskPoolStopped(TaskPool *pool) {
+    return __atomic_load_n(&pool->stopRequested, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,148 @@
+/*
+ * bounded top-K candidate heap for the bias-ranked search,
+ * a min-heap keyed by score so the weakest kept candidate sits at the root
+ * and is replaced when a better one arrives, shared by all scoring workers
+*/
+
+#include <stdlib.h>
+#include <pthread.h>
+
+typedef unsigned int uint32_t;
+
+typedef struct {
+    int score;      // pairs agreeing with the majority
+    uint32_t key;
+} RankedCandidate;
+
+typedef struct CandidateHeap {
+    pthread_mutex_t lock;
+    RankedCandidate *entries;
+    int capacity;
+    int size;
+    int threshold;  // score needed to enter once full, 0 while filling
+} CandidateHeap;
+
+CandidateHeap *candidateHeapCreate(int capacity) {
+    if (capacity < 1) {
+        return NULL;
+    }
+
+    CandidateHeap *heap = (CandidateHeap *)calloc(1, sizeof(CandidateHeap));
+    if (!heap) {
+        return NULL;
+    }
+
+    heap->entries = (RankedCandidate *)malloc(capacity * sizeof(RankedCandidate));
+    if (!heap->entries) {
+        free(heap);
+        return NULL;
+    }
+
+    pthread_mutex_init(&heap->lock, NULL);
+    heap->capacity = capacity;
+    return heap;
+}
+
+void candidateHeapFree(CandidateHeap *heap) {
+    if (!heap) {
+        return;
+    }
+
+    pthread_mutex_destroy(&heap->lock);
+    free(heap->entries);
+    free(heap);
+}
+
+// higher score wins, ties go to the smaller key so the ranking is deterministic
+static int rankedBefore(const RankedCandidate *a, const RankedCandidate *b) {
+    return a->score > b->score || (a->score == b->score && a->key < b->key);
+}
+
+static void swapEntries(RankedCandidate *a, RankedCandidate *b) {
+    RankedCandidate temp = *a;
+    *a = *b;
+    *b = temp;
+}
+
+static void siftUp(CandidateHeap *heap, int index) {
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (!rankedBefore(&heap->entries[parent], &heap->entries[index])) {
+            break;
+        }
+        swapEntries(&heap->entries[parent], &heap->entries[index]);
+        index = parent;
+    }
+}
+
+static void siftDown(CandidateHeap *heap, int index) {
+    for (;;) {
+        int weakest = index;
+        int left = 2 * index + 1;
+        int right = left + 1;
+
+        if (left < heap->size && rankedBefore(&heap->entries[weakest], &heap->entries[left])) {
+            weakest = left;
+        }
+        if (right < heap->size && rankedBefore(&heap->entries[weakest], &heap->entries[right])) {
+            weakest = right;
+        }
+        if (weakest == index) {
+            return;
+        }
+        swapEntries(&heap->entries[weakest], &heap->entries[index]);
+        index = weakest;
+    }
+}
+
+// offering a scored candidate, kept if the heap has room or it beats the weakest entry
+void candidateHeapOffer(CandidateHeap *heap, int score, uint32_t key) {
+    RankedCandidate candidate = {score, key};
+
+    pthread_mutex_lock(&heap->lock);
+
+    if (heap->size < heap->capacity) {
+        heap->entries[heap->size] = candidate;
+        siftUp(heap, heap->size);
+        heap->size++;
+    } else if (rankedBefore(&candidate, &heap->entries[0])) {
+        heap->entries[0] = candidate;
+        siftDown(heap, 0);
+    }
+
+    if (heap->size == heap->capacity) {
+        __atomic_store_n(&heap->threshold, heap->entries[0].score, __ATOMIC_RELAXED);
+    }
+
+    pthread_mutex_unlock(&heap->lock);
+}
+
+/*
+ * lowest score that can still enter the heap, read without the lock by the
+ * scoring loops to abandon candidates early (branch and bound)
+ */
+int candidateHeapThreshold(CandidateHeap *heap) {
+    return __atomic_load_n(&heap->threshold, __ATOMIC_RELAXED);
+}
+
+/*
+ * moving the kept candidates out best first, returns how many were written,
+ * the heap is empty and reusable afterwards
+ */
+int candidateHeapDrain(CandidateHeap *heap, uint32_t *keys, int *scores) {
+    pthread_mutex_lock(&heap->lock);
+
+    int count = heap->size;
+    for (int position = count - 1; position >= 0; position--) {
+        keys[position] = heap->entries[0].key;
+        if (scores) {
+            scores[position] = heap->entries[0].score;
+        }
+        heap->entries[0] = heap->entries[--heap->size];
+        siftDown(heap, 0);
+    }
+    heap->threshold = 0;
+
+    pthread_mutex_unlock(&heap->lock);
+    return count;
+}
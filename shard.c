@@ -0,0 +1,194 @@
+/*
+ * merging the outputs of a sharded attack, every shard prints its valid keys
+ * (the tab separated subkeys of one key per line, six for FEAL-4), a
+ * "Shard i/N" line and its running time, the merge lists every key once and
+ * checks that each shard of the run is present
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef unsigned int uint32_t;
+
+#define MERGE_KEY_WORDS 6   // FEAL-4, reduced round variants print fewer subkeys
+#define MERGE_LINE_LENGTH 256
+
+typedef struct {
+    uint32_t words[MERGE_KEY_WORDS];  // unused words are zero
+    int wordCount;
+} MergedKey;
+
+typedef struct {
+    MergedKey *keys;
+    int count;
+    int capacity;
+} MergedKeyList;
+
+static int appendMergedKey(MergedKeyList *list, const MergedKey *key) {
+    if (list->count == list->capacity) {
+        int newCapacity = list->capacity ? list->capacity * 2 : 256;
+        MergedKey *grown = (MergedKey *)realloc(list->keys, newCapacity * sizeof(MergedKey));
+        if (!grown) {
+            return 0;
+        }
+        list->keys = grown;
+        list->capacity = newCapacity;
+    }
+
+    list->keys[list->count++] = *key;
+    return 1;
+}
+
+static int compareMergedKeys(const void *a, const void *b) {
+    const MergedKey *left = (const MergedKey *)a;
+    const MergedKey *right = (const MergedKey *)b;
+
+    if (left->wordCount != right->wordCount) {
+        return left->wordCount < right->wordCount ? -1 : 1;
+    }
+    for (int wordIdx = 0; wordIdx < MERGE_KEY_WORDS; wordIdx++) {
+        if (left->words[wordIdx] != right->words[wordIdx]) {
+            return left->words[wordIdx] < right->words[wordIdx] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+// the subkeys of a key line (at least three), 0 for any other line
+static int parseKeyLine(const char *line, MergedKey *key) {
+    if (line[0] != '0' || line[1] != 'x') {
+        return 0;
+    }
+
+    memset(key, 0, sizeof(*key));
+    key->wordCount = sscanf(line, "%x %x %x %x %x %x", &key->words[0], &key->words[1], &key->words[2],
+                            &key->words[3], &key->words[4], &key->words[5]);
+    return key->wordCount >= 3;
+}
+
+/*
+ * reading one shard output, its keys are appended to the list, returns 0 if the
+ * file cannot be read or lacks the shard line
+ */
+static int readShardOutput(const char *path, MergedKeyList *list, int *shardIndex, int *shardCount,
+                           long *elapsedMs) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Error: Cannot open file %s\n", path);
+        return 0;
+    }
+
+    char line[MERGE_LINE_LENGTH];
+    int foundShard = 0;
+    *elapsedMs = 0;
+
+    while (fgets(line, sizeof(line), file)) {
+        MergedKey key;
+        int keys;
+        const char *timing;
+
+        if (parseKeyLine(line, &key)) {
+            if (!appendMergedKey(list, &key)) {
+                fprintf(stderr, "Error: Memory allocation failed\n");
+                fclose(file);
+                return 0;
+            }
+        } else if (sscanf(line, "Shard %d/%d", shardIndex, shardCount) == 2) {
+            foundShard = 1;
+        } else if (sscanf(line, "Found %d valid keys", &keys) == 1 && (timing = strstr(line, " in "))) {
+            sscanf(timing, " in %ld ms", elapsedMs);
+        }
+    }
+
+    fclose(file);
+
+    if (!foundShard || *shardCount < 1 || *shardIndex < 1 || *shardIndex > *shardCount) {
+        fprintf(stderr, "Error: %s is not the output of a sharded run\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * merging the outputs of the shards of one run, prints the combined key list and
+ * the longest (wall-clock) and summed (machine time) shard timings, returns 0 on
+ * unreadable files, mixed runs or missing and repeated shards
+ */
+int mergeShardOutputs(int fileCount, char **paths) {
+    MergedKeyList list = {NULL, 0, 0};
+    char *seen = NULL;
+    int runShards = 0;
+    long longestMs = 0;
+    long totalMs = 0;
+    int merged = 1;
+
+    for (int fileIdx = 0; fileIdx < fileCount && merged; fileIdx++) {
+        int shardIndex = 0;
+        int shardCount = 0;
+        long elapsedMs = 0;
+
+        merged = readShardOutput(paths[fileIdx], &list, &shardIndex, &shardCount, &elapsedMs);
+        if (!merged) {
+            break;
+        }
+
+        if (!seen) {
+            runShards = shardCount;
+            seen = (char *)calloc(runShards, 1);
+            if (!seen) {
+                fprintf(stderr, "Error: Memory allocation failed\n");
+                merged = 0;
+                break;
+            }
+        }
+
+        if (shardCount != runShards) {
+            fprintf(stderr, "Error: %s belongs to a run with %d shards, not %d\n",
+                    paths[fileIdx], shardCount, runShards);
+            merged = 0;
+        } else if (seen[shardIndex - 1]) {
+            fprintf(stderr, "Error: Shard %d/%d is given twice\n", shardIndex, shardCount);
+            merged = 0;
+        } else {
+            seen[shardIndex - 1] = 1;
+            longestMs = elapsedMs > longestMs ? elapsedMs : longestMs;
+            totalMs += elapsedMs;
+        }
+    }
+
+    int missing = 0;
+    for (int shardIdx = 0; shardIdx < runShards && merged; shardIdx++) {
+        if (!seen[shardIdx]) {
+            fprintf(stderr, "Warning: Output of shard %d/%d is missing\n", shardIdx + 1, runShards);
+            missing++;
+        }
+    }
+
+    if (merged) {
+        qsort(list.keys, list.count, sizeof(MergedKey), compareMergedKeys);
+
+        int unique = 0;
+        for (int keyIdx = 0; keyIdx < list.count; keyIdx++) {
+            if (unique > 0 && compareMergedKeys(&list.keys[unique - 1], &list.keys[keyIdx]) == 0) {
+                continue;
+            }
+            list.keys[unique++] = list.keys[keyIdx];
+        }
+
+        for (int keyIdx = 0; keyIdx < unique; keyIdx++) {
+            const MergedKey *key = &list.keys[keyIdx];
+            for (int wordIdx = 0; wordIdx < key->wordCount; wordIdx++) {
+                printf(wordIdx ? "\t0x%08x" : "0x%08x", key->words[wordIdx]);
+            }
+            printf("\n");
+        }
+
+        printf("\nMerged %d of %d shards: %d valid keys\n", runShards - missing, runShards, unique);
+        printf("Longest shard %ld ms, all shards %ld ms\n", longestMs, totalMs);
+    }
+
+    free(list.keys);
+    free(seen);
+    return merged && missing == 0;
+}
@@ -0,0 +1,224 @@
+/*
+ * result sink for the confirmed keys: workers push every key onto a lock-free list
+ * and return to the search, a writer thread drains the list to stdout or a file as
+ * text lines (the default, one tab separated key per line), JSON lines or binary
+ * records, so no worker waits for the output stream
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+typedef unsigned int uint32_t;
+
+#define SINK_MAX_WORDS 8
+
+// binary key files: header, then wordsPerKey words per key in the producer's byte order
+#define SINK_BINARY_MAGIC "FEALKEYS"
+#define SINK_BINARY_VERSION 1
+#define SINK_BYTE_ORDER_MARK 0x01020304u   // read back as 0x04030201 on the other endianness
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t wordsPerKey;
+    uint32_t reserved;       // zero
+} BinaryKeyHeader;
+
+enum { SINK_TEXT, SINK_JSON, SINK_BINARY, SINK_FORMAT_COUNT };
+
+static const char *const formatNames[SINK_FORMAT_COUNT] = {"text", "json", "binary"};
+
+typedef struct KeyNode {
+    struct KeyNode *next;
+    uint32_t words[SINK_MAX_WORDS];
+} KeyNode;
+
+typedef struct KeySink {
+    pthread_t thread;
+    sem_t wakeup;              // posted once per pushed key and on close
+    KeyNode *pushed;           // newest first, swapped out as a whole by the writer
+    FILE *file;
+    const char *path;          // NULL for stdout
+    int format;
+    int wordCount;
+    int stopRequested;
+    int outOfMemory;           // a key could not be queued
+    int failed;                // a write failed, reported once
+} KeySink;
+
+// the index of a format name for keySinkCreate, -1 if unknown
+int keySinkParseFormat(const char *name) {
+    for (int format = 0; format < SINK_FORMAT_COUNT; format++) {
+        if (strcmp(name, formatNames[format]) == 0) {
+            return format;
+        }
+    }
+    return -1;
+}
+
+static int writeKey(KeySink *sink, const uint32_t *words) {
+    int written = 1;
+
+    if (sink->format == SINK_BINARY) {
+        return fwrite(words, sizeof(uint32_t), sink->wordCount, sink->file) == (size_t)sink->wordCount;
+    }
+
+    if (sink->format == SINK_JSON) {
+        written = fputs("{\"key\": [", sink->file) >= 0;
+    }
+    for (int word = 0; word < sink->wordCount && written; word++) {
+        const char *layout = sink->format == SINK_JSON ? (word ? ", \"0x%08x\"" : "\"0x%08x\"")
+                                                       : (word ? "\t0x%08x" : "0x%08x");
+        written = fprintf(sink->file, layout, words[word]) > 0;
+    }
+    return written && fputs(sink->format == SINK_JSON ? "]}\n" : "\n", sink->file) >= 0;
+}
+
+// writing the keys taken from the list in the order they were found, then freeing them
+static void writeKeys(KeySink *sink, KeyNode *newestFirst) {
+    KeyNode *oldestFirst = NULL;
+
+    while (newestFirst) {
+        KeyNode *next = newestFirst->next;
+        newestFirst->next = oldestFirst;
+        oldestFirst = newestFirst;
+        newestFirst = next;
+    }
+
+    int written = 1;
+    while (oldestFirst) {
+        KeyNode *next = oldestFirst->next;
+        written = written && writeKey(sink, oldestFirst->words);
+        free(oldestFirst);
+        oldestFirst = next;
+    }
+    if ((fflush(sink->file) != 0 || !written) && !sink->failed) {
+        fprintf(stderr, "Error: Cannot write keys to %s\n", sink->path ? sink->path : "stdout");
+        sink->failed = 1;
+    }
+}
+
+static void *writerMain(void *arg) {
+    KeySink *sink = (KeySink *)arg;
+
+    for (;;) {
+        while (sem_wait(&sink->wakeup) != 0) {
+            // interrupted by a signal
+        }
+        // every key pushed before the stop request is on the list once the request is seen
+        int stopping = __atomic_load_n(&sink->stopRequested, __ATOMIC_ACQUIRE);
+        KeyNode *keys = __atomic_exchange_n(&sink->pushed, NULL, __ATOMIC_ACQUIRE);
+        if (keys) {
+            writeKeys(sink, keys);
+        }
+        if (stopping) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * starting a sink for keys of wordCount words in format (keySinkParseFormat) written
+ * to path, or to stdout if path is NULL (the path must outlive the sink), returns NULL
+ * if the file cannot be created or the writer thread cannot be started
+ */
+KeySink *keySinkCreate(const char *path, int format, int wordCount) {
+    if (format < 0 || format >= SINK_FORMAT_COUNT || wordCount < 1 || wordCount > SINK_MAX_WORDS) {
+        return NULL;
+    }
+
+    KeySink *sink = (KeySink *)calloc(1, sizeof(KeySink));
+    if (!sink) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return NULL;
+    }
+    sink->path = path;
+    sink->format = format;
+    sink->wordCount = wordCount;
+    sink->file = path ? fopen(path, format == SINK_BINARY ? "wb" : "w") : stdout;
+    if (!sink->file) {
+        fprintf(stderr, "Error: Cannot create file %s\n", path);
+        free(sink);
+        return NULL;
+    }
+
+    if (format == SINK_BINARY) {
+        BinaryKeyHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SINK_BINARY_MAGIC, sizeof(header.magic));
+        header.version = SINK_BINARY_VERSION;
+        header.byteOrder = SINK_BYTE_ORDER_MARK;
+        header.wordsPerKey = (uint32_t)wordCount;
+        if (fwrite(&header, sizeof(header), 1, sink->file) != 1) {
+            fprintf(stderr, "Error: Cannot write file %s\n", path ? path : "stdout");
+            if (path) {
+                fclose(sink->file);
+            }
+            free(sink);
+            return NULL;
+        }
+    }
+
+    int started = sem_init(&sink->wakeup, 0, 0) == 0;
+    if (started && pthread_create(&sink->thread, NULL, writerMain, sink) != 0) {
+        sem_destroy(&sink->wakeup);
+        started = 0;
+    }
+    if (!started) {
+        fprintf(stderr, "Error: Cannot start the key writer\n");
+        if (path) {
+            fclose(sink->file);
+        }
+        free(sink);
+        return NULL;
+    }
+    return sink;
+}
+
+// queueing one key (wordCount words) from any thread, never blocks on the output
+void keySinkSubmit(KeySink *sink, const uint32_t *words) {
+    KeyNode *node = (KeyNode *)malloc(sizeof(KeyNode));
+    if (!node) {
+        __atomic_store_n(&sink->outOfMemory, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    memcpy(node->words, words, sink->wordCount * sizeof(uint32_t));
+
+    node->next = __atomic_load_n(&sink->pushed, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&sink->pushed, &node->next, node, 1, __ATOMIC_RELEASE,
+                                        __ATOMIC_RELAXED)) {
+        // node->next was reloaded with the current head
+    }
+    sem_post(&sink->wakeup);
+}
+
+/*
+ * writing the keys still queued, stopping the writer and closing the file, returns 0
+ * if a key was lost (out of memory) or could not be written
+ */
+int keySinkClose(KeySink *sink) {
+    if (!sink) {
+        return 1;
+    }
+
+    __atomic_store_n(&sink->stopRequested, 1, __ATOMIC_RELEASE);
+    sem_post(&sink->wakeup);
+    pthread_join(sink->thread, NULL);
+    sem_destroy(&sink->wakeup);
+
+    if (sink->outOfMemory) {
+        fprintf(stderr, "Error: Memory allocation failed, keys are missing from the output\n");
+    }
+    int written = !sink->failed && !sink->outOfMemory;
+    if (sink->path && fclose(sink->file) != 0 && written) {
+        fprintf(stderr, "Error: Cannot write keys to %s\n", sink->path);
+        written = 0;
+    }
+    free(sink);
+    return written;
+}
@@ -0,0 +1,181 @@
+/*
+ * cpu and NUMA node topology for placing the worker threads (linux sysfs): the cpus
+ * this process may run on, ordered one per physical core before their SMT siblings,
+ * either node by node (compact) or taking turns between the nodes (spread), and a
+ * helper running a function on a given cpu, so that the memory it first touches is
+ * allocated on that cpu's node
+*/
+
+// cpu_set_t and the affinity calls are gnu extensions
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define TOPOLOGY_LINE_LENGTH 4096
+
+typedef struct {
+    int cpu;
+    int node;
+    int siblingRank;  // 0 for the first cpu of its physical core, 1 for the next SMT thread...
+    int ordinal;      // position among the cpus of the same node and sibling rank
+    int order[3];     // sort keys of the placement order, qsort has no context argument
+} CpuPlace;
+
+// reading a sysfs cpu list like "0-3,8,10-11" into a membership array of CPU_SETSIZE entries
+static int readCpuList(const char *path, char *members) {
+    FILE *file = fopen(path, "r");
+    char line[TOPOLOGY_LINE_LENGTH];
+
+    if (!file) {
+        return 0;
+    }
+    int found = fgets(line, sizeof(line), file) != NULL;
+    fclose(file);
+    if (!found) {
+        return 0;
+    }
+
+    memset(members, 0, CPU_SETSIZE);
+    char *rest = NULL;
+    for (char *range = strtok_r(line, ",\n", &rest); range; range = strtok_r(NULL, ",\n", &rest)) {
+        int first, last;
+        int fields = sscanf(range, "%d-%d", &first, &last);
+        if (fields < 1) {
+            continue;
+        }
+        if (fields == 1) {
+            last = first;
+        }
+        for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+            if (cpu >= 0) {
+                members[cpu] = 1;
+            }
+        }
+    }
+    return 1;
+}
+
+// position of cpu among the SMT threads of its core, 0 without topology information
+static int siblingRank(int cpu) {
+    char path[96];
+    char siblings[CPU_SETSIZE];
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+    if (!readCpuList(path, siblings)) {
+        return 0;
+    }
+
+    int rank = 0;
+    for (int other = 0; other < cpu; other++) {
+        rank += siblings[other];
+    }
+    return rank;
+}
+
+static int comparePlaces(const void *a, const void *b) {
+    const CpuPlace *left = (const CpuPlace *)a;
+    const CpuPlace *right = (const CpuPlace *)b;
+
+    for (int keyIdx = 0; keyIdx < 3; keyIdx++) {
+        if (left->order[keyIdx] != right->order[keyIdx]) {
+            return left->order[keyIdx] < right->order[keyIdx] ? -1 : 1;
+        }
+    }
+    return left->cpu - right->cpu;
+}
+
+/*
+ * the cpus the process may use in placement order (spread: alternating nodes, otherwise
+ * compact), cpus[i] and nodes[i] for up to maxCpus of them, nodes are 0 on kernels
+ * without NUMA information, returns the count (0 if the affinity mask is unreadable)
+ */
+int topologyCpuOrder(int spread, int *cpus, int *nodes, int maxCpus) {
+    cpu_set_t allowed;
+    CpuPlace *places = (CpuPlace *)malloc(CPU_SETSIZE * sizeof(CpuPlace));
+    int count = 0;
+
+    if (!places || sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        free(places);
+        return 0;
+    }
+
+    // node of every cpu, from the cpu lists of the possible nodes (the same list format)
+    int cpuNodes[CPU_SETSIZE] = {0};
+    char possibleNodes[CPU_SETSIZE];
+    char members[CPU_SETSIZE];
+    if (!readCpuList("/sys/devices/system/node/possible", possibleNodes)) {
+        memset(possibleNodes, 0, sizeof(possibleNodes));
+    }
+    for (int node = 0; node < CPU_SETSIZE; node++) {
+        char path[96];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        if (!possibleNodes[node] || !readCpuList(path, members)) {
+            continue;
+        }
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (members[cpu]) {
+                cpuNodes[cpu] = node;
+            }
+        }
+    }
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+        CpuPlace *place = &places[count++];
+        place->cpu = cpu;
+        place->node = cpuNodes[cpu];
+        place->siblingRank = siblingRank(cpu);
+        place->ordinal = 0;
+        for (int earlier = 0; earlier < count - 1; earlier++) {
+            if (places[earlier].node == place->node && places[earlier].siblingRank == place->siblingRank) {
+                place->ordinal++;
+            }
+        }
+    }
+
+    // compact: node, then core before sibling, spread: core before sibling, then the nodes in turn
+    for (int placeIdx = 0; placeIdx < count; placeIdx++) {
+        CpuPlace *place = &places[placeIdx];
+        int compact[3] = {place->node, place->siblingRank, place->ordinal};
+        int spreadKeys[3] = {place->siblingRank, place->ordinal, place->node};
+        memcpy(place->order, spread ? spreadKeys : compact, sizeof(place->order));
+    }
+    qsort(places, count, sizeof(CpuPlace), comparePlaces);
+
+    count = count < maxCpus ? count : maxCpus;
+    for (int placeIdx = 0; placeIdx < count; placeIdx++) {
+        cpus[placeIdx] = places[placeIdx].cpu;
+        nodes[placeIdx] = places[placeIdx].node;
+    }
+    free(places);
+    return count;
+}
+
+/*
+ * running work(context) on a thread pinned to cpu and waiting for it, memory the
+ * function allocates and writes first lands on the cpu's node, returns 0 if the
+ * thread cannot be started there
+ */
+int topologyRunOnCpu(int cpu, void *(*work)(void *), void *context) {
+    pthread_attr_t attributes;
+    pthread_t thread;
+    cpu_set_t cpuSet;
+
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpu, &cpuSet);
+    pthread_attr_init(&attributes);
+    int placed = pthread_attr_setaffinity_np(&attributes, sizeof(cpuSet), &cpuSet) == 0 &&
+                 pthread_create(&thread, &attributes, work, context) == 0;
+    pthread_attr_destroy(&attributes);
+
+    if (placed) {
+        pthread_join(thread, NULL);
+    }
+    return placed;
+}